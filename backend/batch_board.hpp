@@ -0,0 +1,455 @@
+#ifndef BATCH_BOARD
+#define BATCH_BOARD
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+
+
+/*
+ The lane types that the batch kernels are written with. A lane type holds the same bitboard of one or more positions,
+ so the kernels are written once and run either on one position at a time or on 4 positions at once with AVX2.
+ Shifts with a negative amount shift to the right.
+*/
+namespace simd
+{
+
+struct ScalarLanes
+{
+    typedef uint64_t type;
+    static constexpr size_t width = 1;
+
+    static inline type load( const uint64_t* data ) noexcept { return *data; }
+    static inline void store( uint64_t* data, const type& v ) noexcept { *data = v; }
+    static inline type set( const uint64_t& value ) noexcept { return value; }
+
+    static inline type and_( const type& a, const type& b ) noexcept { return a & b; }
+    static inline type or_( const type& a, const type& b ) noexcept { return a | b; }
+    static inline type andnot( const type& a, const type& b ) noexcept { return ~a & b; } // the same order as the intrinsic
+    static inline type add( const type& a, const type& b ) noexcept { return a + b; }
+
+    template<int32_t Amount>
+    static inline type shift( const type& v ) noexcept
+    {
+        if constexpr ( Amount >= 0 ) return v << Amount;
+        else return v >> -Amount;
+    }
+
+    static inline type popcount( const type& v ) noexcept { return static_cast<type>( bitboard::popcount(v) ); }
+};
+
+
+#if defined(__AVX2__)
+struct Avx2Lanes
+{
+    typedef __m256i type;
+    static constexpr size_t width = 4;
+
+    static inline type load( const uint64_t* data ) noexcept { return _mm256_loadu_si256( reinterpret_cast<const __m256i*>(data) ); }
+    static inline void store( uint64_t* data, const type& v ) noexcept { _mm256_storeu_si256( reinterpret_cast<__m256i*>(data), v ); }
+    static inline type set( const uint64_t& value ) noexcept { return _mm256_set1_epi64x( static_cast<long long>(value) ); }
+
+    static inline type and_( const type& a, const type& b ) noexcept { return _mm256_and_si256(a, b); }
+    static inline type or_( const type& a, const type& b ) noexcept { return _mm256_or_si256(a, b); }
+    static inline type andnot( const type& a, const type& b ) noexcept { return _mm256_andnot_si256(a, b); }
+    static inline type add( const type& a, const type& b ) noexcept { return _mm256_add_epi64(a, b); }
+
+    template<int32_t Amount>
+    static inline type shift( const type& v ) noexcept
+    {
+        if constexpr ( Amount >= 0 ) return _mm256_slli_epi64(v, Amount);
+        else return _mm256_srli_epi64(v, -Amount);
+    }
+
+    // AVX2 has no popcount, so we count the nibbles with a table lookup and sum the bytes of every 64-bit lane
+    static inline type popcount( const type& v ) noexcept
+    {
+        const __m256i table = _mm256_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+        const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+
+        __m256i low = _mm256_and_si256( v, low_nibbles );
+        __m256i high = _mm256_and_si256( _mm256_srli_epi16(v, 4), low_nibbles );
+        __m256i bytes = _mm256_add_epi8( _mm256_shuffle_epi8(table, low), _mm256_shuffle_epi8(table, high) );
+
+        return _mm256_sad_epu8( bytes, _mm256_setzero_si256() );
+    }
+};
+
+typedef Avx2Lanes NativeLanes;
+#else
+typedef ScalarLanes NativeLanes;
+#endif
+
+
+// moves every bit one step into the direction, the bits that would wrap around the board edge are removed
+template<typename L, int32_t Amount>
+inline typename L::type step( const typename L::type& v ) noexcept
+{
+    constexpr int32_t file_change = ( ( Amount % 8 ) + 8 ) % 8; // 1 moves east, 7 moves west
+    typename L::type moved = L::template shift<Amount>(v);
+
+    if constexpr ( file_change == 1 ) return L::andnot( L::set(bitboard::FILE_A), moved );
+    else if constexpr ( file_change == 7 ) return L::andnot( L::set(bitboard::FILE_H), moved );
+    else return moved;
+}
+
+// the same for the knight jumps, which move 1 or 2 files
+template<typename L, int32_t Amount>
+inline typename L::type jump( const typename L::type& v ) noexcept
+{
+    constexpr int32_t file_change = ( ( Amount % 8 ) + 8 ) % 8;
+    typename L::type moved = L::template shift<Amount>(v);
+
+    if constexpr ( file_change == 1 ) return L::andnot( L::set(bitboard::FILE_A), moved );
+    else if constexpr ( file_change == 2 ) return L::andnot( L::set( bitboard::FILE_A | ( bitboard::FILE_A << 1 ) ), moved );
+    else if constexpr ( file_change == 6 ) return L::andnot( L::set( bitboard::FILE_H | ( bitboard::FILE_H >> 1 ) ), moved );
+    else return L::andnot( L::set(bitboard::FILE_H), moved );
+}
+
+/*
+ Kogge-Stone fill: the attacks of every slider of the mask into one direction, calculated for all of them at once
+ with 3 doubling steps. The rays of 2 sliders into the same direction never overlap, because a ray stops at the first
+ piece, so the popcount of the result is the number of moves into that direction.
+*/
+template<typename L, int32_t Amount>
+inline typename L::type slide( typename L::type sliders, const typename L::type& empty ) noexcept
+{
+    typename L::type open = L::and_( empty, step<L, Amount>( L::set(~0ULL) ) );
+
+    sliders = L::or_( sliders, L::and_( open, L::template shift<Amount>(sliders) ) );
+    open = L::and_( open, L::template shift<Amount>(open) );
+    sliders = L::or_( sliders, L::and_( open, L::template shift<Amount*2>(sliders) ) );
+    open = L::and_( open, L::template shift<Amount*2>(open) );
+    sliders = L::or_( sliders, L::and_( open, L::template shift<Amount*4>(sliders) ) );
+
+    return step<L, Amount>(sliders);
+}
+
+}
+
+
+
+// the result of a batch move count
+struct BatchCountStats
+{
+    size_t positions = 0;
+    uint64_t moves = 0;
+    double seconds = 0.0;
+    double positions_per_second = 0.0;
+};
+
+
+
+/*
+ Many independent positions stored as a structure of arrays: every bitboard has one array with a lane per position,
+ so the kernels read the same bitboard of neighbouring positions from consecutive memory and can handle several
+ positions with one instruction. The positions are stored from the point of view of the side to move, a position
+ where black is to move is mirrored, so the kernels only have to know how white moves.
+ The lane count is rounded up to a multiple of the vector width, the extra lanes are empty boards.
+*/
+class BatchBoard
+{
+    private:
+        enum planes
+        {
+            OWN,
+            ENEMY,
+            PAWNS,
+            KNIGHTS,
+            DIAGONAL, // bishops and queens
+            STRAIGHT, // rooks and queens
+            KINGS,
+            EN_PASSANT,
+
+            PLANE_COUNT
+        };
+
+        size_t lanes = 0;
+        size_t padded = 0;
+
+        std::vector<uint64_t> boards; // the planes one after another, each has padded lanes
+        std::vector<uint64_t> threats; // the squares that the side that isn't to move attacks, filled by the move count
+        std::vector<uint64_t> counts;
+
+        std::vector<uint8_t> flipped;
+        std::vector<uint8_t> castling; // bit 0 is the king side and bit 1 the queen side of the side to move
+        std::vector<uint8_t> castling_rooks; // 2 rook squares per lane, mirrored like the rest of the position
+
+
+        inline uint64_t* plane( const planes& index ) noexcept { return boards.data() + index * padded; }
+        inline const uint64_t* plane( const planes& index ) const noexcept { return boards.data() + index * padded; }
+
+
+        // counts the pseudo legal moves, except castling, of the lanes [begin, begin + L::width)
+        template<typename L>
+        void count_lanes( const size_t& begin ) noexcept
+        {
+            typedef typename L::type V;
+
+            V own = L::load( plane(OWN) + begin );
+            V enemy = L::load( plane(ENEMY) + begin );
+            V pawns = L::load( plane(PAWNS) + begin );
+            V knights = L::load( plane(KNIGHTS) + begin );
+            V diagonal = L::load( plane(DIAGONAL) + begin );
+            V straight = L::load( plane(STRAIGHT) + begin );
+            V kings = L::load( plane(KINGS) + begin );
+            V ep = L::load( plane(EN_PASSANT) + begin );
+
+            V empty = L::andnot( L::or_(own, enemy), L::set(~0ULL) );
+            V not_own = L::andnot( own, L::set(~0ULL) );
+            V last_rank = L::set(bitboard::RANK_8);
+            V total = L::set(0);
+
+            // the pawns, a move onto the last rank is 4 moves because of the promotions
+            auto add_pawn_moves = [&]( const V& targets ) {
+                V promotions = L::popcount( L::and_(targets, last_rank) );
+                total = L::add( total, L::add( L::popcount(targets), L::add( promotions, L::add(promotions, promotions) ) ) );
+            };
+
+            V own_pawns = L::and_(pawns, own);
+            V single = L::and_( L::template shift<8>(own_pawns), empty );
+            add_pawn_moves(single);
+            total = L::add( total, L::popcount( L::and_( L::template shift<8>( L::and_( single, L::set(bitboard::RANK_1 << 16) ) ), empty ) ) );
+
+            V left = simd::step<L, 7>(own_pawns);
+            V right = simd::step<L, 9>(own_pawns);
+            add_pawn_moves( L::and_(left, enemy) );
+            add_pawn_moves( L::and_(right, enemy) );
+            total = L::add( total, L::add( L::popcount( L::and_(left, ep) ), L::popcount( L::and_(right, ep) ) ) );
+
+            // each jump and each king step moves every piece into a different square, so they can be counted together
+            V own_knights = L::and_(knights, own);
+            total = L::add( total, L::popcount( L::and_( simd::jump<L, 17>(own_knights), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( simd::jump<L, 15>(own_knights), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( simd::jump<L, 10>(own_knights), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( simd::jump<L, 6>(own_knights), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( simd::jump<L, -6>(own_knights), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( simd::jump<L, -10>(own_knights), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( simd::jump<L, -15>(own_knights), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( simd::jump<L, -17>(own_knights), not_own ) ) );
+
+            V own_diagonal = L::and_(diagonal, own);
+            V own_straight = L::and_(straight, own);
+            V own_king = L::and_(kings, own);
+            total = L::add( total, L::popcount( L::and_( L::or_( simd::slide<L, 8>(own_straight, empty), simd::step<L, 8>(own_king) ), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( L::or_( simd::slide<L, -8>(own_straight, empty), simd::step<L, -8>(own_king) ), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( L::or_( simd::slide<L, 1>(own_straight, empty), simd::step<L, 1>(own_king) ), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( L::or_( simd::slide<L, -1>(own_straight, empty), simd::step<L, -1>(own_king) ), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( L::or_( simd::slide<L, 9>(own_diagonal, empty), simd::step<L, 9>(own_king) ), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( L::or_( simd::slide<L, 7>(own_diagonal, empty), simd::step<L, 7>(own_king) ), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( L::or_( simd::slide<L, -7>(own_diagonal, empty), simd::step<L, -7>(own_king) ), not_own ) ) );
+            total = L::add( total, L::popcount( L::and_( L::or_( simd::slide<L, -9>(own_diagonal, empty), simd::step<L, -9>(own_king) ), not_own ) ) );
+
+            L::store( counts.data() + begin, total );
+
+            // the squares that the other side attacks, the castling needs them. The enemy pawns capture downwards
+            V enemy_pawns = L::and_(pawns, enemy);
+            V enemy_knights = L::and_(knights, enemy);
+            V enemy_diagonal = L::and_(diagonal, enemy);
+            V enemy_straight = L::and_(straight, enemy);
+            V enemy_king = L::and_(kings, enemy);
+
+            V attacked = L::or_( simd::step<L, -7>(enemy_pawns), simd::step<L, -9>(enemy_pawns) );
+            attacked = L::or_( attacked, L::or_( L::or_( simd::jump<L, 17>(enemy_knights), simd::jump<L, 15>(enemy_knights) ), L::or_( simd::jump<L, 10>(enemy_knights), simd::jump<L, 6>(enemy_knights) ) ) );
+            attacked = L::or_( attacked, L::or_( L::or_( simd::jump<L, -6>(enemy_knights), simd::jump<L, -10>(enemy_knights) ), L::or_( simd::jump<L, -15>(enemy_knights), simd::jump<L, -17>(enemy_knights) ) ) );
+            attacked = L::or_( attacked, L::or_( L::or_( simd::slide<L, 8>(enemy_straight, empty), simd::step<L, 8>(enemy_king) ), L::or_( simd::slide<L, -8>(enemy_straight, empty), simd::step<L, -8>(enemy_king) ) ) );
+            attacked = L::or_( attacked, L::or_( L::or_( simd::slide<L, 1>(enemy_straight, empty), simd::step<L, 1>(enemy_king) ), L::or_( simd::slide<L, -1>(enemy_straight, empty), simd::step<L, -1>(enemy_king) ) ) );
+            attacked = L::or_( attacked, L::or_( L::or_( simd::slide<L, 9>(enemy_diagonal, empty), simd::step<L, 9>(enemy_king) ), L::or_( simd::slide<L, 7>(enemy_diagonal, empty), simd::step<L, 7>(enemy_king) ) ) );
+            attacked = L::or_( attacked, L::or_( L::or_( simd::slide<L, -7>(enemy_diagonal, empty), simd::step<L, -7>(enemy_king) ), L::or_( simd::slide<L, -9>(enemy_diagonal, empty), simd::step<L, -9>(enemy_king) ) ) );
+
+            L::store( threats.data() + begin, attacked );
+        }
+
+
+        // the castling moves of a lane, with the same rules as Position::add_castling()
+        uint32_t castling_moves( const size_t& lane ) const noexcept
+        {
+            if ( !castling[lane] ) return 0;
+
+            mask own_king = plane(KINGS)[lane] & plane(OWN)[lane];
+            if ( !own_king || ( own_king & threats[lane] ) ) return 0;
+
+            int32_t king = bitboard::lsb(own_king);
+            mask occ = plane(OWN)[lane] | plane(ENEMY)[lane];
+            uint32_t moves = 0;
+
+            for ( uint32_t wing = 0; wing < 2; wing++ ) {
+                if ( !( castling[lane] & ( 1 << wing ) ) ) continue;
+
+                int32_t rook = castling_rooks[ lane*2 + wing ];
+                int32_t king_target = ( wing == 0 ) ? 6 : 2;
+                int32_t rook_target = ( wing == 0 ) ? 5 : 3;
+
+                mask must_be_empty = ( bitboard::between(king, king_target) | bitboard::square_bit(king_target) |
+                                       bitboard::between(rook, rook_target) | bitboard::square_bit(rook_target) ) &
+                                     ~( bitboard::square_bit(king) | bitboard::square_bit(rook) );
+
+                mask king_path = bitboard::between(king, king_target) | bitboard::square_bit(king_target);
+
+                if ( !( must_be_empty & occ ) && !( king_path & threats[lane] ) ) moves++;
+            }
+
+            return moves;
+        }
+
+
+        template<typename L>
+        BatchCountStats count_with( helper::span<uint32_t> results ) noexcept
+        {
+            BatchCountStats stats;
+            auto start = std::chrono::steady_clock::now();
+
+            for ( size_t begin = 0; begin < padded; begin += L::width ) {
+                count_lanes<L>(begin);
+            }
+
+            size_t count = std::min( lanes, results.size() );
+
+            for ( size_t lane = 0; lane < count; lane++ ) {
+                results[lane] = static_cast<uint32_t>( counts[lane] ) + castling_moves(lane);
+                stats.moves += results[lane];
+            }
+
+            stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+            stats.positions = count;
+            if ( stats.seconds > 0.0 ) stats.positions_per_second = static_cast<double>(count) / stats.seconds;
+
+            return stats;
+        }
+
+
+    public:
+        // true when the move count runs on 4 positions at once
+        static constexpr bool vectorized = ( simd::NativeLanes::width > 1 );
+
+        explicit BatchBoard( const size_t& lanes0 )
+            : lanes(lanes0),
+              padded( ( lanes0 + simd::NativeLanes::width - 1 ) / simd::NativeLanes::width * simd::NativeLanes::width ),
+              boards( PLANE_COUNT * padded, 0 ),
+              threats( padded, 0 ),
+              counts( padded, 0 ),
+              flipped( padded, 0 ),
+              castling( padded, 0 ),
+              castling_rooks( padded * 2, 0 ) { }
+
+        inline size_t size() const noexcept { return lanes; }
+
+
+        // copies the position into the lane, mirrored when black is to move
+        void load( const size_t& lane, const Position& pos ) noexcept
+        {
+            uint32_t us = pos.side_to_move();
+            bool flip = ( us == BLACK );
+            auto relative = [flip]( const mask& m ) { return ( flip ) ? bitboard::flip_vertical(m) : m; };
+
+            plane(OWN)[lane] = relative( pos.color_pieces(us) );
+            plane(ENEMY)[lane] = relative( pos.color_pieces(us ^ 1) );
+            plane(PAWNS)[lane] = relative( pos.pieces(PAWN) );
+            plane(KNIGHTS)[lane] = relative( pos.pieces(KNIGHT) );
+            plane(DIAGONAL)[lane] = relative( pos.pieces(BISHOP) | pos.pieces(QUEEN) );
+            plane(STRAIGHT)[lane] = relative( pos.pieces(ROOK) | pos.pieces(QUEEN) );
+            plane(KINGS)[lane] = relative( pos.pieces(KING) );
+            plane(EN_PASSANT)[lane] = ( pos.en_passant() != bitboard::NO_SQUARE ) ? relative( bitboard::square_bit( pos.en_passant() ) ) : 0;
+
+            flipped[lane] = flip;
+            castling[lane] = static_cast<uint8_t>( ( pos.castling_state() >> ( us*2 ) ) & 3 );
+
+            for ( uint32_t wing = 0; wing < 2; wing++ ) {
+                castling_rooks[ lane*2 + wing ] = static_cast<uint8_t>( pos.castling_rook(us, wing) ^ ( ( flip ) ? 56 : 0 ) );
+            }
+        }
+
+
+        /**
+         * @brief Counts the pseudo legal moves of the side to move in every lane, the same moves that
+         * Position::generate_pseudo_legal() generates. The pieces are handled with AVX2 when the compiler targets it.
+         *
+         * @param results receives the count of every lane, it needs at least size() elements
+         * @return BatchCountStats the total amount of moves and the positions per second
+         */
+        BatchCountStats count_pseudo_legal( helper::span<uint32_t> results ) noexcept
+        {
+            return count_with<simd::NativeLanes>(results);
+        }
+
+        // the same without the vector instructions, to compare the results and the speed with
+        BatchCountStats count_pseudo_legal_scalar( helper::span<uint32_t> results ) noexcept
+        {
+            return count_with<simd::ScalarLanes>(results);
+        }
+
+
+        // the squares that the side that isn't to move attacks, this is valid after a move count
+        inline mask attacked_squares( const size_t& lane ) const noexcept
+        {
+            return ( flipped[lane] ) ? bitboard::flip_vertical( threats[lane] ) : threats[lane];
+        }
+
+        // true if the side to move is in check, this is valid after a move count
+        inline bool in_check( const size_t& lane ) const noexcept
+        {
+            return ( plane(KINGS)[lane] & plane(OWN)[lane] & threats[lane] ) != 0;
+        }
+};
+
+
+
+// the result of comparing the batch move counts with the moves of the scalar position
+struct BatchCheck
+{
+    size_t positions = 0;
+    size_t vector_mismatches = 0; // positions where count_pseudo_legal() differs
+    size_t scalar_mismatches = 0; // positions where count_pseudo_legal_scalar() differs
+    size_t first_mismatch = SIZE_MAX;
+
+    inline bool passed() const noexcept { return vector_mismatches == 0 && scalar_mismatches == 0; }
+};
+
+/**
+ * @brief Loads the positions into a batch board, counts their moves with and without the vector instructions and
+ * compares both counts of every position with the moves that Position::generate_pseudo_legal() generates.
+ *
+ * @param positions any positions, for example the positions of the games of a PGN file
+ * @return BatchCheck the number of positions where the counts differ and the index of the first one
+ */
+inline BatchCheck check_batch_counts( helper::span<const Position> positions )
+{
+    BatchCheck check;
+    check.positions = positions.size();
+
+    BatchBoard batch( positions.size() );
+    for ( size_t i = 0; i < positions.size(); i++ ) batch.load( i, positions[i] );
+
+    std::vector<uint32_t> vector_counts( positions.size() );
+    std::vector<uint32_t> scalar_counts( positions.size() );
+    batch.count_pseudo_legal(vector_counts);
+    batch.count_pseudo_legal_scalar(scalar_counts);
+
+    MoveList list;
+
+    for ( size_t i = 0; i < positions.size(); i++ ) {
+        list.clear();
+        positions[i].generate_pseudo_legal(list);
+
+        bool vector_differs = vector_counts[i] != list.size();
+        bool scalar_differs = scalar_counts[i] != list.size();
+
+        check.vector_mismatches += vector_differs;
+        check.scalar_mismatches += scalar_differs;
+        if ( ( vector_differs || scalar_differs ) && check.first_mismatch == SIZE_MAX ) check.first_mismatch = i;
+    }
+
+    return check;
+}
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef BATCH_EVALUATION
+#define BATCH_EVALUATION
+
+#include <cstdint>
+#include <vector>
+#include <chrono>
+
+#include "helper_tools.hpp"
+#include "position.hpp"
+#include "search.hpp"
+#include "thread_pool.hpp"
+
+
+// the result of one position, written into the buffer that the caller gives to evaluate_batch()
+struct BatchResult
+{
+    int32_t score = 0; // centipawns from the side to moves point of view
+    Move best_move;
+    uint64_t nodes = 0;
+    int32_t depth = 0;
+};
+
+// statistics of a whole evaluate_batch() call
+struct BatchStats
+{
+    size_t positions = 0;
+    uint64_t nodes = 0;
+    double seconds = 0.0;
+    double positions_per_second = 0.0;
+    double nodes_per_second = 0.0;
+
+    // how often the evaluation found the pawn structure in the pawn table of its thread
+    uint64_t pawn_probes = 0;
+    uint64_t pawn_hits = 0;
+    double pawn_hit_rate = 0.0;
+};
+
+
+
+/**
+ * @brief Evaluates many positions at once by spreading them over the threads of a work-stealing pool.
+ * Every worker searches with its own Searcher, so the threads don't share any board state.
+ *
+ * @param positions the positions to evaluate
+ * @param limit the depth or node budget of the search of one position, see SearchLimit
+ * @param results the buffer that receives the results, it needs at least as many elements as positions
+ * @param pool the thread pool that runs the searches
+ * @param searchers one searcher for every worker of the pool, it's grown to the size of the pool. Passing the same
+ * searchers to every call keeps their pawn tables warm between the batches
+ * @param chunk_size how many positions a single task evaluates
+ * @return BatchStats the amount of work done and the positions per second
+ */
+inline BatchStats evaluate_batch( helper::span<const Position> positions, const SearchLimit& limit, helper::span<BatchResult> results, ThreadPool& pool,
+                                  std::vector<Searcher>& searchers, size_t chunk_size = 16 )
+{
+    BatchStats stats;
+    size_t count = std::min( positions.size(), results.size() );
+
+    // each searcher is only used by a single worker at a time
+    if ( searchers.size() < pool.size() ) searchers.resize( pool.size() );
+    std::vector<uint64_t> worker_nodes( pool.size(), 0 );
+
+    // the pawn tables count over every call, so the statistics of this call are the difference
+    uint64_t probes_before = 0;
+    uint64_t hits_before = 0;
+
+    for ( const Searcher& searcher : searchers ) {
+        probes_before += searcher.pawn_cache().probe_count();
+        hits_before += searcher.pawn_cache().hit_count();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    pool.parallel_for( count, chunk_size, [&]( size_t worker, size_t begin, size_t end ) {
+        Searcher& searcher = searchers[worker];
+
+        for ( size_t i = begin; i < end; i++ ) {
+            SearchResult found = searcher.search( positions[i], limit );
+
+            results[i].score = found.score;
+            results[i].best_move = found.best_move;
+            results[i].nodes = found.nodes;
+            results[i].depth = found.depth;
+
+            worker_nodes[worker] += found.nodes;
+        }
+    } );
+
+    stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    stats.positions = count;
+
+    for ( const uint64_t& nodes : worker_nodes ) {
+        stats.nodes += nodes;
+    }
+
+    for ( const Searcher& searcher : searchers ) {
+        stats.pawn_probes += searcher.pawn_cache().probe_count();
+        stats.pawn_hits += searcher.pawn_cache().hit_count();
+    }
+
+    stats.pawn_probes -= probes_before;
+    stats.pawn_hits -= hits_before;
+
+    if ( stats.pawn_probes ) {
+        stats.pawn_hit_rate = static_cast<double>(stats.pawn_hits) / static_cast<double>(stats.pawn_probes);
+    }
+
+    if ( stats.seconds > 0.0 ) {
+        stats.positions_per_second = static_cast<double>(count) / stats.seconds;
+        stats.nodes_per_second = static_cast<double>(stats.nodes) / stats.seconds;
+    }
+
+    return stats;
+}
+
+
+// the same as above with searchers that only live for this call, so their pawn tables start empty
+inline BatchStats evaluate_batch( helper::span<const Position> positions, const SearchLimit& limit, helper::span<BatchResult> results, ThreadPool& pool, size_t chunk_size = 16 )
+{
+    std::vector<Searcher> searchers( pool.size() );
+    return evaluate_batch( positions, limit, results, pool, searchers, chunk_size );
+}
+
+// the same as above, but it creates a thread pool that uses every core of the machine.
+inline BatchStats evaluate_batch( helper::span<const Position> positions, const SearchLimit& limit, helper::span<BatchResult> results )
+{
+    ThreadPool pool;
+    return evaluate_batch( positions, limit, results, pool );
+}
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef BITBOARD
+#define BITBOARD
+
+#include <cstdint>
+#include <array>
+
+/*
+ The bitboard namespace contains the 64-bit square masks that the faster backend code uses.
+ A square index is x + 8*y, so it uses the same helper::coordinates<int64_t> layout as Board,
+ where x is the file ( 0 = a ) and y is the rank ( 0 = the white back rank ).
+*/
+namespace bitboard
+{
+
+typedef uint64_t mask;
+
+constexpr int32_t NO_SQUARE = 64;
+
+constexpr mask FILE_A = 0x0101010101010101ULL;
+constexpr mask FILE_H = FILE_A << 7;
+constexpr mask RANK_1 = 0xFFULL;
+constexpr mask RANK_8 = RANK_1 << 56;
+
+
+// the 8 sliding directions, the first 4 move towards higher square indexes
+enum directions
+{
+    NORTH,
+    EAST,
+    NORTH_EAST,
+    NORTH_WEST,
+    SOUTH,
+    WEST,
+    SOUTH_WEST,
+    SOUTH_EAST,
+
+    DIRECTION_COUNT
+};
+
+constexpr std::array<int32_t, DIRECTION_COUNT> direction_x = { 0, 1, 1, -1, 0, -1, -1, 1 };
+constexpr std::array<int32_t, DIRECTION_COUNT> direction_y = { 1, 0, 1, 1, -1, 0, -1, -1 };
+
+
+constexpr inline mask square_bit( const int32_t& square ) noexcept { return mask(1) << square; }
+constexpr inline int32_t make_square( const int32_t& x, const int32_t& y ) noexcept { return x + 8*y; }
+constexpr inline int32_t file_of( const int32_t& square ) noexcept { return square & 7; }
+constexpr inline int32_t rank_of( const int32_t& square ) noexcept { return square >> 3; }
+constexpr inline bool on_board( const int32_t& x, const int32_t& y ) noexcept { return x >= 0 && x < 8 && y >= 0 && y < 8; }
+
+
+inline int32_t popcount( mask m ) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(m);
+#else
+    int32_t count = 0;
+    for ( ; m; m &= m - 1 ) count++;
+    return count;
+#endif
+}
+
+// returns the index of the lowest set bit, the mask must not be empty
+inline int32_t lsb( const mask& m ) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(m);
+#else
+    int32_t index = 0;
+    while ( !( ( m >> index ) & 1 ) ) index++;
+    return index;
+#endif
+}
+
+// returns the index of the highest set bit, the mask must not be empty
+inline int32_t msb( const mask& m ) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(m);
+#else
+    int32_t index = 63;
+    while ( !( ( m >> index ) & 1 ) ) index--;
+    return index;
+#endif
+}
+
+// mirrors the mask vertically, so the first rank becomes the eighth rank
+inline mask flip_vertical( const mask& m ) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_bswap64(m);
+#else
+    mask flipped = 0;
+    for ( int32_t rank = 0; rank < 8; rank++ ) flipped |= ( ( m >> ( 8*rank ) ) & RANK_1 ) << ( 8*( 7 - rank ) );
+    return flipped;
+#endif
+}
+
+// removes the lowest set bit and returns its index
+inline int32_t pop_lsb( mask& m ) noexcept
+{
+    int32_t index = lsb(m);
+    m &= m - 1;
+    return index;
+}
+
+
+
+// all the attack masks that don't depend on the other pieces are calculated at compile time.
+struct attack_tables
+{
+    std::array<mask, 64> knight{};
+    std::array<mask, 64> king{};
+    std::array<std::array<mask, 64>, 2> pawn{}; // indexed by the color of the attacking pawn
+    std::array<std::array<mask, 64>, DIRECTION_COUNT> rays{};
+    std::array<std::array<mask, 64>, 64> between{}; // the squares strictly between 2 aligned squares
+};
+
+
+constexpr attack_tables make_attack_tables() noexcept
+{
+    attack_tables tables{};
+
+    constexpr int32_t knight_x[8] = { 1, 2, 2, 1, -1, -2, -2, -1 };
+    constexpr int32_t knight_y[8] = { 2, 1, -1, -2, -2, -1, 1, 2 };
+
+    for ( int32_t square = 0; square < 64; square++ ) {
+        int32_t x = file_of(square);
+        int32_t y = rank_of(square);
+
+        for ( int32_t i = 0; i < 8; i++ ) {
+            if ( on_board( x + knight_x[i], y + knight_y[i] ) ) {
+                tables.knight[square] |= square_bit( make_square( x + knight_x[i], y + knight_y[i] ) );
+            }
+
+            if ( on_board( x + direction_x[i], y + direction_y[i] ) ) {
+                tables.king[square] |= square_bit( make_square( x + direction_x[i], y + direction_y[i] ) );
+            }
+        }
+
+        for ( int32_t dx = -1; dx <= 1; dx += 2 ) {
+            if ( on_board( x + dx, y + 1 ) ) tables.pawn[0][square] |= square_bit( make_square( x + dx, y + 1 ) );
+            if ( on_board( x + dx, y - 1 ) ) tables.pawn[1][square] |= square_bit( make_square( x + dx, y - 1 ) );
+        }
+
+        for ( int32_t dir = 0; dir < DIRECTION_COUNT; dir++ ) {
+            int32_t x1 = x + direction_x[dir];
+            int32_t y1 = y + direction_y[dir];
+            mask passed = 0;
+
+            while ( on_board( x1, y1 ) ) {
+                int32_t target = make_square(x1, y1);
+
+                tables.rays[dir][square] |= square_bit(target);
+                tables.between[square][target] = passed;
+                passed |= square_bit(target);
+
+                x1 += direction_x[dir];
+                y1 += direction_y[dir];
+            }
+        }
+    }
+
+    return tables;
+}
+
+inline constexpr attack_tables tables = make_attack_tables();
+
+
+
+// returns the squares that a slider attacks in one direction, the ray stops at the first blocker.
+inline mask ray_attacks( const int32_t& dir, const int32_t& square, const mask& occupied ) noexcept
+{
+    mask attacks = tables.rays[dir][square];
+    mask blockers = attacks & occupied;
+
+    if ( blockers ) {
+        int32_t first = ( dir < SOUTH ) ? lsb(blockers) : msb(blockers);
+        attacks ^= tables.rays[dir][first];
+    }
+
+    return attacks;
+}
+
+inline mask rook_attacks( const int32_t& square, const mask& occupied ) noexcept
+{
+    return ray_attacks(NORTH, square, occupied) | ray_attacks(EAST, square, occupied) |
+           ray_attacks(SOUTH, square, occupied) | ray_attacks(WEST, square, occupied);
+}
+
+inline mask bishop_attacks( const int32_t& square, const mask& occupied ) noexcept
+{
+    return ray_attacks(NORTH_EAST, square, occupied) | ray_attacks(NORTH_WEST, square, occupied) |
+           ray_attacks(SOUTH_EAST, square, occupied) | ray_attacks(SOUTH_WEST, square, occupied);
+}
+
+inline mask queen_attacks( const int32_t& square, const mask& occupied ) noexcept
+{
+    return rook_attacks(square, occupied) | bishop_attacks(square, occupied);
+}
+
+inline mask between( const int32_t& a, const int32_t& b ) noexcept
+{
+    return tables.between[a][b];
+}
+
+}
+
+#endif
@@ -6,14 +6,18 @@
 #include <iostream>
 #include <algorithm>
 #include <cstdint>
-#include <random>
-#include <functional>
 #include <unordered_set>
 #include <chrono> 
+#include <functional>
 
 #include "chess_piece.hpp"
 #include "square.hpp"
 #include "helper_tools.hpp"
+#include "position.hpp"
+#include "evaluation.hpp"
+#include "chess960.hpp"
+#include "epoch.hpp"
+#include "board_mask.hpp"
 
 // because our namespace members are fairly unique, there wont be any namespace errors when doing this
 using helper::chess_letters;
@@ -29,9 +33,64 @@ typedef std::unique_ptr< helper::coordinates<int64_t> > coordinate_ptr;
 
 
 
-// Base class that handles the semantics of a chessboard in the backend.
-class Board 
+// the undo record of Position together with the first move flags of the pieces, the Board needs them for castling and double pawn pushes
+struct BoardUndo
+{
+    UndoRecord position;
+    bool piece_unmoved = false;
+    bool captured_unmoved = false;
+    bool rook_unmoved = false; // the rook of a castling move
+};
+
+
+// the state of the game after a committed move. It's calculated once per move, so the renderer and
+// the text panel can read it without running any chess logic.
+struct GameStatus
+{
+    Move last_move;
+    std::array<uint8_t, 2> king_squares = { bitboard::NO_SQUARE, bitboard::NO_SQUARE }; // indexed by the color_id
+    uint8_t side_to_move = WHITE;
+    uint8_t checked = 0; // bit per color_id
+    bool checkmate = false;
+    bool stalemate = false;
+    uint16_t legal_move_count = 0;
+    std::array<uint64_t, 2> hanging = { 0, 0 }; // the pieces that the other side wins material on, indexed by the color_id
+    bool known_draw = false; // a draw with best play, the game can be adjudicated. Only king and pawn against king is known
+    int8_t known_winner = -1; // the color_id that wins with best play, or -1
+
+    inline bool in_check( const uint32_t& color_id ) const noexcept { return ( checked >> color_id ) & 1; }
+    inline bool game_over() const noexcept { return checkmate || stalemate; }
+};
+
+
+// an immutable copy of the board that is published after every committed move
+struct BoardSnapshot
 {
+    Position position;
+    GameStatus status;
+    uint64_t version = 0; // grows by one with every published snapshot
+    MoveList legal_moves; // the legal moves of the position, the board generates them once per move
+};
+
+
+
+/*
+ Base class that handles the semantics of a chessboard in the backend.
+ The size of the board is a template parameter, so every loop over the squares has a constant bound and
+ the masks of the board are a single 64-bit word on the normal 8x8 board and multiple words on bigger boards.
+ The bitboard Position, the snapshots and the undo records only exist for the normal 8x8 board.
+*/
+template<uint32_t Width, uint32_t Height = Width>
+class BasicBoard
+{
+    public:
+        typedef board_traits<Width, Height> traits;
+        typedef typename traits::mask mask_type;
+
+        static constexpr int64_t width = Width;
+        static constexpr int64_t height = Height;
+        static constexpr bool is_standard = ( Width == 8 && Height == 8 );
+
     private:
         // add some base initialisation values
         int32_t player_turn = WHITE;
@@ -47,12 +106,14 @@ class Board
         bool finished = false;
 
 
-        std::unordered_set<uint32_t> already_used; // well use this for when we shuffle around pieces (it's a special gamemode)
+        chess960::Random shuffle_random; // chooses the start positions of shuffled games, seed_shuffle() makes them reproducible
 
-        // we will create a 8x8 board into this container ( NOTE: you can specify a custom board size, but the pieces will be in the 1 to 8 squares )
+        // we will create a Width x Height board into this container ( NOTE: the pieces of the normal setup are placed on the first 8 files )
         std::vector< std::vector< std::shared_ptr<Square> >> all_squares;
 
-        uint32_t board_length = 0; // we will use this member in the future if we want to create a game with different board sizes
+        // the squares that the pieces of each color attack, they are updated together with the attacked status of the squares
+        std::array< mask_type, 2 > attack_maps{};
+        mask_type occupied{};
 
         std::vector< std::vector<std::string> > all_captured_pieces; // this will hold all the capured pieces names separated by their color_id
 
@@ -64,17 +125,17 @@ class Board
 
         void end_game()
         {
-            if ( kings_in_checkmate.empty() ) return;
+            if ( finished ) return;
 
             for ( const aString& color : kings_in_checkmate ) {
                 if ( color == "w" ) { 
                     score2++; 
-                    return;
+                    break;
                 }
 
                 else if ( color == "b" ) {
                     score1++;
-                    return;
+                    break;
                 }
             }
 
@@ -83,17 +144,11 @@ class Board
         }
 
 
-        Board() : all_squares(8, std::vector< std::shared_ptr<Square>>(8) ), board_length(8), all_captured_pieces(2)
+        BasicBoard() : all_squares(Width, std::vector< std::shared_ptr<Square>>(Height) ), all_captured_pieces(2)
         {
             this->create_board();
-            this->already_used.reserve(32);
-        }
-
-        // for custom size board
-        Board(uint32_t size) : all_squares(size, std::vector< std::shared_ptr<Square>>(size) ), board_length(size), all_captured_pieces(2)
-        {
-            this->create_board();
-            this->already_used.reserve(32);
+            this->shuffle_random.seed( std::chrono::system_clock::now().time_since_epoch().count() );
+            this->publish_snapshot( Move() );
         }
 
 
@@ -102,160 +157,99 @@ class Board
         {
 
 
+            static_assert( Width >= 8 && Height >= 4, "the normal setup needs 8 files and 4 ranks" );
+
             std::shared_ptr<Square> a_square;
+            constexpr size_t last = Height - 1; // the back rank of black
 
             // add all the pieces in their places onto the board
             // I dont use switch-statement to make the code clearer
-            for ( size_t i = 0; i < 8; i++ ) {
-                for ( size_t j = 0; j < 8; j++ ) {
+            for ( size_t i = 0; i < Width; i++ ) {
+                for ( size_t j = 0; j < Height; j++ ) {
                     a_square = all_squares[i][j];
                     a_square->remove_piece();
 
 
                     if ( j == 1 )  a_square->add_piece(std::make_shared<Pawn>("P", "w", WHITE));
-                    else if ( j == 6 ) a_square->add_piece(std::make_shared<Pawn>("P", "b", BLACK));
+                    else if ( j == last - 1 ) a_square->add_piece(std::make_shared<Pawn>("P", "b", BLACK));
 
                     else if ( (i == 0 || i == 7 ) && j == 0 )  a_square->add_piece(std::make_shared<Rook>("R", "w", WHITE));
-                    else if ( (i == 0 || i == 7 ) && j == 7 )  a_square->add_piece(std::make_shared<Rook>("R", "b", BLACK));
+                    else if ( (i == 0 || i == 7 ) && j == last )  a_square->add_piece(std::make_shared<Rook>("R", "b", BLACK));
 
                     else if ( (i == 1 || i == 6 ) && j == 0 )  a_square->add_piece(std::make_shared<Knight>("K", "w", WHITE));
-                    else if ( (i == 1 || i == 6 ) && j == 7 )  a_square->add_piece(std::make_shared<Knight>("K", "b", BLACK));
+                    else if ( (i == 1 || i == 6 ) && j == last )  a_square->add_piece(std::make_shared<Knight>("K", "b", BLACK));
 
                     else if ( (i == 2 || i == 5 ) && j == 0 )  a_square->add_piece(std::make_shared<Bishop>("B", "w", WHITE));
-                    else if ( (i == 2 || i == 5 ) && j == 7 )  a_square->add_piece(std::make_shared<Bishop>("B", "b", BLACK));
+                    else if ( (i == 2 || i == 5 ) && j == last )  a_square->add_piece(std::make_shared<Bishop>("B", "b", BLACK));
 
                     else if ( i == 3 && j == 0 )  a_square->add_piece(std::make_shared<Queen>("Q", "w", WHITE));
-                    else if ( i == 3 && j == 7 )  a_square->add_piece(std::make_shared<Queen>("Q", "b", BLACK));
+                    else if ( i == 3 && j == last )  a_square->add_piece(std::make_shared<Queen>("Q", "b", BLACK));
 
                     else if ( i == 4 && j == 0 )  a_square->add_piece(std::make_shared<King>("K", "w", WHITE));
-                    else if ( i == 4 && j == 7 )  a_square->add_piece(std::make_shared<King>("K", "b", BLACK));
+                    else if ( i == 4 && j == last )  a_square->add_piece(std::make_shared<King>("K", "b", BLACK));
                 }
             }
 
+            player_turn = WHITE;
+            update_attacked_squares();
+
+            committed = to_position();
+            publish_snapshot( Move() );
 
             return;
         }
 
 
 
-        // this method add the chess pieces into random starting positions, except the pawns.
+        // this method add the chess pieces into a random shuffled starting position, the pawns stay in their normal places.
         void add_shuffled_pieces()
         {
-            std::shared_ptr<Square> a_square;
+            setup_chess960( shuffle_random.next_id() );
+        }
 
+        // the next shuffled games get the same start positions every time the same seed is given
+        void seed_shuffle( const uint64_t& seed ) noexcept
+        {
+            shuffle_random.seed(seed);
+        }
 
-            // add all the pieces in their places onto the board
-            // I dont use switch-statement to make the code clearer
-            for ( size_t i = 0; i < 8; i++ ) {
-                for ( size_t j = 0; j < 8; j++ ) {
-                    a_square = all_squares[i][j];
-                    a_square->remove_piece();
-                }
-            }
-            
 
+        /**
+         * @brief Sets up one of the 960 starting positions of shuffled chess. The back rank is read from
+         * a table that was calculated at compile time, so this doesn't need any retries.
+         * @param id the Scharnagl number of the position, 518 is the normal starting position
+         */
+        void setup_chess960( const uint32_t& id )
+        {
+            static_assert( Width >= 8 && Height >= 4, "the shuffled setups need 8 files and 4 ranks" );
 
-            // add all the pieces in their places onto the board
-            for ( size_t i = 0; i < 8; i++ ) {
-                a_square = all_squares[i][1];
-                
-                a_square->add_piece(std::make_shared<Pawn>("P", "w", WHITE));
-            }
+            const chess960::arrangement& rank = chess960::back_rank(id);
 
+            for ( size_t i = 0; i < Width; i++ ) {
+                for ( size_t j = 0; j < Height; j++ ) {
+                    all_squares[i][j]->remove_piece();
+                }
+            }
 
             for ( size_t i = 0; i < 8; i++ ) {
-                a_square = all_squares[i][6];
-                
-                a_square->add_piece(std::make_shared<Pawn>("P", "b", BLACK));
+                all_squares[i][0]->add_piece( make_board_piece( rank[i], WHITE ) );
+                all_squares[i][1]->add_piece( make_board_piece( PAWN, WHITE ) );
+                all_squares[i][Height - 2]->add_piece( make_board_piece( PAWN, BLACK ) );
+                all_squares[i][Height - 1]->add_piece( make_board_piece( rank[i], BLACK ) );
             }
 
-
-
-            // add the white rooks
-            add_specific_piece(std::make_shared<Rook>("R", "w", WHITE), 2, {0, 0}, {board_length, 0});
-
-            // add the white knights
-            add_specific_piece(std::make_shared<Knight>("K", "w", WHITE), 2, {0, 0}, {board_length, 0});
-
-            // add the white bishops
-            add_specific_piece(std::make_shared<Bishop>("B", "w", WHITE), 2, {0, 0}, {board_length, 0});
-
-            // add the white queen
-            add_specific_piece(std::make_shared<Queen>("Q", "w", WHITE), 1, {0, 0}, {board_length, 0});
-
-            // add the white king
-            add_specific_piece(std::make_shared<King>("K", "w", WHITE), 1, {0, 0}, {board_length, 0});
-
-            already_used.clear();
-            already_used.reserve(16);
-
-            // add the black rooks
-            add_specific_piece(std::make_shared<Rook>("R", "b", BLACK), 2, {0, 7}, {board_length, 7});
-
-            // add the black knights
-            add_specific_piece(std::make_shared<Knight>("K", "b", BLACK), 2, {0, 7}, {board_length, 7});
-
-            // add the black bishops
-            add_specific_piece(std::make_shared<Bishop>("B", "b", BLACK), 2, {0, 7}, {board_length, 7});
-
-            // add the black queen
-            add_specific_piece(std::make_shared<Queen>("Q", "b", BLACK), 1, {0, 7}, {board_length, 7});
-
-            // add the black king
-            add_specific_piece(std::make_shared<King>("K", "b", BLACK), 1, {0, 7}, {board_length, 7});
-
-            already_used.clear();
-            already_used.reserve(16);
-            
             player_turn = WHITE;
+            undo_record = BoardUndo();
 
+            if constexpr ( is_standard ) committed = chess960::start_position(id);
 
-            return;
-        }
-
-
-        // to simplify the add_shuffled_pieces() method, I created a new method that add a specific piece, 
-        // otherwise I would manually have to do this to every piece
-        void add_specific_piece(sharedPiecePtr a_piece, const uint32_t& amount, const helper::coordinates<uint32_t>& start_range, const helper::coordinates<uint32_t>& end_range)
-        {
-            uint32_t i = 0;
-            uint32_t chosen = 0;
-            std::shared_ptr<Square> a_square;
-
-            // we ensure that the given range is in the given range of the board
-            uint32_t x0 = helper::clamp<uint32_t>(start_range.x, 0, board_length-1);
-            //int32_t y0 = clamp<int32_t>(start_range.y, 0, board_length-1);
-            uint32_t x1 = helper::clamp<uint32_t>(end_range.x, 0, board_length-1);
-            uint32_t y1 = helper::clamp<uint32_t>(end_range.y, 0, board_length-1);
-
-            std::default_random_engine generator;
-            generator.seed(std::chrono::system_clock::now().time_since_epoch().count()); // give our generator a random seed
-
-            std::uniform_int_distribution<uint32_t> distribution(x0,x1);
-
-            auto random_num = std::bind( distribution, generator );  // bind the generator to the distribution object
-
-            
-
-            while ( i < amount ) {
-                chosen = random_num();
-                a_square = all_squares[chosen][y1]; // get square
-
-                // check that the chosen square is not already used by a different piece
-                if ( already_used.count(chosen) == 0 ) {
-                    a_square->add_piece(a_piece);
-                    already_used.insert(chosen);
-                    i++;
-                }   
-            }
-
-
+            update_attacked_squares();
+            publish_snapshot( Move() );
 
             return;
         }
 
 
-        
         // create a new board
         void create_board() 
         {
@@ -275,8 +269,8 @@ class Board
             int cycle = 0;
 
             // with this nested loop we create all the squares
-            for ( size_t i = 0; i < this->board_length; i++ ) {
-                for ( size_t j = 0; j < this->board_length; j++ ) {
+            for ( size_t i = 0; i < Width; i++ ) {
+                for ( size_t j = 0; j < Height; j++ ) {
 
                     // here we use normal initialisation because if we use std::make_shared the objects
                     // wont be deleted until all the weak pointers go out of scope.
@@ -321,6 +315,11 @@ class Board
         }
 
 
+        static constexpr bool on_board( const helper::coordinates<int64_t>& a ) noexcept
+        {
+            return traits::on_board( a.x, a.y );
+        }
+
         std::weak_ptr<Square> get_square( helper::coordinates<int64_t> location )
         {
             return all_squares[static_cast<size_t>( location.x )][static_cast<size_t>( location.y )];
@@ -335,15 +334,15 @@ class Board
         // to get the corresponding square
         helper::coordinates<int64_t> convert_pos( const int& x, const int& y, const int64_t& screen_width, const int64_t& screen_height, bool use_clamp = true ) noexcept
         {
-            int square_width = screen_width/8;
-            int square_height = screen_height/8;
+            int square_width = screen_width/Width;
+            int square_height = screen_height/Height;
 
             int x1 = x/square_width;
             int y1 = y/square_height;
 
             if ( use_clamp ) {
-                x1 = helper::clamp<int32_t>(x1, 0, 7);
-                y1 = helper::clamp<int32_t>(y1, 0, 7);
+                x1 = helper::clamp<int32_t>(x1, 0, Width-1);
+                y1 = helper::clamp<int32_t>(y1, 0, Height-1);
             }
 
 
@@ -362,89 +361,299 @@ class Board
         // this method calls true, if the piece could be moved, and false if the piece couldn't be moved
         bool move_piece( std::weak_ptr<Square> orig, std::weak_ptr<Square> target ) noexcept
         {
-            if ( orig.expired() || target.expired() ) return false;
+            if ( orig.expired() || target.expired() || orig.lock()->get_piece().expired() ) return false;
 
-            if ( this->player_turn != orig.lock()->get_piece().lock()->tell_color_id() ) {
+            // we look up the same move in the bitboard position before the squares change, a move that it knows
+            // is played with play_move(), which also handles en passant and castling
+            Move a_move = find_move( orig.lock()->coordinates(), target.lock()->coordinates() );
+            if ( !a_move.is_null() ) return play_move(a_move);
+
+            record_undo(a_move);
+
+            if ( !commit_move( orig, target, ( a_move.is_promotion() ) ? a_move.promotion_piece() : 0 ) ) {
                 return false;
             }
 
+            sync_position(a_move);
 
-            orig.lock()->get_piece().lock()->moved();
+            return true;
+        }
 
-            // in the same line we remove a chess piece from the old square and add it in the new one.
-            sharedPiecePtr removed_piece = target.lock()->add_piece( orig.lock()->remove_piece() );
 
+        /**
+         * @brief Executes a move that uses the packed Move encoding of Position, this way code that doesn't
+         * know about the squares ( the search, a server or a replayed game ) can move the pieces.
+         * The move has to be legal in position(), this method doesn't validate it again.
+         */
+        bool play_move( const Move& a_move ) noexcept
+        {
+            helper::coordinates<int64_t> from{ bitboard::file_of( a_move.from() ), bitboard::rank_of( a_move.from() ) };
+            helper::coordinates<int64_t> to{ bitboard::file_of( a_move.to() ), bitboard::rank_of( a_move.to() ) };
 
-            if ( removed_piece ) {
-                all_captured_pieces[ target.lock()->get_piece().lock()->tell_color_id() ].push_back( removed_piece->tell_name() );
+            if ( a_move.is_castling() ) {
+                return king_rook_move( get_square(from), get_square(to), ( a_move.flags() == KING_SIDE_CASTLE ) ? 2 : -2 );
             }
 
+            record_undo(a_move);
 
-            update_attacked_squares();
-            update_check();
-            update_checkmate();
-            
+            // the pawn that is captured en passant isn't on the target square, so we remove it separately
+            if ( a_move.is_en_passant() ) {
+                sharedPiecePtr removed_piece = get_square( to.x, from.y ).lock()->remove_piece();
 
+                if ( removed_piece ) {
+                    all_captured_pieces[ player_turn ].push_back( removed_piece->tell_name() );
+                }
+            }
 
-            if ( ++this->player_turn == amount_of_players ) {
-                this->player_turn = WHITE;
+            if ( !commit_move( get_square(from), get_square(to), ( a_move.is_promotion() ) ? a_move.promotion_piece() : 0 ) ) {
+                return false;
             }
 
+            sync_position(a_move);
+
             return true;
         }
 
 
+        // the undo record of the last committed move, a null move in it means that the move can't be taken back
+        const BoardUndo& last_undo() const noexcept
+        {
+            return this->undo_record;
+        }
+
         /**
-         * @brief this is a special case of Board::move_piece in which the king and castle change
-         * places. This method trusts that the Board::find_possible_tiles_to_move already validated the castling
-         * and it doesnt to the check again.
+         * @brief Takes back the last committed move. Only the squares that the move touched are changed,
+         * so this doesn't depend on the length of the game. The record has to be the last_undo() of that move.
          */
-        bool king_rook_move( std::weak_ptr<Square> orig, std::weak_ptr<Square> target, int64_t direction ) 
+        bool undo_move( const BoardUndo& record ) noexcept
         {
-            if ( orig.expired() || target.expired() ) return false;
+            const Move& a_move = record.position.move;
+            uint32_t mover = committed.side_to_move() ^ 1;
 
-            if ( this->player_turn != orig.lock()->get_piece().lock()->tell_color_id() ) {
-                return false;
+            helper::coordinates<int64_t> from{ bitboard::file_of( a_move.from() ), bitboard::rank_of( a_move.from() ) };
+            helper::coordinates<int64_t> to{ bitboard::file_of( a_move.to() ), bitboard::rank_of( a_move.to() ) };
+
+            if ( a_move.is_null() || get_square(to).lock()->get_piece().expired() ) return false;
+
+            // if the move ended the game, the game continues and the point is taken back
+            if ( finished ) {
+                for ( const aString& color : kings_in_checkmate ) {
+                    if ( color == "w" ) score2--;
+                    else if ( color == "b" ) score1--;
+                    break;
+                }
+
+                finished = false;
             }
 
-            sharedPiecePtr orig_piece = orig.lock()->get_piece().lock();
-            uint16_t color_id = orig_piece->tell_color_id();
+            sharedPiecePtr piece;
 
-            std::shared_ptr<Square> target_square; // the square that contains the rook that we'll move
+            if ( a_move.is_castling() ) {
+                uint32_t wing = ( a_move.flags() == KING_SIDE_CASTLE ) ? 0 : 1;
+                int32_t rook_square = committed.castling_rook( mover, wing );
 
-            if ( orig_piece->tell_id() != KING*pow(10, color_id ) ) {
-                return false;
+                sharedPiecePtr rook = get_square( ( wing == 0 ) ? 5 : 3, to.y ).lock()->remove_piece();
+                piece = get_square(to).lock()->remove_piece();
+
+                if ( record.rook_unmoved ) rook->reset_moved();
+                get_square( bitboard::file_of(rook_square), to.y ).lock()->add_piece(rook);
+            }
+
+            else {
+                piece = get_square(to).lock()->remove_piece();
+
+                if ( a_move.is_promotion() ) {
+                    piece = make_board_piece( PAWN, static_cast<uint16_t>(mover) );
+                    piece->moved();
+                }
+
+                if ( record.position.captured ) {
+                    sharedPiecePtr captured = make_board_piece( piece_type(record.position.captured), piece_color(record.position.captured) );
+                    if ( !record.captured_unmoved ) captured->moved();
+
+                    get_square( to.x, ( a_move.is_en_passant() ) ? from.y : to.y ).lock()->add_piece(captured);
+
+                    if ( !all_captured_pieces[mover].empty() ) all_captured_pieces[mover].pop_back();
+                }
+            }
+
+            if ( record.piece_unmoved ) piece->reset_moved();
+            get_square(from).lock()->add_piece(piece);
+
+            update_attacked_squares();
+            update_check();
+            update_checkmate();
+
+            player_turn = static_cast<int32_t>(mover);
+
+            committed.undo(record.position);
+            undo_record = BoardUndo();
+            publish_snapshot( Move() );
+
+            return true;
+        }
+
+
+        // returns the bitboard Position of the last committed move
+        const Position& position() const noexcept
+        {
+            return this->committed;
+        }
+
+        // returns the status of position(), the same one that the latest snapshot has
+        const GameStatus& status() const noexcept
+        {
+            return this->committed_status;
+        }
+
+        // returns the legal moves of position(), they are generated once after every committed move
+        const MoveList& legal_moves() const noexcept
+        {
+            return this->committed_moves;
+        }
+
+        // returns the legal moves of position() grouped by the origin square and the mobility of both colors.
+        // The map is built from legal_moves() the first time it's asked for after a move, so a move doesn't pay for it.
+        const LegalMoveMap& legal_move_map() const noexcept
+        {
+            if ( !map_ready ) {
+                committed_map = committed.legal_move_map(committed_moves);
+                map_ready = true;
             }
 
-            if ( direction == 2 ) {
-                target_square = get_square( 7, orig.lock()->coordinates().y ).lock();
+            return this->committed_map;
+        }
+
+
+        /**
+         * @brief Turns the moves of the piece on the square into the vectors that the gui uses. Like king_castling(),
+         * a king that moves less than 2 squares when castling points to its rook instead.
+         * @param map the legal move map of the position
+         */
+        static std::vector< helper::coordinates<int64_t> > map_vectors( const LegalMoveMap& map, const Position& position, const helper::coordinates<int64_t>& current )
+        {
+            std::vector< helper::coordinates<int64_t> > vectors;
+            if ( !bitboard::on_board( static_cast<int32_t>(current.x), static_cast<int32_t>(current.y) ) ) return vectors;
+
+            int32_t from = bitboard::make_square( static_cast<int32_t>(current.x), static_cast<int32_t>(current.y) );
+            mask targets = map.targets[from];
+
+            vectors.reserve( map.target_count(from) + 2 );
+
+            while ( targets ) {
+                int32_t to = bitboard::pop_lsb(targets);
+                vectors.push_back( helper::coordinates<int64_t>{ bitboard::file_of(to) - current.x, bitboard::rank_of(to) - current.y } );
             }
 
-            else if ( direction == -2 ) {
-                target_square = get_square( 0, orig.lock()->coordinates().y ).lock();
+            if ( from != map.king_square ) return vectors;
+
+            mask castling = map.castling;
+
+            while ( castling ) {
+                int32_t to = bitboard::pop_lsb(castling);
+                int64_t king_move = bitboard::file_of(to) - current.x;
+
+                if ( king_move >= 2 || king_move <= -2 ) {
+                    vectors.push_back( helper::coordinates<int64_t>{ king_move, 0 } );
+                }
+                else {
+                    int32_t rook = position.castling_rook( position.side_to_move(), ( bitboard::file_of(to) == 6 ) ? 0 : 1 );
+                    vectors.push_back( helper::coordinates<int64_t>{ bitboard::file_of(rook) - current.x, 0 } );
+                }
             }
 
+            return vectors;
+        }
+
+        /**
+         * @brief Returns the latest published snapshot of the board. Reading it doesn't take any locks
+         * and the snapshot stays unchanged while the returned reader exists, even if moves are played meanwhile.
+         * This is what the renderer and other threads should read instead of the squares.
+         */
+        SnapshotCell<BoardSnapshot>::Reader snapshot() const
+        {
+            return this->snapshots.read();
+        }
+
+        /**
+         * @brief Sets a function that is called with every snapshot that the board publishes, on the thread that changed
+         * the board. An empty function removes it, the hook can be changed while another thread plays moves.
+         */
+        void set_publish_hook( std::function<void( const BoardSnapshot& )> hook )
+        {
+            std::shared_ptr< const std::function<void( const BoardSnapshot& )> > stored;
+            if ( hook ) stored = std::make_shared< const std::function<void( const BoardSnapshot& )> >( std::move(hook) );
+
+            std::atomic_store( &publish_hook, stored );
+        }
+
 
-            if ( !target_square ) {
+        /**
+         * @brief this is a special case of Board::move_piece in which the king and castle change
+         * places. The castling is looked up from the legal moves of position(), which also knows where the rooks of
+         * a shuffled starting position are, so only the side matters: a positive direction castles on the king side.
+         */
+        bool king_rook_move( std::weak_ptr<Square> orig, std::weak_ptr<Square> target, int64_t direction ) 
+        {
+            if ( orig.expired() || target.expired() || orig.lock()->get_piece().expired() || direction == 0 ) return false;
+
+            sharedPiecePtr king = orig.lock()->get_piece().lock();
+            uint16_t color_id = king->tell_color_id();
+
+            if ( this->player_turn != color_id || king->tell_id() != KING*pow(10, color_id) ) {
                 return false;
             }
 
+            uint32_t wing = ( direction > 0 ) ? 0 : 1;
+            int64_t y = orig.lock()->coordinates().y;
+            int64_t king_x = ( wing == 0 ) ? width - 2 : 2;
+            int64_t rook_x = -1;
+            Move castling_move;
 
+            if constexpr ( is_standard ) {
+                int32_t king_square = bitboard::make_square( static_cast<int32_t>( orig.lock()->coordinates().x ), static_cast<int32_t>(y) );
 
-            orig.lock()->get_piece().lock()->moved();
+                for ( const Move& a_move : committed_moves ) {
+                    if ( a_move.from() == king_square && a_move.flags() == ( ( wing == 0 ) ? KING_SIDE_CASTLE : QUEEN_SIDE_CASTLE ) ) {
+                        castling_move = a_move;
+                    }
+                }
 
+                if ( castling_move.is_null() ) return false;
 
+                rook_x = bitboard::file_of( committed.castling_rook( color_id, wing ) );
+            }
 
-            sharedPiecePtr removed_piece = target.lock()->add_piece( orig.lock()->remove_piece() );
-            helper::coordinates<int64_t> king_coords = target.lock()->coordinates(); // the kings coords
+            else {
+                // a bigger board has no Position, so the rook is searched like king_castling() does, the furthest unmoved one
+                int64_t step = ( wing == 0 ) ? 1 : -1;
 
-            // if the rook is at x = 7, well move it to king direction - 1, if its at x = 0, then to king_dir + 1
-            int64_t rook_dir = ( direction < 0 ) ? 1 : -1;
+                for ( int64_t x = orig.lock()->coordinates().x + step; traits::on_board(x, y); x += step ) {
+                    sharedPiecePtr a_piece = get_square(x, y).lock()->get_piece().lock();
 
-            // now we move the rook
-            return move_piece( target_square, get_square( king_coords.x + rook_dir, king_coords.y ) );
+                    if ( a_piece && a_piece->tell_id() == ROOK*pow(10, color_id) && !a_piece->has_moved() ) rook_x = x;
+                }
 
-            //return true;
+                if ( rook_x < 0 || king->has_moved() ) return false;
+            }
+
+            record_undo(castling_move);
+
+            // we first remove both pieces, because in shuffled games the king can land on the rooks square
+            sharedPiecePtr rook = get_square( rook_x, y ).lock()->remove_piece();
+            orig.lock()->remove_piece();
+
+            king->moved();
+            rook->moved();
+
+            // the rook ends up next to the king, on the side of the center
+            get_square( king_x, y ).lock()->add_piece(king);
+            get_square( king_x + ( ( wing == 0 ) ? -1 : 1 ), y ).lock()->add_piece(rook);
+
+            end_turn();
+            sync_position(castling_move);
+
+            return true;
         }
 
 
@@ -473,8 +682,8 @@ class Board
             king_pos.reserve(2); // usually theres 2 kings, so we optimise,
             // if theres more kings, the push_back method will increase the size.
 
-            for ( size_t i = 0; i < 8; i++ ) {
-                for ( size_t j = 0; j < 8; j++ ) {
+            for ( size_t i = 0; i < Width; i++ ) {
+                for ( size_t j = 0; j < Height; j++ ) {
                     a_square_ptr = all_squares[i][j];
 
                     // first we check that the square contains a piece
@@ -500,7 +709,7 @@ class Board
          */
         bool has_piece( const helper::coordinates<int64_t>& a ) noexcept
         {   
-            if ( a.x >= 0 && a.x < 7 && a.y >= 0 && a.y < 7 ) {
+            if ( on_board(a) ) {
                 return all_squares[static_cast<size_t>( a.x )][static_cast<size_t>( a.y )]->has_piece();
             }
 
@@ -553,7 +762,7 @@ class Board
                 aux = aux0 + vector;
 
                 // if the move is not out of bounds, we add it.
-                if ( aux.x < 0 || aux.x >= this->board_length || aux.y < 0 || aux.y >= this->board_length ) {
+                if ( !on_board(aux) ) {
                     directions_cannot_go.push_back( vector );
                     continue; // this ensures that we skip the parts from below so we dont have to use helper::clamp
                 }
@@ -596,7 +805,7 @@ class Board
                 is_same_direction = false;
                 
                 // if the move is not out of bounds, we add it.
-                if ( aux.x < 0 || aux.x >= this->board_length || aux.y < 0 || aux.y >= this->board_length ) {
+                if ( !on_board(aux) ) {
                     continue; // this ensures that we skip the parts from below so we dont have to use helper::clamp
                 }
 
@@ -658,7 +867,7 @@ class Board
             for ( helper::coordinates<int64_t>& basic : basic_moves ) {
                 aux = aux0 + basic;
 
-                a_square = get_square( helper::clamp<int>(aux.x, 0, 7), helper::clamp<int>(aux.y, 0, 7) ).lock();
+                a_square = get_square( helper::clamp<int64_t>(aux.x, 0, Width-1), helper::clamp<int64_t>(aux.y, 0, Height-1) ).lock();
 
                 if ( a_square->has_piece() ) {
                     break;
@@ -673,7 +882,10 @@ class Board
             for ( helper::coordinates<int64_t>& attack : attacking_moves) {
                 aux = aux0 + attack;
 
-                attacked_square = get_square( helper::clamp<int64_t>(aux.x, 0, 7), helper::clamp<int64_t>(aux.y, 0, 7) ).lock();
+                // a pawn on the edge file can only capture to one side
+                if ( !on_board(aux) ) continue;
+
+                attacked_square = get_square( aux.x, aux.y ).lock();
 
                 if ( attacked_square->has_piece() ) {
                     if ( color != attacked_square->get_piece().lock()->tell_color()) {
@@ -691,30 +903,33 @@ class Board
 
         /*
          this methods updates every squares variable that
-         we will use in the is_check method to check whether the king is in check
+         we will use in the is_check method to check whether the king is in check.
+         The attack maps and the occupied mask are filled in the same pass.
         */
         void update_attacked_squares()
         {   
-            Square a_square;
             helper::coordinates<int64_t> aux;
 
-            for ( size_t i = 0; i < 8; i++ ) {
-                for ( size_t j = 0; j < 8; j++ ) {
-                    a_square = *all_squares[i][j];
-                    aux = a_square.coordinates();
-                    this->get_square(aux).lock()->change_attacked_status(false);
+            attack_maps = std::array< mask_type, 2 >{};
+            occupied = mask_type{};
+
+            for ( size_t i = 0; i < Width; i++ ) {
+                for ( size_t j = 0; j < Height; j++ ) {
+                    all_squares[i][j]->change_attacked_status(false);
                 }
             }
 
 
-            for ( size_t i = 0; i < 8; i++ ) {
-                for ( size_t j = 0; j < 8; j++ ) {
-                    a_square = *all_squares[i][j];
+            for ( size_t i = 0; i < Width; i++ ) {
+                for ( size_t j = 0; j < Height; j++ ) {
+                    Square& a_square = *all_squares[i][j];
 
                     // first we check that the square contains a piece
                     if ( a_square.get_piece().expired() ) {
                         continue;
                     }
+
+                    mask_ops::set( occupied, traits::index(i, j) );
                     
                     sharedPiecePtr a_piece = a_square.get_piece().lock();
 
@@ -728,6 +943,7 @@ class Board
                     }
 
                     aString color = a_piece->tell_color();
+                    mask_type& attack_map = attack_maps[ a_piece->tell_color_id() & 1 ];
 
 
                     // because the pawn doesnt attack with all of its moves, we have to create a special case for it.
@@ -739,8 +955,9 @@ class Board
                                 aux = aux + *move;
 
                                 // we have to clamp these into the acceptable range
-                                if ( aux.x >= 0 && aux.x <= 7 && aux.y >= 0 && aux.y <= 7 ) {
-                                    this->get_square(aux).lock()->change_attacked_status(color);
+                                if ( on_board(aux) ) {
+                                    all_squares[aux.x][aux.y]->change_attacked_status(color);
+                                    mask_ops::set( attack_map, traits::index(aux.x, aux.y) );
                                 }
 
                             }
@@ -763,8 +980,9 @@ class Board
                         aux = aux + move;
 
                         // we have to clamp these into the acceptable range
-                        if ( aux.x >= 0 && aux.x <= 7 && aux.y >= 0 && aux.y <= 7 ) {
-                            this->get_square(aux).lock()->change_attacked_status(color);
+                        if ( on_board(aux) ) {
+                            all_squares[aux.x][aux.y]->change_attacked_status(color);
+                            mask_ops::set( attack_map, traits::index(aux.x, aux.y) );
                         }
 
                     }
@@ -776,12 +994,80 @@ class Board
         }
 
 
+        // returns true if a piece of the given color attacks the square, this reads the attack maps of the last update_attacked_squares()
+        bool attacked_by( const int64_t& x, const int64_t& y, const uint16_t& color_id ) const noexcept
+        {
+            return traits::on_board(x, y) && mask_ops::test( attack_maps[ color_id & 1 ], traits::index(x, y) );
+        }
+
+        // the squares that contain a piece, also from the last update_attacked_squares()
+        const mask_type& occupied_squares() const noexcept
+        {
+            return occupied;
+        }
+
+
         // returns the names of captured pieces
         std::vector<aString> captured_pieces( const uint16_t& color_id ) { 
             return all_captured_pieces[ helper::clamp<size_t>( static_cast<size_t>(color_id), 0, all_captured_pieces.size()-1 ) ]; 
         }
 
 
+        /**
+         * @brief Creates a bitboard Position of the current board, so the faster backend code ( search, batch evaluation ) can work on it.
+         * Board doesn't store en passant squares, so the Position never has one. A king and a rook on the back rank
+         * that haven't moved give the castling right for that side.
+         */
+        Position to_position()
+        {
+            Position pos;
+            uint32_t rights = 0;
+            sharedPiecePtr a_piece;
+
+            // a bigger board doesn't fit into a Position
+            if constexpr ( !is_standard ) return pos;
+
+            for ( int32_t x = 0; x < 8; x++ ) {
+                for ( int32_t y = 0; y < 8; y++ ) {
+                    a_piece = all_squares[x][y]->get_piece().lock();
+
+                    if ( !a_piece ) continue;
+
+                    uint32_t color = a_piece->tell_color_id();
+                    uint32_t type = a_piece->tell_id() / static_cast<uint32_t>( pow(10, color) );
+
+                    pos.add_piece( bitboard::make_square(x, y), type, color );
+                }
+            }
+
+            for ( uint32_t color = WHITE; color <= BLACK; color++ ) {
+                int32_t king = pos.king_square(color);
+
+                if ( king == bitboard::NO_SQUARE || all_squares[ bitboard::file_of(king) ][ bitboard::rank_of(king) ]->get_piece().lock()->has_moved() ) {
+                    continue;
+                }
+
+                // an unmoved rook on the kings rank can castle, in shuffled games it isn't always in the corner.
+                // If a side has many of them, the one closest to the corner is used.
+                for ( int32_t x = 0; x < 8; x++ ) {
+                    a_piece = all_squares[x][ bitboard::rank_of(king) ]->get_piece().lock();
+
+                    if ( !a_piece || a_piece->has_moved() || a_piece->tell_id() != ROOK*pow(10, color) ) continue;
+
+                    uint32_t wing = ( x > bitboard::file_of(king) ) ? 0 : 1;
+                    if ( wing == 1 && ( rights >> ( color*2 + wing ) ) & 1 ) continue;
+
+                    pos.set_castling_rook( color, wing, bitboard::make_square( x, bitboard::rank_of(king) ) );
+                    rights |= 1 << ( color*2 + wing );
+                }
+            }
+
+            pos.set_state( static_cast<uint32_t>(player_turn), rights, -1, 0, 1 );
+
+            return pos;
+        }
+
+
         // these  methods will tell us if the king is in check.
         void update_check();
         void update_checkmate();
@@ -795,6 +1081,186 @@ class Board
         std::vector< helper::coordinates<int64_t> > doesnt_get_in_check( weakPiecePtr a_piece, helper::coordinates<int64_t> current);
 
     private:
+        // the bitboard version of the board, it's updated after every committed move
+        Position committed;
+        MoveList committed_moves;
+        GameStatus committed_status;
+        mutable LegalMoveMap committed_map;
+        mutable bool map_ready = false;
+        BoardUndo undo_record; // what the last committed move changed
+
+        SnapshotCell<BoardSnapshot> snapshots;
+        uint64_t snapshot_version = 0;
+        std::shared_ptr< const std::function<void( const BoardSnapshot& )> > publish_hook;
+
+
+        void publish_snapshot( const Move& last_move )
+        {
+            // the snapshots and the legal moves are made of Positions, so only the 8x8 board has them
+            if constexpr ( !is_standard ) return;
+
+            committed_moves.clear();
+            committed.generate_legal(committed_moves);
+            map_ready = false;
+
+            uint32_t side = committed.side_to_move();
+
+            committed_status = GameStatus();
+            committed_status.last_move = last_move;
+            committed_status.side_to_move = static_cast<uint8_t>(side);
+            committed_status.king_squares = { static_cast<uint8_t>( committed.king_square(WHITE) ), static_cast<uint8_t>( committed.king_square(BLACK) ) };
+            committed_status.checked = ( committed.in_check() ) ? static_cast<uint8_t>( 1 << side ) : 0;
+            committed_status.checkmate = committed_moves.empty() && committed_status.checked;
+            committed_status.stalemate = committed_moves.empty() && !committed_status.checked;
+            committed_status.legal_move_count = static_cast<uint16_t>( committed_moves.size() );
+            committed_status.hanging = { evaluation::hanging_pieces(committed, WHITE), evaluation::hanging_pieces(committed, BLACK) };
+
+            uint32_t strong_side;
+            bool win;
+
+            if ( kpk::probe(committed, strong_side, win) ) {
+                committed_status.known_draw = !win;
+                committed_status.known_winner = ( win ) ? static_cast<int8_t>(strong_side) : -1;
+            }
+
+            // the legal moves tell for sure whether the side to move got checkmated, so they replace what update_checkmate() guessed
+            kings_in_checkmate.clear();
+
+            if ( committed_status.checkmate ) {
+                kings_in_checkmate.insert( ( side == WHITE ) ? "w" : "b" );
+            }
+
+            BoardSnapshot published{ committed, committed_status, ++snapshot_version, committed_moves };
+            snapshots.publish(published);
+
+            std::shared_ptr< const std::function<void( const BoardSnapshot& )> > hook = std::atomic_load(&publish_hook);
+            if ( hook ) (*hook)(published);
+        }
+
+
+        // creates a new piece of the given type and color with the names that the board uses
+        static sharedPiecePtr make_board_piece( const uint32_t& type, const uint16_t& color_id )
+        {
+            aString color = ( color_id == WHITE ) ? "w" : "b";
+
+            switch ( type ) {
+                case KNIGHT: return std::make_shared<Knight>("K", color, color_id);
+                case BISHOP: return std::make_shared<Bishop>("B", color, color_id);
+                case ROOK: return std::make_shared<Rook>("R", color, color_id);
+                case QUEEN: return std::make_shared<Queen>("Q", color, color_id);
+                case KING: return std::make_shared<King>("K", color, color_id);
+                default: return std::make_shared<Pawn>("P", color, color_id);
+            }
+        }
+
+
+        // finds the legal move of the committed position between the 2 squares, a pawn that reaches
+        // the last rank is promoted into a queen. Returns a null move if the move isn't legal.
+        Move find_move( const helper::coordinates<int64_t>& from, const helper::coordinates<int64_t>& to ) const noexcept
+        {
+            if constexpr ( !is_standard ) return Move();
+
+            const MoveList& list = committed_moves;
+
+            int32_t from_square = bitboard::make_square( static_cast<int32_t>(from.x), static_cast<int32_t>(from.y) );
+            int32_t to_square = bitboard::make_square( static_cast<int32_t>(to.x), static_cast<int32_t>(to.y) );
+
+            for ( const Move& a_move : list ) {
+                if ( a_move.from() == from_square && a_move.to() == to_square &&
+                    ( !a_move.is_promotion() || a_move.promotion_piece() == QUEEN ) ) {
+                    return a_move;
+                }
+            }
+
+            return Move();
+        }
+
+
+        // stores what the move is going to change, before the squares change
+        void record_undo( const Move& a_move ) noexcept
+        {
+            undo_record = BoardUndo();
+            if ( a_move.is_null() || !is_standard ) return;
+
+            undo_record.position = committed.undo_record(a_move);
+
+            auto unmoved = [this]( const int32_t& square ) {
+                sharedPiecePtr a_piece = all_squares[ bitboard::file_of(square) ][ bitboard::rank_of(square) ]->get_piece().lock();
+                return a_piece && !a_piece->has_moved();
+            };
+
+            undo_record.piece_unmoved = unmoved( a_move.from() );
+
+            if ( a_move.is_castling() ) {
+                uint32_t wing = ( a_move.flags() == KING_SIDE_CASTLE ) ? 0 : 1;
+                undo_record.rook_unmoved = unmoved( committed.castling_rook( committed.side_to_move(), wing ) );
+            }
+
+            else if ( a_move.is_capture() && !a_move.is_en_passant() ) {
+                undo_record.captured_unmoved = unmoved( a_move.to() );
+            }
+        }
+
+
+        // updates the committed position after a move, if the board did a move that the position doesn't know,
+        // the position is rebuilt from the squares.
+        void sync_position( const Move& a_move ) noexcept
+        {
+            if constexpr ( !is_standard ) return;
+
+            if ( a_move.is_null() ) committed = to_position();
+            else committed.play(a_move);
+
+            publish_snapshot(a_move);
+        }
+
+
+        // moves the piece between the squares, promotes it if needed and passes the turn to the next player.
+        bool commit_move( std::weak_ptr<Square> orig, std::weak_ptr<Square> target, const uint32_t& promotion ) noexcept
+        {
+            if ( orig.expired() || target.expired() || orig.lock()->get_piece().expired() ) return false;
+
+            if ( this->player_turn != orig.lock()->get_piece().lock()->tell_color_id() ) {
+                return false;
+            }
+
+
+            orig.lock()->get_piece().lock()->moved();
+
+            // in the same line we remove a chess piece from the old square and add it in the new one.
+            sharedPiecePtr removed_piece = target.lock()->add_piece( orig.lock()->remove_piece() );
+
+
+            if ( removed_piece ) {
+                all_captured_pieces[ target.lock()->get_piece().lock()->tell_color_id() ].push_back( removed_piece->tell_name() );
+            }
+
+            if ( promotion ) {
+                sharedPiecePtr promoted = make_board_piece( promotion, target.lock()->get_piece().lock()->tell_color_id() );
+                promoted->moved();
+                target.lock()->add_piece(promoted);
+            }
+
+
+            end_turn();
+
+            return true;
+        }
+
+
+        // updates the attacks and checks after the pieces have moved and passes the turn to the next player.
+        void end_turn()
+        {
+            update_attacked_squares();
+            update_check();
+            update_checkmate();
+
+            if ( ++this->player_turn == amount_of_players ) {
+                this->player_turn = WHITE;
+            }
+        }
+
+
         // with this method we'll check if the king can castle
         template<typename T>
         inline std::vector< helper::coordinates<T> > king_castling( helper::coordinates<T> current, sharedPiecePtr a_piece );
@@ -807,7 +1273,8 @@ class Board
 
 
 
-inline void Board::update_check()
+template<uint32_t Width, uint32_t Height>
+inline void BasicBoard<Width, Height>::update_check()
 {   
     std::vector< coordinate_ptr > king_coords = this->find_kings();
     this->kings_in_check.clear();
@@ -843,7 +1310,8 @@ inline void Board::update_check()
  We check if a king of certain color is in check. 
  We need this for example when white tries to move a pawn but the white king is in check.
 */
-bool Board::is_check( const aString& color_to_check )
+template<uint32_t Width, uint32_t Height>
+bool BasicBoard<Width, Height>::is_check( const aString& color_to_check )
 {   
     update_check();
     return this->kings_in_check.count( color_to_check ) != 0;
@@ -852,7 +1320,8 @@ bool Board::is_check( const aString& color_to_check )
 
 
 
-inline void Board::update_checkmate()
+template<uint32_t Width, uint32_t Height>
+inline void BasicBoard<Width, Height>::update_checkmate()
 {
     std::vector< coordinate_ptr > king_coords = this->find_kings();
     this->kings_in_checkmate.clear();
@@ -900,7 +1369,8 @@ inline void Board::update_checkmate()
  We check if the game ends because a king is in checkmate.
  This method returns the color that checkmated the king, e.g the opponents color.
 */
-bool Board::is_checkmate( const aString& color_to_check )
+template<uint32_t Width, uint32_t Height>
+bool BasicBoard<Width, Height>::is_checkmate( const aString& color_to_check )
 {
     update_checkmate();
     return this->kings_in_checkmate.count( color_to_check ) != 0;
@@ -912,7 +1382,8 @@ bool Board::is_checkmate( const aString& color_to_check )
  * when the piece moves.
  * This method only returns the moves that don't get the pieces king in check.
 */
-std::vector< helper::coordinates<int64_t> > Board::doesnt_get_in_check(weakPiecePtr a_piece, helper::coordinates<int64_t> current_pos)
+template<uint32_t Width, uint32_t Height>
+std::vector< helper::coordinates<int64_t> > BasicBoard<Width, Height>::doesnt_get_in_check(weakPiecePtr a_piece, helper::coordinates<int64_t> current_pos)
 {   
     
     std::vector< helper::coordinates<int64_t> > possible_moves;
@@ -920,14 +1391,28 @@ std::vector< helper::coordinates<int64_t> > Board::doesnt_get_in_check(weakPiece
     sharedPiecePtr removed_piece;
     if ( a_piece.expired() ) return possible_moves;
 
+    // the 8x8 board already has every legal move in the legal move map, so the pieces don't have to be moved around
+    if constexpr ( is_standard ) {
+        return map_vectors( legal_move_map(), committed, current_pos );
+    }
+
     aString color_to_check = a_piece.lock()->tell_color();
     
 
     // filter out the places that the piece cannot go to
     filtered_moves = find_possible_tiles_to_move_to(current_pos, a_piece.lock());
 
+    // king_castling() already checked that the king doesn't go through check, and moving only the king
+    // onto its rook wouldn't tell anything, so the castling moves are accepted as they are.
+    std::vector< helper::coordinates<int64_t> > castling_moves = king_castling( current_pos, a_piece.lock() );
+
     for ( const helper::coordinates<int64_t>& vector : filtered_moves ) {
         helper::coordinates<int64_t> a_move = current_pos + vector;
+
+        if ( std::find( castling_moves.begin(), castling_moves.end(), vector ) != castling_moves.end() ) {
+            possible_moves.push_back(vector);
+            continue;
+        }
         removed_piece = get_square(a_move).lock()->get_piece().lock();
 
         base_move(get_square(current_pos), get_square(a_move));
@@ -956,8 +1441,9 @@ std::vector< helper::coordinates<int64_t> > Board::doesnt_get_in_check(weakPiece
 }
 
 // checks whether a piece that is checking the king right next to the king is protected by another piece
+template<uint32_t Width, uint32_t Height>
 template<typename T>
-inline bool Board::square_is_protected( helper::coordinates<T> current, sharedPiecePtr king )
+inline bool BasicBoard<Width, Height>::square_is_protected( helper::coordinates<T> current, sharedPiecePtr king )
 {
     bool return_val = false;
     sharedPiecePtr removed_piece;
@@ -990,91 +1476,85 @@ inline bool Board::square_is_protected( helper::coordinates<T> current, sharedPi
 
 
 
+template<uint32_t Width, uint32_t Height>
 template<typename T>
-inline std::vector< helper::coordinates<T> > Board::king_castling( helper::coordinates<T> current, sharedPiecePtr a_piece )
+inline std::vector< helper::coordinates<T> > BasicBoard<Width, Height>::king_castling( helper::coordinates<T> current, sharedPiecePtr a_piece )
 {
-    if ( !a_piece ) return std::vector< helper::coordinates<int64_t> >();
+    std::vector< helper::coordinates<T> > can_go;
 
-    if ( current.x < 0 || current.x > this->board_length || current.y < 0 || current.y > this->board_length ) {
-        return std::vector< coordinates<int64_t> >{};
+    if ( !a_piece ) return can_go;
+
+    if ( !on_board( helper::coordinates<int64_t>{ current.x, current.y } ) ) {
+        return can_go;
     }
 
-    uint32_t piece_id = a_piece->tell_id(); 
-    std::string_view color{ a_piece->tell_color() };
     uint16_t color_id = a_piece->tell_color_id();
+    aString color = a_piece->tell_color();
 
-    helper::coordinates<int64_t> aux;
+    // the king can only castle if it hasn't moved and isn't in check
+    if ( a_piece->tell_id() != KING*pow(10, color_id) || a_piece->has_moved() || this->kings_in_check.count(color) != 0 ) {
+        return can_go;
+    }
 
-    std::vector< helper::coordinates<int64_t> > castling_moves;
-    castling_moves.reserve(2); // we know that this will only contains at most 2 moves
+    can_go.reserve(2); // we know that the king can castle at most to 2 sides
 
-    std::vector< helper::coordinates<int64_t> > can_go;
-    can_go.reserve(2); // we also know that this will at most contains 2 moves
 
-    std::vector< helper::coordinates<int64_t> > directions_cannot_go;
-    directions_cannot_go.reserve(2);
+    // in shuffled games the king and the rooks can start on any file, but after castling
+    // the king is always on the g or c file and the rook next to it, on the side of the center.
+    for ( int64_t direction : { 1, -1 } ) {
+        int64_t rook_x = -1;
 
-    
-    // check if the king can castle
-    // first we check if the king is in his starting position,
-    // and then we check if his castles are in are in their starting positions.
-    if ( piece_id == KING*pow(10, color_id) && !a_piece->has_moved() && ( this->kings_in_check.count( a_piece->tell_color() ) == 0 ) ) {
-
-        // first check if there is a piece, then if the piece is a rook
-        if ( !( get_square( 0, current.y ).lock()->get_piece().expired() ) ) { 
-            if ( get_square( 0, current.y ).lock()->get_piece().lock()->tell_id() == ROOK*pow(10, color_id) &&
-                get_square( 0, current.y ).lock()->get_piece().lock()->tell_color_id() == color_id ) {
-                    castling_moves.push_back( helper::coordinates<int64_t>{ -2, 0 } );
-            }
-        }
-        
-        if ( !( get_square( 7, current.y).lock()->get_piece().expired() ) ) {
-            if ( get_square( 7, current.y).lock()->get_piece().lock()->tell_id() == ROOK*pow(10, color_id) &&
-                get_square( 7, current.y).lock()->get_piece().lock()->tell_color_id() == color_id ) {
-                    castling_moves.push_back( helper::coordinates<int64_t>{ 2, 0 } );
+        // the castling rook is the unmoved rook of the same color that is furthest from the king on this side
+        for ( int64_t x = current.x + direction; traits::on_board( x, current.y ); x += direction ) {
+            sharedPiecePtr rook = get_square( x, current.y ).lock()->get_piece().lock();
+
+            if ( rook && rook->tell_id() == ROOK*pow(10, color_id) && !rook->has_moved() ) {
+                rook_x = x;
             }
         }
-    }
 
-    else {
-        return std::vector< coordinates<int64_t> >{};
-    }
+        if ( rook_x < 0 ) continue;
 
+        int64_t king_target = ( direction > 0 ) ? width - 2 : 2;
+        int64_t rook_target = king_target - direction;
+        bool blocked = false;
 
-    for ( helper::coordinates<int64_t>& move : castling_moves ) {
-        aux = current + move;
+        // every square that the king or the rook passes has to be empty, the king and the rook themselves don't block
+        int64_t low = std::min( { current.x, rook_x, king_target, rook_target } );
+        int64_t high = std::max( { current.x, rook_x, king_target, rook_target } );
 
-        // because the king cannot move to a tile that is attacked, we have to do this check
-        // we also use clamp in these places to protect against segfault.
-        if ( piece_id == KING*pow(10, color_id) && get_square( aux.x, aux.y ).lock()->attacked() ) {
-            for ( aString a_color : get_square( aux.x, aux.y ).lock()->attacking_colors() ) {
-                if ( color != a_color) {
-                    directions_cannot_go.push_back( move );
-                    break;
-                }
+        for ( int64_t x = low; x <= high && !blocked; x++ ) {
+            if ( x != current.x && x != rook_x && get_square( x, current.y ).lock()->has_piece() ) {
+                blocked = true;
             }
         }
 
-        
+        // the king can't go through or land on a square that the opponent attacks
+        int64_t step = ( king_target > current.x ) ? 1 : -1;
+
+        for ( int64_t x = current.x; !blocked; x += step ) {
+            blocked = attacked_by( x, current.y, color_id ^ 1 );
 
-        // check if a square has a piece, so we cannot go to the next square behind it.
-        if ( get_square( aux.x, aux.y ).lock()->has_piece() ) {
-            directions_cannot_go.push_back( move );
+            if ( x == king_target ) break;
         }
+
+        if ( blocked ) continue;
+
+        // usually the move is the way that the king goes, but if the king moves less than 2 squares
+        // the move points to the rook instead, so it can't be mixed up with a normal king move.
+        int64_t king_move = king_target - current.x;
+
+        if ( king_move >= 2 || king_move <= -2 ) can_go.push_back( helper::coordinates<T>{ king_move, 0 } );
+        else can_go.push_back( helper::coordinates<T>{ rook_x - current.x, 0 } );
     }
 
-    
-    // this will at the most do only 4 iterations, because caslting_moves and directions_cannot_go 
-    // will both have at most 2 moves
-    // this std::copy_if only copies the move sinto can_go if they're not in directions_cannot_go
-    // so basically filter out the moves to which he king cannot go
-    std::copy_if( castling_moves.begin(), castling_moves.end(), std::back_inserter(can_go), [&directions_cannot_go]( helper::coordinates<int64_t> i ) -> bool { return std::find( directions_cannot_go.begin(), directions_cannot_go.end(), i ) == directions_cannot_go.end(); });
-    
-    
-    
+
     return can_go;
 }
 
 
 
+// the normal chess board, the rest of the program uses this one
+typedef BasicBoard<8, 8> Board;
+
 #endif
\ No newline at end of file
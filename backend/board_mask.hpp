@@ -0,0 +1,150 @@
+#ifndef BOARD_MASK
+#define BOARD_MASK
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <type_traits>
+
+#include "bitboard.hpp"
+
+
+/*
+ A bit per square for boards that have more than 64 squares. The words are stored in an array,
+ so the size is known at compile time and the loops over the words can be unrolled.
+*/
+template<size_t Words>
+struct WideMask
+{
+    std::array<uint64_t, Words> words{};
+
+    static constexpr size_t bits = Words * 64;
+
+    constexpr void set( const size_t& index ) noexcept { words[ index / 64 ] |= 1ULL << ( index % 64 ); }
+    constexpr void reset( const size_t& index ) noexcept { words[ index / 64 ] &= ~( 1ULL << ( index % 64 ) ); }
+    constexpr bool test( const size_t& index ) const noexcept { return ( words[ index / 64 ] >> ( index % 64 ) ) & 1; }
+
+    constexpr bool any() const noexcept
+    {
+        for ( const uint64_t& word : words ) {
+            if ( word ) return true;
+        }
+        return false;
+    }
+
+    inline uint32_t count() const noexcept
+    {
+        uint32_t total = 0;
+        for ( const uint64_t& word : words ) total += bitboard::popcount(word);
+        return total;
+    }
+
+    // returns the index of the lowest set bit, the mask must not be empty
+    inline size_t lsb() const noexcept
+    {
+        for ( size_t i = 0; i < Words; i++ ) {
+            if ( words[i] ) return i * 64 + bitboard::lsb( words[i] );
+        }
+        return bits;
+    }
+
+    // returns the index of the highest set bit, the mask must not be empty
+    inline size_t msb() const noexcept
+    {
+        for ( size_t i = Words; i > 0; i-- ) {
+            if ( words[i - 1] ) return ( i - 1 ) * 64 + bitboard::msb( words[i - 1] );
+        }
+        return bits;
+    }
+
+    // removes the lowest set bit and returns its index, the mask must not be empty
+    inline size_t pop_lsb() noexcept
+    {
+        for ( size_t i = 0; i < Words; i++ ) {
+            if ( words[i] ) return i * 64 + bitboard::pop_lsb( words[i] );
+        }
+        return bits;
+    }
+
+    constexpr WideMask& operator |= ( const WideMask& a ) noexcept { for ( size_t i = 0; i < Words; i++ ) words[i] |= a.words[i]; return *this; }
+    constexpr WideMask& operator &= ( const WideMask& a ) noexcept { for ( size_t i = 0; i < Words; i++ ) words[i] &= a.words[i]; return *this; }
+    constexpr WideMask& operator ^= ( const WideMask& a ) noexcept { for ( size_t i = 0; i < Words; i++ ) words[i] ^= a.words[i]; return *this; }
+
+    constexpr WideMask operator | ( const WideMask& a ) const noexcept { WideMask result = *this; return result |= a; }
+    constexpr WideMask operator & ( const WideMask& a ) const noexcept { WideMask result = *this; return result &= a; }
+    constexpr WideMask operator ^ ( const WideMask& a ) const noexcept { WideMask result = *this; return result ^= a; }
+
+    constexpr WideMask operator ~ () const noexcept
+    {
+        WideMask result;
+        for ( size_t i = 0; i < Words; i++ ) result.words[i] = ~words[i];
+        return result;
+    }
+
+    constexpr bool operator == ( const WideMask& a ) const noexcept
+    {
+        for ( size_t i = 0; i < Words; i++ ) {
+            if ( words[i] != a.words[i] ) return false;
+        }
+        return true;
+    }
+
+    constexpr bool operator != ( const WideMask& a ) const noexcept { return !( *this == a ); }
+};
+
+
+
+// the same operations for the plain 64-bit masks, so the code that uses a mask doesn't have to know which one it got.
+namespace mask_ops
+{
+
+constexpr void set( uint64_t& mask, const size_t& index ) noexcept { mask |= 1ULL << index; }
+constexpr void reset( uint64_t& mask, const size_t& index ) noexcept { mask &= ~( 1ULL << index ); }
+constexpr bool test( const uint64_t& mask, const size_t& index ) noexcept { return ( mask >> index ) & 1; }
+inline uint32_t count( const uint64_t& mask ) noexcept { return bitboard::popcount(mask); }
+inline size_t pop_lsb( uint64_t& mask ) noexcept { return static_cast<size_t>( bitboard::pop_lsb(mask) ); }
+inline size_t lsb( const uint64_t& mask ) noexcept { return static_cast<size_t>( bitboard::lsb(mask) ); }
+inline size_t msb( const uint64_t& mask ) noexcept { return static_cast<size_t>( bitboard::msb(mask) ); }
+constexpr bool any( const uint64_t& mask ) noexcept { return mask != 0; }
+
+template<size_t Words> constexpr void set( WideMask<Words>& mask, const size_t& index ) noexcept { mask.set(index); }
+template<size_t Words> constexpr void reset( WideMask<Words>& mask, const size_t& index ) noexcept { mask.reset(index); }
+template<size_t Words> constexpr bool test( const WideMask<Words>& mask, const size_t& index ) noexcept { return mask.test(index); }
+template<size_t Words> inline uint32_t count( const WideMask<Words>& mask ) noexcept { return mask.count(); }
+template<size_t Words> inline size_t pop_lsb( WideMask<Words>& mask ) noexcept { return mask.pop_lsb(); }
+template<size_t Words> inline size_t lsb( const WideMask<Words>& mask ) noexcept { return mask.lsb(); }
+template<size_t Words> inline size_t msb( const WideMask<Words>& mask ) noexcept { return mask.msb(); }
+template<size_t Words> constexpr bool any( const WideMask<Words>& mask ) noexcept { return mask.any(); }
+
+}
+
+
+
+/*
+ The compile time description of a board size. The mask type is a single 64-bit word when the board fits into it,
+ so the normal 8x8 board doesn't pay anything for the bigger boards.
+*/
+template<uint32_t Width, uint32_t Height>
+struct board_traits
+{
+    static_assert( Width > 0 && Height > 0, "a board needs at least one square" );
+
+    static constexpr uint32_t width = Width;
+    static constexpr uint32_t height = Height;
+    static constexpr uint32_t squares = Width * Height;
+
+    typedef std::conditional_t< ( squares <= 64 ), uint64_t, WideMask< ( squares + 63 ) / 64 > > mask;
+
+    // the squares are numbered file first, the same way as the 8x8 bitboards
+    static constexpr uint32_t index( const int64_t& x, const int64_t& y ) noexcept
+    {
+        return static_cast<uint32_t>( x + static_cast<int64_t>(Width) * y );
+    }
+
+    static constexpr bool on_board( const int64_t& x, const int64_t& y ) noexcept
+    {
+        return x >= 0 && x < static_cast<int64_t>(Width) && y >= 0 && y < static_cast<int64_t>(Height);
+    }
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef CHESS960
+#define CHESS960
+
+#include <cstdint>
+#include <array>
+
+#include "position.hpp"
+
+
+/*
+ The 960 starting positions of shuffled chess. The back ranks are calculated at compile time
+ with the Scharnagl numbering, so id 518 is the normal starting position and every id always gives the same setup.
+ Every arrangement follows the rules: the bishops are on different colored squares and the king is between the rooks.
+*/
+namespace chess960
+{
+
+constexpr uint32_t POSITIONS = 960;
+constexpr uint32_t STANDARD_ID = 518;
+
+typedef std::array<uint8_t, 8> arrangement; // the piece types of the back rank from file a to file h
+
+
+// puts the piece on the n:th empty file of the back rank
+constexpr void place_on_empty( arrangement& rank, uint32_t n, const uint8_t& piece ) noexcept
+{
+    for ( uint8_t& file : rank ) {
+        if ( file != 0 ) continue; // 0 is an empty file
+
+        if ( n == 0 ) {
+            file = piece;
+            return;
+        }
+
+        n--;
+    }
+}
+
+constexpr arrangement make_arrangement( uint32_t id ) noexcept
+{
+    // the knights are placed on two of the five files that are left after the bishops and the queen
+    constexpr uint8_t knight_files[10][2] = { {0, 1}, {0, 2}, {0, 3}, {0, 4}, {1, 2}, {1, 3}, {1, 4}, {2, 3}, {2, 4}, {3, 4} };
+
+    arrangement rank{};
+
+    rank[ ( id % 4 ) * 2 + 1 ] = BISHOP; // the bishop on a light square
+    id /= 4;
+    rank[ ( id % 4 ) * 2 ] = BISHOP; // the bishop on a dark square
+    id /= 4;
+
+    place_on_empty( rank, id % 6, QUEEN );
+    id /= 6;
+
+    // the second knight is placed after the first one, so its index among the empty files is one smaller
+    place_on_empty( rank, knight_files[id][0], KNIGHT );
+    place_on_empty( rank, knight_files[id][1] - 1, KNIGHT );
+
+    // the three files that are left get the rook, the king and the other rook in this order
+    place_on_empty( rank, 0, ROOK );
+    place_on_empty( rank, 0, KING );
+    place_on_empty( rank, 0, ROOK );
+
+    return rank;
+}
+
+constexpr std::array<arrangement, POSITIONS> make_table() noexcept
+{
+    std::array<arrangement, POSITIONS> table{};
+
+    for ( uint32_t id = 0; id < POSITIONS; id++ ) {
+        table[id] = make_arrangement(id);
+    }
+
+    return table;
+}
+
+inline constexpr std::array<arrangement, POSITIONS> table = make_table();
+
+
+// returns the back rank of the start position, an id outside of the table wraps around
+constexpr const arrangement& back_rank( const uint32_t& id ) noexcept
+{
+    return table[ id % POSITIONS ];
+}
+
+
+// creates the start position of the id with the castling rights of both rooks
+inline Position start_position( const uint32_t& id ) noexcept
+{
+    const arrangement& rank = back_rank(id);
+    Position pos;
+
+    for ( int32_t file = 0; file < 8; file++ ) {
+        pos.add_piece( bitboard::make_square(file, 0), rank[file], WHITE );
+        pos.add_piece( bitboard::make_square(file, 1), PAWN, WHITE );
+        pos.add_piece( bitboard::make_square(file, 6), PAWN, BLACK );
+        pos.add_piece( bitboard::make_square(file, 7), rank[file], BLACK );
+    }
+
+    // the rook that is found before the king is on the queen side
+    uint32_t wing = 1;
+
+    for ( int32_t file = 0; file < 8; file++ ) {
+        if ( rank[file] == KING ) wing = 0;
+
+        if ( rank[file] == ROOK ) {
+            pos.set_castling_rook( WHITE, wing, bitboard::make_square(file, 0) );
+            pos.set_castling_rook( BLACK, wing, bitboard::make_square(file, 7) );
+        }
+    }
+
+    pos.set_state( WHITE, ALL_CASTLING, -1, 0, 1 );
+
+    return pos;
+}
+
+
+
+/*
+ A small random number generator for choosing start positions. It's seeded explicitly,
+ so a batch of games can be created again with the same seed, and it gives the same numbers on every platform.
+*/
+class Random
+{
+    private:
+        uint64_t state = 0;
+
+    public:
+        explicit Random( const uint64_t& seed = 0 ) noexcept : state(seed) { }
+
+        void seed( const uint64_t& seed ) noexcept { state = seed; }
+
+        uint64_t next() noexcept
+        {
+            return zobrist::next_key(state);
+        }
+
+        // returns an id in [0, POSITIONS), the upper bits are scaled instead of using modulo
+        uint32_t next_id() noexcept
+        {
+            return static_cast<uint32_t>( ( ( next() >> 32 ) * POSITIONS ) >> 32 );
+        }
+};
+
+}
+
+#endif
@@ -54,6 +54,7 @@ class Piece
         bool has_moved() { return !this->first_move; }
 
         void moved() { this->first_move = false; }
+        void reset_moved() { this->first_move = true; } // used when a move is taken back
         
 
         // The base constructor of Piece.
@@ -0,0 +1,239 @@
+#ifndef EPOCH
+#define EPOCH
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <utility>
+
+
+/*
+ Epoch based reclamation for objects that are read by many threads without locks.
+ A reader announces the epoch that it started in before it reads a pointer, and a retired object
+ is only deleted when every announced epoch is newer than the epoch in which the object was retired.
+ Readers never wait, and writers never wait for readers: objects that are still in use are simply deleted later.
+
+ The reader slots are a fixed cost, so there is one shared domain for the whole process. When every slot is taken
+ a reader is only counted, and nothing is deleted until the counted readers are gone.
+*/
+class EpochDomain
+{
+    private:
+        static constexpr uint64_t IDLE = UINT64_MAX;
+        static constexpr size_t READER_SLOTS = 128;
+        static constexpr size_t OVERFLOW_SLOT = READER_SLOTS;
+        static constexpr size_t RECLAIM_BATCH = 32; // retired objects that are collected before the slots are scanned
+
+        // every slot is on its own cache line so the readers don't slow each other down
+        struct alignas(64) ReaderSlot
+        {
+            std::atomic<uint64_t> epoch{IDLE};
+            std::atomic<bool> in_use{false};
+        };
+
+        struct Retired
+        {
+            void* object;
+            void (*destroy)(void*);
+            uint64_t epoch;
+        };
+
+        std::atomic<uint64_t> global_epoch{1};
+        std::array<ReaderSlot, READER_SLOTS> readers;
+        alignas(64) std::atomic<size_t> overflow_readers{0};
+
+        std::mutex retired_lock; // only used by the writers
+        std::vector<Retired> retired;
+
+
+        // every thread starts looking for a free slot from its own place, so usually the first try succeeds
+        static size_t slot_hint() noexcept
+        {
+            static thread_local size_t hint = std::hash<std::thread::id>{}( std::this_thread::get_id() ) % READER_SLOTS;
+            return hint;
+        }
+
+
+    public:
+        EpochDomain() { }
+
+        ~EpochDomain()
+        {
+            for ( Retired& item : retired ) {
+                item.destroy(item.object);
+            }
+        }
+
+        EpochDomain( const EpochDomain& ) = delete;
+        EpochDomain& operator = ( const EpochDomain& ) = delete;
+
+        // the domain of the process. Whoever uses it in a static object has to call this in its constructor,
+        // so the domain is destroyed after that object
+        static EpochDomain& shared()
+        {
+            static EpochDomain domain;
+            return domain;
+        }
+
+
+        // marks the calling thread as a reader and returns the slot that has to be given to unpin()
+        size_t pin() noexcept
+        {
+            size_t slot = slot_hint();
+
+            for ( size_t tries = 0; tries < READER_SLOTS; tries++ ) {
+                bool expected = false;
+
+                if ( !readers[slot].in_use.load( std::memory_order_relaxed ) &&
+                     readers[slot].in_use.compare_exchange_strong( expected, true, std::memory_order_acquire ) ) {
+                    readers[slot].epoch.store( global_epoch.load(), std::memory_order_seq_cst );
+                    return slot;
+                }
+
+                slot = ( slot + 1 ) % READER_SLOTS;
+            }
+
+            // every slot is taken, the reader holds back all deletions until it's gone
+            overflow_readers.fetch_add( 1, std::memory_order_seq_cst );
+            return OVERFLOW_SLOT;
+        }
+
+        void unpin( const size_t& slot ) noexcept
+        {
+            if ( slot == OVERFLOW_SLOT ) {
+                overflow_readers.fetch_sub( 1, std::memory_order_release );
+                return;
+            }
+
+            readers[slot].epoch.store( IDLE, std::memory_order_release );
+            readers[slot].in_use.store( false, std::memory_order_release );
+        }
+
+
+        // hands an object that readers may still use over to the domain, it's deleted once no reader can see it.
+        // The slots are only scanned once a batch of objects was retired
+        template<typename T>
+        void retire( const T* object )
+        {
+            if ( !object ) return;
+
+            std::lock_guard<std::mutex> guard(retired_lock);
+
+            retired.push_back( Retired{ const_cast<T*>(object), []( void* ptr ) { delete static_cast<T*>(ptr); }, global_epoch.fetch_add(1) } );
+
+            if ( retired.size() >= RECLAIM_BATCH ) reclaim_locked();
+        }
+
+        // deletes every retired object that no reader can see anymore
+        void reclaim()
+        {
+            std::lock_guard<std::mutex> guard(retired_lock);
+            reclaim_locked();
+        }
+
+        size_t retired_count()
+        {
+            std::lock_guard<std::mutex> guard(retired_lock);
+            return retired.size();
+        }
+
+
+    private:
+        void reclaim_locked()
+        {
+            if ( overflow_readers.load( std::memory_order_seq_cst ) > 0 ) return;
+
+            uint64_t oldest = IDLE;
+
+            for ( const ReaderSlot& reader : readers ) {
+                oldest = std::min( oldest, reader.epoch.load( std::memory_order_seq_cst ) );
+            }
+
+            size_t kept = 0;
+
+            for ( Retired& item : retired ) {
+                if ( item.epoch < oldest ) item.destroy(item.object);
+                else retired[kept++] = item;
+            }
+
+            retired.resize(kept);
+        }
+};
+
+
+
+/*
+ Holds the latest published version of an immutable object. Readers get the object without locks
+ and the object stays valid while the reader exists, even if a newer version is published meanwhile.
+*/
+template<typename T>
+class SnapshotCell
+{
+    private:
+        std::atomic<const T*> current{nullptr};
+        EpochDomain* domain;
+
+    public:
+        // a reader keeps the snapshot that it saw alive until the reader is destroyed
+        class Reader
+        {
+            private:
+                EpochDomain* domain = nullptr;
+                size_t slot = 0;
+                const T* object = nullptr;
+
+            public:
+                Reader( EpochDomain& domain0, const std::atomic<const T*>& cell ) : domain(&domain0)
+                {
+                    slot = domain->pin();
+                    object = cell.load( std::memory_order_seq_cst );
+                }
+
+                Reader( Reader&& a ) noexcept : domain(a.domain), slot(a.slot), object(a.object) { a.domain = nullptr; }
+
+                ~Reader()
+                {
+                    if ( domain ) domain->unpin(slot);
+                }
+
+                Reader( const Reader& ) = delete;
+                Reader& operator = ( const Reader& ) = delete;
+                Reader& operator = ( Reader&& ) = delete;
+
+                const T* get() const noexcept { return object; }
+                const T* operator -> () const noexcept { return object; }
+                const T& operator * () const noexcept { return *object; }
+                explicit operator bool () const noexcept { return object != nullptr; }
+        };
+
+
+        SnapshotCell() : domain( &EpochDomain::shared() ) { }
+
+        // a reader may still hold the last object, so it's retired like the others
+        ~SnapshotCell()
+        {
+            domain->retire( current.load() );
+        }
+
+        SnapshotCell( const SnapshotCell& ) = delete;
+        SnapshotCell& operator = ( const SnapshotCell& ) = delete;
+
+
+        // replaces the published object, the old one is deleted when the last reader that saw it is gone
+        void publish( T value )
+        {
+            const T* old = current.exchange( new T( std::move(value) ), std::memory_order_seq_cst );
+            domain->retire(old);
+        }
+
+        Reader read() const
+        {
+            return Reader( *domain, current );
+        }
+};
+
+#endif
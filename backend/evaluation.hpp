@@ -0,0 +1,242 @@
+#ifndef EVALUATION
+#define EVALUATION
+
+#include <cstdint>
+#include <array>
+#include <algorithm>
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+#include "pawn_structure.hpp"
+#include "kpk_bitbase.hpp"
+
+
+namespace evaluation
+{
+
+// the values of the pieces in centipawns, indexed by the pieces enum
+constexpr std::array<int32_t, PIECES_COUNT> piece_values = { 0, 100, 320, 330, 500, 900, 0 };
+
+
+/*
+ piece-square tables from whites point of view, the index is the square ( a1 = 0, h8 = 63 ).
+ For black we mirror the square vertically with square ^ 56.
+*/
+constexpr std::array<std::array<int32_t, 64>, PIECES_COUNT> square_tables = {{
+    {},
+    // pawn
+    {{  0,  0,  0,  0,  0,  0,  0,  0,
+        5, 10, 10,-20,-20, 10, 10,  5,
+        5, -5,-10,  0,  0,-10, -5,  5,
+        0,  0,  0, 20, 20,  0,  0,  0,
+        5,  5, 10, 25, 25, 10,  5,  5,
+       10, 10, 20, 30, 30, 20, 10, 10,
+       50, 50, 50, 50, 50, 50, 50, 50,
+        0,  0,  0,  0,  0,  0,  0,  0 }},
+    // knight
+    {{-50,-40,-30,-30,-30,-30,-40,-50,
+      -40,-20,  0,  5,  5,  0,-20,-40,
+      -30,  5, 10, 15, 15, 10,  5,-30,
+      -30,  0, 15, 20, 20, 15,  0,-30,
+      -30,  5, 15, 20, 20, 15,  5,-30,
+      -30,  0, 10, 15, 15, 10,  0,-30,
+      -40,-20,  0,  0,  0,  0,-20,-40,
+      -50,-40,-30,-30,-30,-30,-40,-50 }},
+    // bishop
+    {{-20,-10,-10,-10,-10,-10,-10,-20,
+      -10,  5,  0,  0,  0,  0,  5,-10,
+      -10, 10, 10, 10, 10, 10, 10,-10,
+      -10,  0, 10, 10, 10, 10,  0,-10,
+      -10,  5,  5, 10, 10,  5,  5,-10,
+      -10,  0,  5, 10, 10,  5,  0,-10,
+      -10,  0,  0,  0,  0,  0,  0,-10,
+      -20,-10,-10,-10,-10,-10,-10,-20 }},
+    // rook
+    {{  0,  0,  0,  5,  5,  0,  0,  0,
+       -5,  0,  0,  0,  0,  0,  0, -5,
+       -5,  0,  0,  0,  0,  0,  0, -5,
+       -5,  0,  0,  0,  0,  0,  0, -5,
+       -5,  0,  0,  0,  0,  0,  0, -5,
+       -5,  0,  0,  0,  0,  0,  0, -5,
+        5, 10, 10, 10, 10, 10, 10,  5,
+        0,  0,  0,  0,  0,  0,  0,  0 }},
+    // queen
+    {{-20,-10,-10, -5, -5,-10,-10,-20,
+      -10,  0,  5,  0,  0,  0,  0,-10,
+      -10,  5,  5,  5,  5,  5,  0,-10,
+        0,  0,  5,  5,  5,  5,  0, -5,
+       -5,  0,  5,  5,  5,  5,  0, -5,
+      -10,  0,  5,  5,  5,  5,  0,-10,
+      -10,  0,  0,  0,  0,  0,  0,-10,
+      -20,-10,-10, -5, -5,-10,-10,-20 }},
+    // king
+    {{ 20, 30, 10,  0,  0, 10, 30, 20,
+       20, 20,  0,  0,  0,  0, 20, 20,
+      -10,-20,-20,-20,-20,-20,-20,-10,
+      -20,-30,-30,-40,-40,-30,-30,-20,
+      -30,-40,-40,-50,-50,-40,-40,-30,
+      -30,-40,-40,-50,-50,-40,-40,-30,
+      -30,-40,-40,-50,-50,-40,-40,-30,
+      -30,-40,-40,-50,-50,-40,-40,-30 }}
+}};
+
+
+
+// returns the material and piece-square score for one color
+inline int32_t material_and_squares( const Position& pos, const uint32_t& color ) noexcept
+{
+    int32_t score = 0;
+
+    for ( uint32_t type = PAWN; type <= KING; type++ ) {
+        mask pieces = pos.pieces(color, type);
+
+        while ( pieces ) {
+            int32_t square = bitboard::pop_lsb(pieces);
+            score += piece_values[type] + square_tables[type][ ( color == WHITE ) ? square : ( square ^ 56 ) ];
+        }
+    }
+
+    return score;
+}
+
+
+// the endgames whose result is known exactly replace the score, which is from whites point of view. A won pawn is
+// scored like the queen it becomes, the piece-square tables still show the way to the promotion
+inline int32_t known_endgame( const Position& pos, const int32_t& score ) noexcept
+{
+    uint32_t strong_side;
+    bool win;
+
+    if ( !kpk::probe(pos, strong_side, win) ) return score;
+    if ( !win ) return 0;
+
+    int32_t bonus = piece_values[QUEEN] - piece_values[PAWN];
+    return score + ( ( strong_side == WHITE ) ? bonus : -bonus );
+}
+
+
+// a static evaluation of the position in centipawns, seen from the side that is to move.
+// The pawn structure is analysed from scratch, the overload below takes it from a pawn table.
+inline int32_t evaluate( const Position& pos ) noexcept
+{
+    pawns::PawnEntry entry;
+    pawns::analyse(pos, entry);
+
+    int32_t score = known_endgame( pos, material_and_squares(pos, WHITE) - material_and_squares(pos, BLACK) + pawns::entry_score(pos, entry) );
+
+    return ( pos.side_to_move() == WHITE ) ? score : -score;
+}
+
+inline int32_t evaluate( const Position& pos, PawnTable& table ) noexcept
+{
+    int32_t score = known_endgame( pos, material_and_squares(pos, WHITE) - material_and_squares(pos, BLACK) + table.score(pos) );
+
+    return ( pos.side_to_move() == WHITE ) ? score : -score;
+}
+
+
+/*
+ Static exchange evaluation: the material that the side making the capture wins on the target square when both sides
+ keep recapturing with their least valuable attacker. The attackers are kept in a single mask, and after every capture
+ we only look again at the sliders behind the piece that left, so the x-rays are found and the cost depends on the
+ number of captures and not on the number of pieces on the board. Pins are ignored.
+*/
+inline int32_t see( const Position& pos, const Move& a_move ) noexcept
+{
+    if ( a_move.is_castling() ) return 0;
+
+    int32_t from = a_move.from();
+    int32_t to = a_move.to();
+    uint32_t side = piece_color( pos.piece_on(from) );
+    uint32_t on_square = piece_type( pos.piece_on(from) );
+
+    mask occ = pos.occupied() ^ bitboard::square_bit(from);
+    mask diagonal = pos.pieces(BISHOP) | pos.pieces(QUEEN);
+    mask straight = pos.pieces(ROOK) | pos.pieces(QUEEN);
+
+    // the gains of the side that captures, the longest possible exchange is every piece capturing once
+    std::array<int32_t, 32> gain{};
+    int32_t depth = 0;
+
+    if ( a_move.is_en_passant() ) {
+        occ ^= bitboard::square_bit( to ^ 8 );
+        gain[0] = piece_values[PAWN];
+    }
+    else gain[0] = piece_values[ piece_type( pos.piece_on(to) ) ];
+
+    if ( a_move.is_promotion() ) {
+        on_square = a_move.promotion_piece();
+        gain[0] += piece_values[on_square] - piece_values[PAWN];
+    }
+
+    mask attackers = pos.attackers_to(to, occ) & occ;
+
+    while ( true ) {
+        side ^= 1;
+        mask own = attackers & pos.color_pieces(side);
+        if ( !own ) break;
+
+        uint32_t type = PAWN;
+        while ( !( own & pos.pieces(type) ) ) type++;
+
+        // the king can only take when the square isn't defended anymore
+        if ( type == KING && ( attackers & pos.color_pieces(side ^ 1) ) ) break;
+
+        depth++;
+        gain[depth] = piece_values[on_square] - gain[depth - 1];
+
+        occ ^= bitboard::square_bit( bitboard::lsb( own & pos.pieces(type) ) );
+        on_square = type;
+
+        if ( type == PAWN && ( bitboard::square_bit(to) & ( bitboard::RANK_1 | bitboard::RANK_8 ) ) ) {
+            gain[depth] += piece_values[QUEEN] - piece_values[PAWN];
+            on_square = QUEEN;
+        }
+
+        // the piece that left can uncover a slider that was behind it
+        if ( type == PAWN || type == BISHOP || type == QUEEN ) attackers |= bitboard::bishop_attacks(to, occ) & diagonal;
+        if ( type == ROOK || type == QUEEN ) attackers |= bitboard::rook_attacks(to, occ) & straight;
+        attackers &= occ;
+    }
+
+    while ( depth > 0 ) {
+        depth--;
+        gain[depth] = -std::max( -gain[depth], gain[depth + 1] );
+    }
+
+    return gain[0];
+}
+
+// returns true when the static exchange of the move wins at least the threshold
+inline bool see_ge( const Position& pos, const Move& a_move, const int32_t& threshold ) noexcept
+{
+    return see(pos, a_move) >= threshold;
+}
+
+
+// returns the pieces of the color that the other side can win material on by capturing them, the king is never hanging
+inline mask hanging_pieces( const Position& pos, const uint32_t& color ) noexcept
+{
+    mask result = 0;
+    mask targets = pos.color_pieces(color) & ~pos.pieces(KING);
+
+    while ( targets ) {
+        int32_t square = bitboard::pop_lsb(targets);
+        mask attackers = pos.attackers_to( square, pos.occupied() ) & pos.color_pieces(color ^ 1);
+        if ( !attackers ) continue;
+
+        // the least valuable attacker starts the exchange
+        uint32_t type = PAWN;
+        while ( !( attackers & pos.pieces(type) ) ) type++;
+
+        Move capture( bitboard::lsb( attackers & pos.pieces(type) ), square, CAPTURE );
+        if ( see(pos, capture) > 0 ) result |= bitboard::square_bit(square);
+    }
+
+    return result;
+}
+
+}
+
+#endif
@@ -0,0 +1,586 @@
+#ifndef FOUR_PLAYER
+#define FOUR_PLAYER
+
+#include <cstdint>
+#include <array>
+#include <string>
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+#include "board_mask.hpp"
+#include "position.hpp"
+
+
+/*
+ Four player chess on a 14x14 board where the 3x3 corners are cut away, so the board looks like a cross.
+ Every player has the normal 8 pieces and 8 pawns on one arm of the cross, and the pawns move towards the opposite arm.
+ The squares are stored in a 196-bit mask, so the code is the same as the 8x8 bitboards with a wider mask.
+*/
+namespace four_player
+{
+
+typedef board_traits<14, 14> traits;
+typedef traits::mask mask;
+
+constexpr int32_t SIZE = 14;
+constexpr int32_t CORNER = 3; // the width of a cut away corner
+constexpr uint32_t PLAYERS = 4;
+constexpr int32_t SQUARES = SIZE * SIZE;
+constexpr int32_t NO_SQUARE = SQUARES;
+constexpr int32_t PROMOTION_RANK = 7; // like in the free for all games, the pawns promote at the middle of the board
+
+
+// the players in the order of the turns, clockwise starting from the bottom of the board
+enum players
+{
+    RED_PLAYER,
+    BLUE_PLAYER,
+    GREY_PLAYER,
+    GREEN_PLAYER
+};
+
+// the color ids of helper_tools that the players use
+constexpr std::array<uint16_t, PLAYERS> player_colors = { RED, BLUE, GREY, GREEN };
+
+// the direction where the pawns of the player move, red starts at the bottom and blue on the left
+constexpr std::array<int32_t, PLAYERS> forward_x = { 0, 1, 0, -1 };
+constexpr std::array<int32_t, PLAYERS> forward_y = { 1, 0, -1, 0 };
+
+
+constexpr inline int32_t make_square( const int32_t& x, const int32_t& y ) noexcept { return x + SIZE*y; }
+constexpr inline int32_t file_of( const int32_t& square ) noexcept { return square % SIZE; }
+constexpr inline int32_t rank_of( const int32_t& square ) noexcept { return square / SIZE; }
+
+constexpr inline bool playable( const int32_t& x, const int32_t& y ) noexcept
+{
+    bool corner_x = x < CORNER || x >= SIZE - CORNER;
+    bool corner_y = y < CORNER || y >= SIZE - CORNER;
+
+    return traits::on_board(x, y) && !( corner_x && corner_y );
+}
+
+constexpr inline mask square_bit( const int32_t& square ) noexcept
+{
+    mask bit;
+    bit.set( static_cast<size_t>(square) );
+    return bit;
+}
+
+// how many ranks the square is away from the back rank of the player
+constexpr inline int32_t relative_rank( const uint32_t& player, const int32_t& square ) noexcept
+{
+    switch ( player ) {
+        case RED_PLAYER: return rank_of(square);
+        case BLUE_PLAYER: return file_of(square);
+        case GREY_PLAYER: return SIZE - 1 - rank_of(square);
+        default: return SIZE - 1 - file_of(square);
+    }
+}
+
+// turns the file and the rank that the player sees into a square, every player sees the board rotated by 90 degrees from the previous one
+constexpr inline int32_t relative_square( const uint32_t& player, const int32_t& file, const int32_t& rank ) noexcept
+{
+    switch ( player ) {
+        case RED_PLAYER: return make_square( file, rank );
+        case BLUE_PLAYER: return make_square( rank, SIZE - 1 - file );
+        case GREY_PLAYER: return make_square( SIZE - 1 - file, SIZE - 1 - rank );
+        default: return make_square( SIZE - 1 - rank, file );
+    }
+}
+
+// the name of the square, the files go from a to n and the ranks from 1 to 14
+inline std::string square_name( const int32_t& square )
+{
+    return std::string( 1, static_cast<char>( 'a' + file_of(square) ) ) + std::to_string( rank_of(square) + 1 );
+}
+
+
+
+// the attack masks that don't depend on the other pieces, a ray ends at the edge of the board or at a cut away corner.
+struct attack_tables
+{
+    mask board{}; // the squares that are part of the cross
+    std::array<mask, SQUARES> knight{};
+    std::array<mask, SQUARES> king{};
+    std::array<std::array<mask, SQUARES>, PLAYERS> pawn{}; // indexed by the player of the attacking pawn
+    std::array<std::array<mask, SQUARES>, bitboard::DIRECTION_COUNT> rays{};
+};
+
+
+constexpr attack_tables make_attack_tables() noexcept
+{
+    attack_tables tables{};
+
+    constexpr int32_t knight_x[8] = { 1, 2, 2, 1, -1, -2, -2, -1 };
+    constexpr int32_t knight_y[8] = { 2, 1, -1, -2, -2, -1, 1, 2 };
+
+    for ( int32_t square = 0; square < SQUARES; square++ ) {
+        int32_t x = file_of(square);
+        int32_t y = rank_of(square);
+
+        if ( !playable(x, y) ) continue;
+
+        tables.board.set(square);
+
+        for ( int32_t i = 0; i < 8; i++ ) {
+            if ( playable( x + knight_x[i], y + knight_y[i] ) ) {
+                tables.knight[square].set( make_square( x + knight_x[i], y + knight_y[i] ) );
+            }
+
+            if ( playable( x + bitboard::direction_x[i], y + bitboard::direction_y[i] ) ) {
+                tables.king[square].set( make_square( x + bitboard::direction_x[i], y + bitboard::direction_y[i] ) );
+            }
+        }
+
+        // a pawn captures forward and one square to either side of the forward direction
+        for ( uint32_t player = 0; player < PLAYERS; player++ ) {
+            int32_t fx = forward_x[player];
+            int32_t fy = forward_y[player];
+
+            if ( playable( x + fx + fy, y + fy + fx ) ) tables.pawn[player][square].set( make_square( x + fx + fy, y + fy + fx ) );
+            if ( playable( x + fx - fy, y + fy - fx ) ) tables.pawn[player][square].set( make_square( x + fx - fy, y + fy - fx ) );
+        }
+
+        for ( int32_t dir = 0; dir < bitboard::DIRECTION_COUNT; dir++ ) {
+            int32_t x1 = x + bitboard::direction_x[dir];
+            int32_t y1 = y + bitboard::direction_y[dir];
+
+            while ( playable( x1, y1 ) ) {
+                tables.rays[dir][square].set( make_square(x1, y1) );
+
+                x1 += bitboard::direction_x[dir];
+                y1 += bitboard::direction_y[dir];
+            }
+        }
+    }
+
+    return tables;
+}
+
+inline constexpr attack_tables tables = make_attack_tables();
+
+
+
+// the same ray lookup as the 8x8 bitboards, the first 4 directions move towards higher square indexes here too.
+inline mask ray_attacks( const int32_t& dir, const int32_t& square, const mask& occupied ) noexcept
+{
+    mask attacks = tables.rays[dir][square];
+    mask blockers = attacks & occupied;
+
+    if ( blockers.any() ) {
+        size_t first = ( dir < bitboard::SOUTH ) ? blockers.lsb() : blockers.msb();
+        attacks ^= tables.rays[dir][first];
+    }
+
+    return attacks;
+}
+
+inline mask rook_attacks( const int32_t& square, const mask& occupied ) noexcept
+{
+    return ray_attacks(bitboard::NORTH, square, occupied) | ray_attacks(bitboard::EAST, square, occupied) |
+           ray_attacks(bitboard::SOUTH, square, occupied) | ray_attacks(bitboard::WEST, square, occupied);
+}
+
+inline mask bishop_attacks( const int32_t& square, const mask& occupied ) noexcept
+{
+    return ray_attacks(bitboard::NORTH_EAST, square, occupied) | ray_attacks(bitboard::NORTH_WEST, square, occupied) |
+           ray_attacks(bitboard::SOUTH_EAST, square, occupied) | ray_attacks(bitboard::SOUTH_WEST, square, occupied);
+}
+
+
+
+// A move of the four player game, the squares don't fit into 6 bits so they get a byte each.
+// The flags are the same as the flags of Move, a promotion always gives a queen.
+struct FourPlayerMove
+{
+    uint8_t from = 0;
+    uint8_t to = 0;
+    uint8_t flags = QUIET_MOVE;
+
+    constexpr FourPlayerMove() noexcept { }
+
+    constexpr FourPlayerMove( int32_t from0, int32_t to0, uint32_t flags0 = QUIET_MOVE ) noexcept
+        : from( static_cast<uint8_t>(from0) ), to( static_cast<uint8_t>(to0) ), flags( static_cast<uint8_t>(flags0) ) { }
+
+    constexpr bool is_null() const noexcept { return from == to; }
+    constexpr bool is_capture() const noexcept { return ( flags & CAPTURE ) != 0; }
+    constexpr bool is_promotion() const noexcept { return ( flags & PROMOTION ) != 0; }
+
+    constexpr bool operator == ( const FourPlayerMove& a ) const noexcept { return from == a.from && to == a.to && flags == a.flags; }
+    constexpr bool operator != ( const FourPlayerMove& a ) const noexcept { return !( *this == a ); }
+
+    std::string to_string() const
+    {
+        if ( is_null() ) return "0000";
+
+        return square_name(from) + square_name(to) + ( ( is_promotion() ) ? "q" : "" );
+    }
+};
+
+
+// the four player version of MoveList, 4 armies have more moves than the 218 of normal chess
+struct FourPlayerMoveList
+{
+    std::array<FourPlayerMove, 512> moves;
+    uint32_t count = 0;
+
+    inline void push_back( const FourPlayerMove& a_move ) noexcept { moves[count++] = a_move; }
+    inline uint32_t size() const noexcept { return count; }
+    inline bool empty() const noexcept { return count == 0; }
+    inline void clear() noexcept { count = 0; }
+
+    inline FourPlayerMove& operator [] ( const size_t& index ) noexcept { return moves[index]; }
+    inline const FourPlayerMove& operator [] ( const size_t& index ) const noexcept { return moves[index]; }
+
+    inline FourPlayerMove* begin() noexcept { return moves.data(); }
+    inline FourPlayerMove* end() noexcept { return moves.data() + count; }
+    inline const FourPlayerMove* begin() const noexcept { return moves.data(); }
+    inline const FourPlayerMove* end() const noexcept { return moves.data() + count; }
+
+    bool contains( const FourPlayerMove& a_move ) const noexcept
+    {
+        for ( const FourPlayerMove& move : *this ) {
+            if ( move == a_move ) return true;
+        }
+        return false;
+    }
+};
+
+}
+
+
+
+/*
+ The four player version of Position. The pieces use the byte format of Position, the color bits
+ just hold the player instead ( 0-3 ). A player that is checkmated or stalemated is out of the game,
+ its pieces stay on the board but they don't attack anything and anyone can capture them.
+ There is no castling or en passant in this mode.
+*/
+class FourPlayerPosition
+{
+    public:
+        typedef four_player::mask mask;
+        typedef four_player::FourPlayerMove move_type;
+        typedef four_player::FourPlayerMoveList move_list;
+
+    private:
+        std::array<mask, PIECES_COUNT> by_type{}; // indexed by the pieces enum, index 0 is unused
+        std::array<mask, four_player::PLAYERS> by_player{};
+        std::array<uint8_t, four_player::SQUARES> squares{};
+
+        // the squares that each player attacks, they are updated after every played move
+        std::array<mask, four_player::PLAYERS> attack_maps{};
+
+        uint8_t player_turn = four_player::RED_PLAYER;
+        uint8_t eliminated = 0; // bit per player
+
+
+        inline void put_piece( const int32_t& square, const uint8_t& piece ) noexcept
+        {
+            by_type[ piece_type(piece) ].set(square);
+            by_player[ piece_color(piece) ].set(square);
+            squares[square] = piece;
+        }
+
+        inline uint8_t remove_piece( const int32_t& square ) noexcept
+        {
+            uint8_t piece = squares[square];
+
+            by_type[ piece_type(piece) ].reset(square);
+            by_player[ piece_color(piece) ].reset(square);
+            squares[square] = 0;
+
+            return piece;
+        }
+
+        inline void add_moves( move_list& list, const int32_t& from, mask targets ) const noexcept
+        {
+            while ( targets.any() ) {
+                int32_t to = static_cast<int32_t>( targets.pop_lsb() );
+                list.push_back( move_type( from, to, ( squares[to] ) ? CAPTURE : QUIET_MOVE ) );
+            }
+        }
+
+        // the pieces of the players that are still in the game, except the given player
+        inline mask opponents( const uint32_t& player ) const noexcept
+        {
+            mask pieces;
+
+            for ( uint32_t i = 0; i < four_player::PLAYERS; i++ ) {
+                if ( i != player && !is_eliminated(i) ) pieces |= by_player[i];
+            }
+
+            return pieces;
+        }
+
+        // moves the pieces without changing the turn
+        inline void make( const move_type& a_move ) noexcept
+        {
+            uint8_t piece = remove_piece( a_move.from );
+
+            if ( squares[ a_move.to ] ) remove_piece( a_move.to );
+
+            put_piece( a_move.to, ( a_move.is_promotion() ) ? make_piece( QUEEN, piece_color(piece) ) : piece );
+        }
+
+        void update_attack_maps() noexcept
+        {
+            mask occ = occupied();
+
+            for ( uint32_t player = 0; player < four_player::PLAYERS; player++ ) {
+                attack_maps[player] = mask();
+                if ( is_eliminated(player) ) continue;
+
+                mask pieces = by_player[player];
+
+                while ( pieces.any() ) {
+                    attack_maps[player] |= attacks_from( static_cast<int32_t>( pieces.pop_lsb() ), occ );
+                }
+            }
+        }
+
+        // passes the turn to the next player that is still in the game
+        inline void next_player() noexcept
+        {
+            for ( uint32_t i = 0; i < four_player::PLAYERS; i++ ) {
+                player_turn = ( player_turn + 1 ) % four_player::PLAYERS;
+                if ( !is_eliminated(player_turn) ) return;
+            }
+        }
+
+
+    public:
+        inline uint32_t side_to_move() const noexcept { return player_turn; }
+        inline bool is_eliminated( const uint32_t& player ) const noexcept { return ( eliminated >> player ) & 1; }
+        inline uint8_t piece_on( const int32_t& square ) const noexcept { return squares[square]; }
+        inline mask occupied() const noexcept { return by_player[0] | by_player[1] | by_player[2] | by_player[3]; }
+        inline mask player_pieces( const uint32_t& player ) const noexcept { return by_player[player]; }
+        inline mask pieces( const uint32_t& player, const uint32_t& type ) const noexcept { return by_player[player] & by_type[type]; }
+        inline const mask& attack_map( const uint32_t& player ) const noexcept { return attack_maps[player]; }
+
+        inline int32_t king_square( const uint32_t& player ) const noexcept
+        {
+            mask king = pieces(player, KING);
+            return ( king.any() ) ? static_cast<int32_t>( king.lsb() ) : four_player::NO_SQUARE;
+        }
+
+        uint32_t players_left() const noexcept
+        {
+            return four_player::PLAYERS - mask_ops::count( static_cast<uint64_t>(eliminated) );
+        }
+
+        // returns the last player in the game, or PLAYERS while the game is still running
+        uint32_t winner() const noexcept
+        {
+            if ( players_left() != 1 ) return four_player::PLAYERS;
+
+            for ( uint32_t player = 0; player < four_player::PLAYERS; player++ ) {
+                if ( !is_eliminated(player) ) return player;
+            }
+
+            return four_player::PLAYERS;
+        }
+
+
+        void clear() noexcept
+        {
+            *this = FourPlayerPosition();
+        }
+
+        void add_piece( const int32_t& square, const uint32_t& type, const uint32_t& player ) noexcept
+        {
+            if ( squares[square] ) remove_piece(square);
+            put_piece( square, make_piece(type, player) );
+        }
+
+        // sets up the start position, every player has the normal back rank with the queen on the left of the king
+        void set_start() noexcept
+        {
+            constexpr std::array<uint8_t, 8> back_rank = { ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK };
+
+            clear();
+
+            for ( uint32_t player = 0; player < four_player::PLAYERS; player++ ) {
+                for ( int32_t file = 0; file < 8; file++ ) {
+                    add_piece( four_player::relative_square( player, four_player::CORNER + file, 0 ), back_rank[file], player );
+                    add_piece( four_player::relative_square( player, four_player::CORNER + file, 1 ), PAWN, player );
+                }
+            }
+
+            update_attack_maps();
+        }
+
+        // the turn is given to the player, the other players keep their place in the rotation
+        void set_turn( const uint32_t& player ) noexcept
+        {
+            player_turn = static_cast<uint8_t>( player % four_player::PLAYERS );
+            update_attack_maps();
+        }
+
+
+        // returns a mask of the pieces of every player that attack the given square
+        mask attackers_to( const int32_t& square, const mask& occ ) const noexcept
+        {
+            using four_player::tables;
+
+            // a pawn attacks the square from the squares that a pawn moving the other way would attack
+            mask attackers = ( tables.pawn[2][square] & pieces(0, PAWN) ) | ( tables.pawn[3][square] & pieces(1, PAWN) ) |
+                             ( tables.pawn[0][square] & pieces(2, PAWN) ) | ( tables.pawn[1][square] & pieces(3, PAWN) );
+
+            attackers |= ( tables.knight[square] & by_type[KNIGHT] ) | ( tables.king[square] & by_type[KING] ) |
+                         ( four_player::bishop_attacks(square, occ) & ( by_type[BISHOP] | by_type[QUEEN] ) ) |
+                         ( four_player::rook_attacks(square, occ) & ( by_type[ROOK] | by_type[QUEEN] ) );
+
+            return attackers;
+        }
+
+        // returns true if any player except the given one attacks the square
+        inline bool square_attacked( const int32_t& square, const uint32_t& player ) const noexcept
+        {
+            return ( attackers_to( square, occupied() ) & opponents(player) ).any();
+        }
+
+        // returns the squares that the piece on the given square attacks
+        mask attacks_from( const int32_t& square, const mask& occ ) const noexcept
+        {
+            uint8_t piece = squares[square];
+
+            switch ( piece_type(piece) ) {
+                case PAWN: return four_player::tables.pawn[ piece_color(piece) ][square];
+                case KNIGHT: return four_player::tables.knight[square];
+                case BISHOP: return four_player::bishop_attacks( square, occ );
+                case ROOK: return four_player::rook_attacks( square, occ );
+                case QUEEN: return four_player::rook_attacks( square, occ ) | four_player::bishop_attacks( square, occ );
+                case KING: return four_player::tables.king[square];
+                default: return mask();
+            }
+        }
+
+        // the attack maps are kept up to date, so this doesn't have to look at the pieces
+        inline bool in_check( const uint32_t& player ) const noexcept
+        {
+            int32_t king = king_square(player);
+            if ( king == four_player::NO_SQUARE ) return false;
+
+            for ( uint32_t i = 0; i < four_player::PLAYERS; i++ ) {
+                if ( i != player && attack_maps[i].test(king) ) return true;
+            }
+
+            return false;
+        }
+
+        inline bool in_check() const noexcept { return in_check(player_turn); }
+
+
+        // generates every move without checking whether the own king is left in check
+        void generate_pseudo_legal( move_list& list ) const noexcept
+        {
+            using four_player::tables;
+
+            uint32_t us = player_turn;
+            mask own = by_player[us];
+            mask occ = occupied();
+            mask enemy = occ & ~own;
+            int32_t forward = four_player::forward_x[us] + four_player::SIZE * four_player::forward_y[us];
+
+            mask pawns = pieces(us, PAWN);
+            while ( pawns.any() ) {
+                int32_t from = static_cast<int32_t>( pawns.pop_lsb() );
+                int32_t to = from + forward;
+
+                if ( tables.board.test(to) && !occ.test(to) ) {
+                    if ( four_player::relative_rank(us, to) == four_player::PROMOTION_RANK ) {
+                        list.push_back( move_type( from, to, PROMOTION | ( QUEEN - KNIGHT ) ) );
+                    }
+                    else {
+                        list.push_back( move_type( from, to, QUIET_MOVE ) );
+
+                        if ( four_player::relative_rank(us, from) == 1 && !occ.test( to + forward ) ) {
+                            list.push_back( move_type( from, to + forward, DOUBLE_PAWN_PUSH ) );
+                        }
+                    }
+                }
+
+                mask captures = tables.pawn[us][from] & enemy;
+                while ( captures.any() ) {
+                    to = static_cast<int32_t>( captures.pop_lsb() );
+
+                    if ( four_player::relative_rank(us, to) == four_player::PROMOTION_RANK ) {
+                        list.push_back( move_type( from, to, PROMOTION | CAPTURE | ( QUEEN - KNIGHT ) ) );
+                    }
+                    else list.push_back( move_type( from, to, CAPTURE ) );
+                }
+            }
+
+            mask others = own & ~by_type[PAWN];
+            while ( others.any() ) {
+                int32_t from = static_cast<int32_t>( others.pop_lsb() );
+                add_moves( list, from, attacks_from(from, occ) & ~own );
+            }
+        }
+
+        // returns true if the given pseudo legal move doesn't leave the own king attacked by any other player.
+        // There is no castling or en passant, so only the 2 squares of the move change and the position isn't copied.
+        inline bool leaves_king_safe( const move_type& a_move ) const noexcept
+        {
+            int32_t king = ( piece_type( squares[ a_move.from ] ) == KING ) ? a_move.to : king_square(player_turn);
+            if ( king == four_player::NO_SQUARE ) return true;
+
+            mask occ = occupied();
+            occ.reset( a_move.from );
+            occ.set( a_move.to );
+
+            // a captured piece doesn't attack anymore
+            mask attackers = attackers_to( king, occ ) & opponents(player_turn);
+            attackers.reset( a_move.to );
+
+            return !attackers.any();
+        }
+
+        void generate_legal( move_list& list ) const noexcept
+        {
+            move_list pseudo;
+            generate_pseudo_legal(pseudo);
+
+            for ( const move_type& a_move : pseudo ) {
+                if ( leaves_king_safe(a_move) ) list.push_back(a_move);
+            }
+        }
+
+        bool has_legal_moves() const noexcept
+        {
+            move_list pseudo;
+            generate_pseudo_legal(pseudo);
+
+            for ( const move_type& a_move : pseudo ) {
+                if ( leaves_king_safe(a_move) ) return true;
+            }
+            return false;
+        }
+
+
+        /**
+         * @brief Executes a move and passes the turn to the next player. A player that has no legal moves
+         * when its turn comes is out of the game, the same happens to a player whose king gets captured,
+         * which can happen when an earlier player left it in check by someone else.
+         */
+        void play( const move_type& a_move ) noexcept
+        {
+            uint8_t captured = squares[ a_move.to ];
+
+            make(a_move);
+
+            if ( captured && piece_type(captured) == KING ) eliminated |= 1 << piece_color(captured);
+
+            do {
+                next_player();
+                update_attack_maps();
+
+                if ( players_left() <= 1 || has_legal_moves() ) break;
+
+                eliminated |= 1 << player_turn;
+            } while ( true );
+        }
+};
+
+#endif
@@ -7,103 +7,347 @@
 #include <map>
 #include <string>
 #include <iostream>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
 
 #include "chess_piece.hpp"
 #include "square.hpp"
 #include "helper_tools.hpp"
 #include "board.hpp"
+#include "slot_map.hpp"
+#include "move_log.hpp"
+#include "move_precompute.hpp"
+#include "pgn.hpp"
+#include "game_archive.hpp"
 
 
 using helper::coordinates;
 
+typedef SlotHandle GameHandle;
+
+
+// the moves of a game that can be taken back, and the moves that were taken back and can be played again.
+// Both are stacks, so undo and redo only touch their last element.
+struct UndoStack
+{
+    std::vector<BoardUndo> undo;
+    std::vector<Move> redo;
+};
+
+
+// everything that belongs to a single game, stored together so the board and its history can't get out of sync.
+struct GameEntry
+{
+    std::shared_ptr<Board> board;
+    std::shared_ptr< MoveLog > history; // the moves history of the board
+    std::shared_ptr< std::mutex > lock; // every game has its own lock, so threads that handle different games never wait for each other
+    std::shared_ptr< UndoStack > undo_stack;
+};
+
+
+// tells what happened to a move that was given to Game::apply_move()
+enum move_status
+{
+    MOVE_APPLIED,
+    MOVE_ILLEGAL,
+    MOVE_GAME_FINISHED,
+    MOVE_NO_GAME
+};
+
+// the result of a single applied move
+struct MoveResult
+{
+    move_status status = MOVE_NO_GAME;
+    Move move;
+    bool capture = false;
+    bool check = false;
+    bool checkmate = false;
+    bool stalemate = false;
+    size_t ply = 0; // the length of the moves history after the move
+
+    bool applied() const noexcept { return status == MOVE_APPLIED; }
+};
+
+// the result of Game::apply_moves(), the moves are applied until the first one that fails
+struct MovesResult
+{
+    size_t applied = 0; // how many moves from the start of the span were applied
+    MoveResult last; // the result of the last move that was tried, it tells why the batch stopped early
+};
+
+
+// a copy of the state of a game, it can be read after the lock of the game has been released.
+struct GameState
+{
+    Position position;
+    GameStatus status;
+    bool finished = false;
+    bool in_check = false;
+    size_t history_length = 0;
+};
+
+
 /*
  We'll use this class more in the future to manage multiple 
  windows with chess games at once.
+ The games are stored in a slot map, so a GameHandle stays valid until that specific game is ended
+ and ending a game doesn't change the handles of the other games.
+
+ The methods that take a GameHandle are thread-safe. Looking up a game only takes a shared lock of the registry,
+ and the game itself is protected by its own lock. The methods that use the current game are meant for the gui thread.
 */
 class Game 
 {
     private:
-        std::vector< std::shared_ptr<Board> > all_games;
-        std::vector< std::shared_ptr< std::deque<std::string> >> moves_history; // the deques store the moves history for each game in the all_games vector at the coresponding index.
+        SlotMap<GameEntry> all_games;
+        mutable std::shared_mutex registry_lock; // protects all_games when games are created or ended
+
+        GameHandle current_handle;
         std::shared_ptr<Board> current_board; // this will contain the board that we are currently modifying. We need this variable because we can have multiple boards.
-        std::shared_ptr< std::deque<std::string> > current_history;
+        std::shared_ptr< MoveLog > current_history;
+        std::shared_ptr< std::mutex > current_lock;
+        std::shared_ptr< UndoStack > current_undo;
         std::string return_str = "";
 
-        inline size_t captured_len( const int& color_id ) 
+        // groups the legal moves of the current game on its own thread whenever the current board publishes a snapshot
+        MovePrecomputer precomputer;
+
+        // asks the worker for the moves of the current game, the snapshot can be read without the lock of the game
+        inline void precompute_current()
+        {
+            if ( !current_board ) return;
+
+            SnapshotCell<BoardSnapshot>::Reader board_state = current_board->snapshot();
+            if ( board_state ) precomputer.request( board_state->position, board_state->legal_moves );
+        }
+
+        // looks up the moves of the piece on the square from the precomputed moves, found is false if the worker isn't done yet
+        std::vector< helper::coordinates<int64_t> > precomputed_vectors( const helper::coordinates<int64_t>& square, bool& found ) const
+        {
+            SnapshotCell<BoardSnapshot>::Reader board_state = current_board->snapshot();
+            SnapshotCell<PrecomputedMoves>::Reader moves = precomputer.latest();
+
+            found = board_state && moves && moves->matches( board_state->position );
+            if ( !found ) return std::vector< helper::coordinates<int64_t> >();
+
+            return Board::map_vectors( moves->map, moves->position, square );
+        }
+
+        // logs the move that the current board just committed, the board knows it as a packed Move
+        inline void log_committed_move( const Position& before )
+        {
+            Move played = current_board->status().last_move;
+
+            if ( !played.is_null() ) {
+                current_history->push(before, played);
+                push_undo( *current_undo, current_board->last_undo() );
+            }
+        }
+
+
+        // copies the entry of the handle, the copy keeps the game alive even if another thread ends it meanwhile.
+        bool find_entry( const GameHandle& handle, GameEntry& entry ) const
         {
-            return current_board->captured_pieces( color_id ).size(); 
+            std::shared_lock<std::shared_mutex> guard(registry_lock);
+            const GameEntry* found = all_games.get(handle);
+
+            if ( !found ) return false;
+
+            entry = *found;
+            return true;
+        }
+
+        // the registry lock has to be held when this is called
+        bool set_current_entry( const GameHandle& handle ) noexcept
+        {
+            GameEntry* entry = all_games.get(handle);
+
+            if ( !entry || !entry->board || !entry->history ) return false;
+
+            // only the current board asks for its moves, so the worker doesn't calculate games that aren't shown
+            if ( current_board && current_board != entry->board ) current_board->set_publish_hook(nullptr);
+            entry->board->set_publish_hook( [this]( const BoardSnapshot& published ) { precomputer.request( published.position, published.legal_moves ); } );
+
+            current_handle = handle;
+            current_board = entry->board;
+            current_history = entry->history;
+            current_lock = entry->lock;
+            current_undo = entry->undo_stack;
+
+            precompute_current();
+
+            return true;
+        }
+
+
+        // a new move makes the taken back moves unreachable, unless it's the same move that redo would play
+        static void push_undo( UndoStack& stack, const BoardUndo& record )
+        {
+            if ( !stack.redo.empty() && stack.redo.back() == record.position.move ) stack.redo.pop_back();
+            else stack.redo.clear();
+
+            stack.undo.push_back(record);
+        }
+
+
+        // ends the game if a king got checkmated or the side to move has no legal moves, and writes it into the history
+        static void check_game_end( Board& board, MoveLog& history )
+        {
+            if ( !board.checkmated().empty() ) {
+                board.end_game();
+                for ( const aString& color : board.checkmated() ) {
+                    history.mark_checkmated( ( color == "w" ) ? WHITE : BLACK );
+                }
+            }
+
+            else if ( board.legal_moves().empty() ) {
+                board.end_game();
+            }
+        }
+
+
+        // the lock of the entry has to be held when this is called
+        static MoveResult apply_locked( GameEntry& entry, const Move& a_move )
+        {
+            MoveResult result;
+            result.move = a_move;
+            result.ply = entry.history->size();
+
+            if ( entry.board->is_finished() ) {
+                result.status = MOVE_GAME_FINISHED;
+                return result;
+            }
+
+            if ( !entry.board->legal_moves().contains(a_move) ) {
+                result.status = MOVE_ILLEGAL;
+                return result;
+            }
+
+            Position before = entry.board->position();
+
+            if ( !entry.board->play_move(a_move) ) {
+                result.status = MOVE_ILLEGAL;
+                return result;
+            }
+
+            entry.history->push(before, a_move);
+            push_undo( *entry.undo_stack, entry.board->last_undo() );
+            check_game_end( *entry.board, *entry.history );
+
+            // the board calculated the status of the new position when it committed the move
+            const GameStatus& game_status = entry.board->status();
+
+            result.status = MOVE_APPLIED;
+            result.capture = a_move.is_capture();
+            result.check = game_status.in_check( game_status.side_to_move );
+            result.checkmate = game_status.checkmate;
+            result.stalemate = game_status.stalemate;
+            result.ply = entry.history->size();
+
+            return result;
         }
 
 
     public:
+        Game() { }
+
+        // the boards can outlive the game, so the current one must not call into the precomputer after it's gone
+        ~Game()
+        {
+            if ( current_board ) current_board->set_publish_hook(nullptr);
+        }
+
+        Game( const Game& ) = delete;
+        Game& operator = ( const Game& ) = delete;
     
-        size_t active_games_count() noexcept { return all_games.size(); }
-        std::weak_ptr< std::deque<std::string> > get_moves() { return current_history; }
+        size_t active_games_count() noexcept
+        {
+            std::shared_lock<std::shared_mutex> guard(registry_lock);
+            return all_games.size();
+        }
+
+        std::weak_ptr< MoveLog > get_moves() { return current_history; }
+
+        // returns the status of the current game from its latest snapshot, this doesn't take any locks
+        GameStatus current_status() const
+        {
+            if ( !current_board ) return GameStatus();
 
-        // Create a new Board and stores it in memory with the other Boards.
-        std::shared_ptr<Board> new_game()
+            SnapshotCell<BoardSnapshot>::Reader board_state = current_board->snapshot();
+            return ( board_state ) ? board_state->status : GameStatus();
+        }
+
+        // gives access to the live games, iterating over it goes through them contiguously.
+        // This isn't thread-safe, so no other thread should create or end games meanwhile.
+        SlotMap<GameEntry>& games() noexcept { return all_games; }
+
+        // Create a new Board, store it in memory with the other Boards and return the handle to it.
+        GameHandle new_game()
         {
-            all_games.push_back( std::make_shared<Board>() );
-            moves_history.push_back( std::make_shared<std::deque<std::string>>() );
+            std::unique_lock<std::shared_mutex> guard(registry_lock);
 
-            // if this is the first game that wwe created, then we'll add this as the current board that we'll modify
-            if ( all_games.size() == 1 ) {
-                current_board = all_games.back();
-                current_history = moves_history.back();
+            std::shared_ptr<Board> board = std::make_shared<Board>();
+            std::shared_ptr<MoveLog> history = std::make_shared<MoveLog>();
+            history->reset( board->position() );
+
+            GameHandle handle = all_games.insert( GameEntry{ board, history, std::make_shared<std::mutex>(), std::make_shared<UndoStack>() } );
+
+            // if there isn't a board that we are modifying, then we'll add this as the current board
+            if ( !current_board ) {
+                set_current_entry(handle);
             }
             
 
-            return all_games.back();
+            return handle;
         }
 
-        // Returns the Board which is at the given index in the std::vector
-        std::weak_ptr<Board> get_game( size_t game_index ) noexcept
+        // Returns the Board of the given handle, or an empty std::weak_ptr if the game has already ended.
+        std::weak_ptr<Board> get_game( const GameHandle& handle ) noexcept
         {
-            if ( game_index < active_games_count() ) {
-                return all_games[game_index];
-            }
+            GameEntry entry;
 
-            else {
-                return std::weak_ptr<Board>();
-            }
+            return ( find_entry(handle, entry) ) ? entry.board : std::weak_ptr<Board>();
         }
 
-        // Delete a board which game has ended and remove it from our std::vector.
-        bool end_game( const size_t& game_index ) noexcept
+        // Delete a board which game has ended, the handles of the other games stay valid.
+        bool end_game( const GameHandle& handle ) noexcept
         {   
-            
-            if ( game_index < active_games_count() ) {
-                // we check if the current_board member points to the same object, if it doesnt, erase it too
-                if ( current_board == all_games[game_index] ) {
-                    current_board.reset();
-                    current_history.reset();
-                }
-            
-                all_games.erase(all_games.begin() + static_cast<int64_t>(game_index));
-                return true;
+            std::unique_lock<std::shared_mutex> guard(registry_lock);
+
+            // if the current_board member points to the same game, we reset it too
+            if ( handle == current_handle ) {
+                if ( current_board ) current_board->set_publish_hook(nullptr);
+                current_board.reset();
+                current_history.reset();
+                current_lock.reset();
+                current_undo.reset();
+                current_handle = GameHandle();
             }
 
-            else {
-                return false;
-            }
+            return all_games.erase(handle);
         }
 
+        // starts the history of the current board over from its position, this has to be called after the board was set up
         void reset_text() 
         {
-            current_history->clear();
+            std::lock_guard<std::mutex> guard(*current_lock);
+            current_history->reset( current_board->position() );
+            current_undo->undo.clear();
+            current_undo->redo.clear();
         }
         
-        // Set which board we are modifying from our array of Boards ( more specifically std::vector of std::shared_ptr's ).
-        bool set_current( const size_t& game_index ) noexcept
+        // Set which board we are modifying from our Boards.
+        bool set_current( const GameHandle& handle ) noexcept
         {   
-            if (  all_games.empty() ) return false;
-
-            current_board = all_games[ helper::clamp<uint32_t>(game_index, 0, all_games.size()-1) ];
-            current_history = moves_history[ helper::clamp<uint32_t>(game_index, 0, all_games.size()-1) ];
-
-            if ( !current_board || !current_history ) return false;
+            std::unique_lock<std::shared_mutex> guard(registry_lock);
+            return set_current_entry(handle);
+        }
 
-            return true;
+        // Returns the handle of the game that is currently modified.
+        GameHandle current_game() const noexcept
+        {
+            return this->current_handle;
         }
 
         // Returns the board that is the currently handled and modified state, in other words its held by the current_board member variable.
@@ -112,6 +356,158 @@ class Game
             return this->current_board;
         }
 
+
+
+        /**
+         * @brief Applies a move to the game of the given handle without going through the gui. This is thread-safe and only locks the given game.
+         * The move is checked against the legal moves that the board generated when the previous move was committed.
+         * @return MoveResult the status of the move, and whether it captured, gave check or ended the game
+         */
+        MoveResult apply_move( const GameHandle& handle, const Move& a_move )
+        {
+            MoveResult result;
+
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return result;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            return apply_locked(entry, a_move);
+        }
+
+        /**
+         * @brief Applies the moves in order, the game is locked only once for the whole batch. The first move that
+         * can't be applied stops the batch, the moves before it stay on the board.
+         * @return MovesResult how many moves were applied and the result of the last one that was tried
+         */
+        MovesResult apply_moves( const GameHandle& handle, helper::span<const Move> moves )
+        {
+            MovesResult result;
+
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return result;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            for ( const Move& a_move : moves ) {
+                result.last = apply_locked(entry, a_move);
+
+                if ( !result.last.applied() ) break;
+                result.applied++;
+            }
+
+            return result;
+        }
+
+        /**
+         * @brief Takes back the last move of the game in O(1), the board isn't rebuilt and the earlier moves aren't replayed.
+         * The move can be played again with redo() until a different move is played.
+         * @return false if the game doesn't exist or there's no move to take back.
+         */
+        bool undo( const GameHandle& handle )
+        {
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return false;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            UndoStack& stack = *entry.undo_stack;
+            if ( stack.undo.empty() ) return false;
+
+            if ( !entry.board->undo_move( stack.undo.back() ) ) return false;
+
+            stack.redo.push_back( stack.undo.back().position.move );
+            stack.undo.pop_back();
+            entry.history->pop_back();
+
+            return true;
+        }
+
+        // plays the last move that undo() took back, returns false if there's none.
+        bool redo( const GameHandle& handle )
+        {
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return false;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            if ( entry.undo_stack->redo.empty() ) return false;
+
+            // apply_locked() pops the redo stack when it plays the same move
+            return apply_locked( entry, entry.undo_stack->redo.back() ).applied();
+        }
+
+        // how many moves undo() and redo() can go backwards and forwards
+        bool undo_depth( const GameHandle& handle, size_t& undo_count, size_t& redo_count ) const
+        {
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return false;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            undo_count = entry.undo_stack->undo.size();
+            redo_count = entry.undo_stack->redo.size();
+
+            return true;
+        }
+
+
+        // writes the legal moves of the game into the list, returns false if the game doesn't exist.
+        bool legal_moves( const GameHandle& handle, MoveList& list ) const
+        {
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return false;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            if ( !entry.board->is_finished() ) {
+                for ( const Move& a_move : entry.board->legal_moves() ) list.push_back(a_move);
+            }
+
+            return true;
+        }
+
+        // writes the game as PGN, returns false if the game doesn't exist. The result comes from the checkmates and the stalemate
+        bool write_pgn( const GameHandle& handle, std::ostream& out, const std::vector<PgnTag>& tags = {} ) const
+        {
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return false;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            PgnWriter writer(out);
+            writer.write( *entry.history, tags, ( entry.board->status().stalemate ) ? "1/2-1/2" : std::string_view() );
+            return true;
+        }
+
+        // adds the game to an archive, returns false if the game doesn't exist. The result is found the same way as for write_pgn()
+        bool add_to_archive( const GameHandle& handle, GameArchiveWriter& writer, const std::vector<PgnTag>& tags = {} ) const
+        {
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return false;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            return writer.add( *entry.history, ( entry.board->status().stalemate ) ? "1/2-1/2" : std::string_view(), tags );
+        }
+
+        // copies the state of the game, returns false if the game doesn't exist.
+        bool read_state( const GameHandle& handle, GameState& state ) const
+        {
+            GameEntry entry;
+            if ( !find_entry(handle, entry) ) return false;
+
+            std::lock_guard<std::mutex> guard(*entry.lock);
+
+            state.position = entry.board->position();
+            state.status = entry.board->status();
+            state.finished = entry.board->is_finished();
+            state.in_check = state.status.in_check( state.status.side_to_move );
+            state.history_length = entry.history->size();
+
+            return true;
+        }
+
         
 
         /**
@@ -130,19 +526,23 @@ class Game
             std::shared_ptr<Piece> clicked_piece;
             std::vector< helper::coordinates<int64_t> > can_go;
             helper::coordinates<int64_t> move_vec; // well use this to check if the piece can move to a new location
-            size_t original_len = 0; // we'll use this to check if we've captured a piece
+            Position before; // the position before the move, the moves history needs it
             bool return_val = false;
             
+            std::lock_guard<std::mutex> guard(*current_lock);
 
             if ( current_board->is_finished() ) return false;
 
             // with this for loop we check if the square that we clicked on can be moved to by our piece,
             // so basically if the square is in the possible moves.
             clicked_piece = orig.lock()->get_piece().lock();
-            can_go = current_board->doesnt_get_in_check( clicked_piece, orig.lock()->coordinates() );
+
+            bool found = false;
+            can_go = precomputed_vectors( orig.lock()->coordinates(), found );
+            if ( !found ) can_go = current_board->doesnt_get_in_check( clicked_piece, orig.lock()->coordinates() );
 
 
-            original_len = captured_len( clicked_piece->tell_color_id() );
+            before = current_board->position();
             
             // this is the difference between the clicked_square and a_square.
             move_vec = current_board->convert_pos(click_coords.x, click_coords.y, width, height) - orig.lock()->coordinates();
@@ -151,12 +551,13 @@ class Game
 
                 if ( move_vec  == a_move ) {
                     
-                    // this if-statement is for castling
+                    // this if-statement is for castling, the king either moves 2 squares or, in shuffled games, it's moved onto its own rook
                     if ( clicked_piece->tell_id() == KING*pow(10, clicked_piece->tell_color_id()) && 
-                        (a_move.x == 2 || a_move.x == -2)) {
+                        ( a_move.x >= 2 || a_move.x <= -2 || 
+                          ( target.lock()->has_piece() && target.lock()->get_piece().lock()->tell_color_id() == clicked_piece->tell_color_id() ) ) ) {
                             
                             if ( current_board->king_rook_move( orig, target, a_move.x ) ) {
-                                current_history->push_back( ( a_move.x == -2 ) ? "0-0-0\n" : "0-0\n" );
+                                log_committed_move(before);
                                 return_val = true;
                                 break;
                             }
@@ -165,12 +566,7 @@ class Game
 
                     else if ( current_board->move_piece(orig, target ) ) {
 
-                        if ( original_len < captured_len( clicked_piece->tell_color_id() ) ) {
-                            current_history->push_back( clicked_piece->tell_name() + "x" + target.lock()->coordinates().toChesstring() + "\n" );
-                        }
-                        else {
-                            current_history->push_back( clicked_piece->tell_name() + target.lock()->coordinates().toChesstring() + "\n" );
-                        }
+                        log_committed_move(before);
                         return_val = true;
                         break;
                     }
@@ -178,18 +574,37 @@ class Game
             }
 
             // we tell the game object that we've executed a move on the board and now it should check whether the king is in check
-            if ( !current_board->checkmated().empty() ) {
-                current_board->end_game();
-                for ( const aString& color : current_board->checkmated() ) {
-                    current_history->push_back( "The color: " + color + " got checkmated.\n" );
-                }
-                
-            }
+            check_game_end( *current_board, *current_history );
 
             return return_val;
         }
 
 
+        /**
+         * @brief Returns the vectors of the squares that the piece on the square of the current game can move to,
+         * this is what the gui highlights when a piece is clicked. The moves are usually ready already, because the worker
+         * started grouping them when the board published the position, if not the board calculates them on this thread.
+         */
+        std::vector< helper::coordinates<int64_t> > possible_moves( const helper::coordinates<int64_t>& square )
+        {
+            if ( !current_board ) return std::vector< helper::coordinates<int64_t> >();
+
+            bool found = false;
+            std::vector< helper::coordinates<int64_t> > can_go = precomputed_vectors( square, found );
+            if ( found ) return can_go;
+
+            std::lock_guard<std::mutex> guard(*current_lock);
+
+            std::weak_ptr<Square> a_square = current_board->get_square(square);
+            if ( a_square.expired() ) return can_go;
+
+            return current_board->doesnt_get_in_check( a_square.lock()->get_piece(), square );
+        }
+
+        // how many positions the background worker has grouped the moves of
+        uint64_t precomputed_count() const noexcept { return precomputer.computed_count(); }
+
+
 
         
 
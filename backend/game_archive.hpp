@@ -0,0 +1,834 @@
+#ifndef GAME_ARCHIVE
+#define GAME_ARCHIVE
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+#include "evaluation.hpp"
+#include "move_log.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "pgn.hpp"
+
+
+/*
+ A binary file of games. Every move is stored as three ranks: the type of the moving piece, which of the own
+ pieces of that type moves and the rank of the move in the pseudo legal moves of that piece, sorted by a cheap
+ guess of how good the move is, so the moves that are really played get small ranks. The reader only generates
+ the moves of a single piece for every move. The ranks are range coded with a model for each of the three,
+ counted over the whole archive and stored in the header.
+
+ The file is a 32 byte header, the models, the games and an index with the offset of every game, so a single game
+ can be read without reading the ones before it. All numbers are little endian.
+*/
+namespace archive
+{
+
+constexpr std::array<char, 4> file_magic = { 'C', 'G', 'A', '4' };
+constexpr uint32_t HEADER_SIZE = 32;
+
+// the ranks are coded with the context of the number of bits that the largest possible rank needs,
+// a choice between a single piece or move needs no bits at all. A queen has at most 27 moves
+constexpr uint32_t CONTEXTS = 6;
+constexpr uint32_t MODEL_SYMBOLS = ( 1 << CONTEXTS ) - 2; // 2 + 4 + ... + 32
+constexpr uint32_t MODEL_SIZE = MODEL_SYMBOLS * 2;
+constexpr uint32_t MODEL_TOTAL = 1 << 15;
+constexpr uint32_t MAX_CHOICES = 1 << ( CONTEXTS - 1 );
+
+// the models of the three ranks of a move, in the order they are coded
+constexpr uint32_t PIECE_TYPE_MODEL = 0;
+constexpr uint32_t PIECE_MODEL = 1;
+constexpr uint32_t TARGET_MODEL = 2;
+constexpr uint32_t MODELS = 3;
+
+// the flags of a game record
+constexpr uint8_t CUSTOM_START = 1;
+constexpr uint8_t HAS_TAGS = 2;
+
+constexpr inline uint32_t context_of( const uint32_t& move_count ) noexcept
+{
+    uint32_t bits = 0;
+    while ( ( 1u << bits ) < move_count ) bits++;
+    return bits;
+}
+
+// where the symbols of a context start in the model
+constexpr inline uint32_t context_offset( const uint32_t& context ) noexcept { return ( 1u << context ) - 2; }
+
+
+inline uint8_t result_code( const std::string_view& result ) noexcept
+{
+    if ( result == "1-0" ) return 1;
+    if ( result == "0-1" ) return 2;
+    if ( result == "1/2-1/2" ) return 3;
+    return 0;
+}
+
+inline const char* result_text( const uint8_t& code ) noexcept
+{
+    switch ( code ) {
+        case 1: return "1-0";
+        case 2: return "0-1";
+        case 3: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+
+inline void put_varint( std::vector<uint8_t>& out, uint64_t value )
+{
+    while ( value >= 0x80 ) {
+        out.push_back( static_cast<uint8_t>( value | 0x80 ) );
+        value >>= 7;
+    }
+    out.push_back( static_cast<uint8_t>(value) );
+}
+
+// returns false if the number runs past the end
+inline bool get_varint( const uint8_t*& cursor, const uint8_t* end, uint64_t& value ) noexcept
+{
+    value = 0;
+
+    for ( uint32_t shift = 0; shift < 64; shift += 7 ) {
+        if ( cursor == end ) return false;
+
+        uint8_t byte = *cursor++;
+        value |= static_cast<uint64_t>( byte & 0x7F ) << shift;
+        if ( !( byte & 0x80 ) ) return true;
+    }
+
+    return false;
+}
+
+inline void put_bytes( std::vector<uint8_t>& out, const std::string_view& text )
+{
+    put_varint( out, text.size() );
+    out.insert( out.end(), text.begin(), text.end() );
+}
+
+inline bool get_bytes( const uint8_t*& cursor, const uint8_t* end, std::string& text )
+{
+    uint64_t length;
+    if ( !get_varint( cursor, end, length ) || length > static_cast<uint64_t>( end - cursor ) ) return false;
+
+    text.assign( reinterpret_cast<const char*>(cursor), static_cast<size_t>(length) );
+    cursor += length;
+    return true;
+}
+
+inline uint64_t read_u64( const uint8_t* bytes ) noexcept
+{
+    uint64_t value = 0;
+    for ( uint32_t i = 0; i < 8; i++ ) value |= static_cast<uint64_t>( bytes[i] ) << ( 8*i );
+    return value;
+}
+
+inline void write_u64( std::ofstream& stream, uint64_t value )
+{
+    for ( uint32_t i = 0; i < 8; i++ ) {
+        stream.put( static_cast<char>( value & 0xFF ) );
+        value >>= 8;
+    }
+}
+
+
+
+/*
+ The moves are sorted by a key that puts the likely moves first: captures of big pieces with small ones,
+ promotions, moves to better squares of the piece-square tables and no moves of pieces onto squares that
+ an enemy pawn attacks. The guess is rounded to one of 64 classes and the move itself is the low half of the key,
+ so the keys are unique and the order is the same for the writer and the reader.
+*/
+constexpr uint32_t MOVE_CLASSES = 64;
+constexpr uint32_t TACTICAL_CLASSES = 24;
+
+// the parts of the guess that only depend on the piece types, so a key needs no divisions
+struct rank_terms
+{
+    std::array<int32_t, PIECES_COUNT> capture{};  // 1000 minus an eighth of the capturing piece
+    std::array<int32_t, PIECES_COUNT> victim{};   // four times the captured piece
+    std::array<int32_t, PIECES_COUNT> exposed{};  // half the piece if an enemy pawn attacks the target, pawns don't mind
+};
+
+constexpr rank_terms make_rank_terms() noexcept
+{
+    rank_terms terms{};
+
+    for ( uint32_t type = 0; type < PIECES_COUNT; type++ ) {
+        terms.capture[type] = 1000 - evaluation::piece_values[type] / 8;
+        terms.victim[type] = 4 * evaluation::piece_values[type];
+        terms.exposed[type] = ( type == PAWN ) ? 0 : evaluation::piece_values[type] / 2;
+    }
+
+    return terms;
+}
+
+constexpr rank_terms rank_term_table = make_rank_terms();
+
+inline mask pawn_attacks( const Position& pos, const uint32_t& color ) noexcept
+{
+    mask pawns = pos.pieces(color, PAWN);
+
+    if ( color == WHITE ) return ( ( pawns << 7 ) & ~bitboard::FILE_H ) | ( ( pawns << 9 ) & ~bitboard::FILE_A );
+    return ( ( pawns >> 9 ) & ~bitboard::FILE_H ) | ( ( pawns >> 7 ) & ~bitboard::FILE_A );
+}
+
+// fills keys with the keys of the moves of the piece on from, in the order of the list. The moves all have
+// the same piece, so its terms are looked up once
+inline void rank_keys( const Position& pos, const int32_t& from, const MoveList& candidates, const mask& enemy_pawn_attacks,
+                       std::array<uint32_t, 256>& keys ) noexcept
+{
+    const uint32_t flip = ( pos.side_to_move() == WHITE ) ? 0 : 56;
+    const uint32_t type = piece_type( pos.piece_on(from) );
+    const std::array<int32_t, 64>& table = evaluation::square_tables[type];
+    const int32_t leave = table[ from ^ flip ];
+    const int32_t capture = rank_term_table.capture[type];
+    const int32_t exposed = rank_term_table.exposed[type];
+
+    for ( uint32_t i = 0; i < candidates.size(); i++ ) {
+        const Move& a_move = candidates[i];
+        int32_t score = table[ a_move.to() ^ flip ] - leave;
+
+        if ( a_move.is_capture() ) {
+            uint32_t victim = ( a_move.is_en_passant() ) ? static_cast<uint32_t>(PAWN) : piece_type( pos.piece_on( a_move.to() ) );
+            score += capture + rank_term_table.victim[victim];
+        }
+
+        if ( a_move.is_promotion() ) score += evaluation::piece_values[ a_move.promotion_piece() ];
+        else if ( enemy_pawn_attacks & bitboard::square_bit( a_move.to() ) ) score -= exposed;
+
+        // the captures and promotions get the first 24 classes in steps of 128, the quiet moves the others in steps of 8.
+        // A quiet move never scores 800, the piece-square tables differ by less than that
+        int32_t move_class = ( score >= 800 ) ? helper::clamp<int32_t>( ( 4000 - score ) >> 7, 0, TACTICAL_CLASSES - 1 )
+                                              : TACTICAL_CLASSES + helper::clamp<int32_t>( ( 100 - score ) >> 3, 0, MOVE_CLASSES - TACTICAL_CLASSES - 1 );
+
+        keys[i] = ( static_cast<uint32_t>(move_class) << 16 ) | a_move.data;
+    }
+}
+
+// the square of the n-th set bit, counted from the lowest one
+inline int32_t nth_square( mask bits, uint32_t n ) noexcept
+{
+    while ( n-- > 0 ) bits &= bits - 1;
+    return bitboard::lsb(bits);
+}
+
+// a range coder with 32 bits of range, the carries go into the bytes that are already written
+class RangeEncoder
+{
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t low = 0;
+        uint32_t range = 0xFFFFFFFF;
+        uint8_t cache = 0;
+        uint64_t cache_size = 1;
+        bool first = true;
+        size_t begin;
+
+        void shift_low()
+        {
+            if ( static_cast<uint32_t>(low) < 0xFF000000 || ( low >> 32 ) != 0 ) {
+                uint8_t carry = static_cast<uint8_t>( low >> 32 );
+                uint8_t byte = cache;
+
+                do {
+                    // the first byte is always zero, so it isn't stored
+                    if ( !first ) out.push_back( static_cast<uint8_t>( byte + carry ) );
+                    first = false;
+                    byte = 0xFF;
+                } while ( --cache_size != 0 );
+
+                cache = static_cast<uint8_t>( low >> 24 );
+            }
+
+            cache_size++;
+            low = ( low & 0x00FFFFFF ) << 8;
+        }
+
+
+    public:
+        explicit RangeEncoder( std::vector<uint8_t>& out0 ) : out(out0), begin( out0.size() ) { }
+
+        void encode( const uint32_t& start, const uint32_t& size, const uint32_t& total )
+        {
+            range /= total;
+            low += static_cast<uint64_t>(start) * range;
+            range *= size;
+
+            while ( range < ( 1u << 24 ) ) {
+                range <<= 8;
+                shift_low();
+            }
+        }
+
+        // we pick the value of the range with the most zero bits at the end, the reader sees zeros after the
+        // last byte, so the zero bytes at the end are left out
+        void finish()
+        {
+            for ( uint32_t bits = 32; bits > 0; bits-- ) {
+                uint64_t low_bits = ( 1ULL << bits ) - 1;
+                uint64_t value = ( low + low_bits ) & ~low_bits;
+
+                if ( value < low + range ) {
+                    low = value;
+                    break;
+                }
+            }
+
+            for ( uint32_t i = 0; i < 5; i++ ) shift_low();
+            while ( out.size() > begin && out.back() == 0 ) out.pop_back();
+        }
+};
+
+
+class RangeDecoder
+{
+    private:
+        const uint8_t* cursor;
+        const uint8_t* end;
+        uint32_t code = 0;
+        uint32_t range = 0xFFFFFFFF;
+
+        inline uint8_t next_byte() noexcept { return ( cursor < end ) ? *cursor++ : 0; }
+
+
+    public:
+        RangeDecoder( const uint8_t* begin, const uint8_t* end0 ) noexcept : cursor(begin), end(end0)
+        {
+            for ( uint32_t i = 0; i < 4; i++ ) code = ( code << 8 ) | next_byte();
+        }
+
+        // the position of the next symbol inside the total, it's followed by a call to remove()
+        inline uint32_t target( const uint32_t& total ) noexcept
+        {
+            range /= total;
+            return std::min( code / range, total - 1 );
+        }
+
+        inline void remove( const uint32_t& start, const uint32_t& size ) noexcept
+        {
+            code -= start * range;
+            range *= size;
+
+            while ( range < ( 1u << 24 ) ) {
+                code = ( code << 8 ) | next_byte();
+                range <<= 8;
+            }
+        }
+};
+
+
+
+// the frequencies of the ranks for every context, with the sums of the frequencies before every rank
+struct RankModel
+{
+    std::array<uint16_t, MODEL_SYMBOLS> frequencies{};
+    std::array<uint32_t, MODEL_SYMBOLS + CONTEXTS> starts{};
+
+    // scales the counts of every context to MODEL_TOTAL, every rank keeps at least a frequency of one
+    void build( const std::array<uint64_t, MODEL_SYMBOLS>& counts ) noexcept
+    {
+        for ( uint32_t context = 1; context < CONTEXTS; context++ ) {
+            uint32_t offset = context_offset(context);
+            uint32_t symbols = 1u << context;
+            uint64_t sum = 0;
+
+            for ( uint32_t i = 0; i < symbols; i++ ) sum += counts[ offset + i ];
+
+            uint64_t spare = MODEL_TOTAL - symbols;
+
+            for ( uint32_t i = 0; i < symbols; i++ ) {
+                uint64_t share = ( sum > 0 ) ? counts[ offset + i ] * spare / sum : 0;
+                frequencies[ offset + i ] = static_cast<uint16_t>( 1 + share );
+            }
+        }
+
+        refresh();
+    }
+
+    void refresh() noexcept
+    {
+        for ( uint32_t context = 1; context < CONTEXTS; context++ ) {
+            uint32_t offset = context_offset(context);
+            uint32_t* context_starts = starts.data() + offset + context - 1;
+            uint32_t sum = 0;
+
+            for ( uint32_t i = 0; i < ( 1u << context ); i++ ) {
+                context_starts[i] = sum;
+                sum += frequencies[ offset + i ];
+            }
+
+            context_starts[ 1u << context ] = sum;
+        }
+    }
+
+    // the sums of the frequencies of a context, one more than the context has ranks
+    inline const uint32_t* starts_of( const uint32_t& context ) const noexcept { return starts.data() + context_offset(context) + context - 1; }
+};
+
+// codes a rank below count, only the ranks below count are possible, so the others are left out of the total
+inline void encode_rank( RangeEncoder& encoder, const RankModel& model, const uint32_t& rank, const uint32_t& count )
+{
+    uint32_t context = context_of(count);
+    if ( context == 0 ) return;
+
+    const uint32_t* starts = model.starts_of(context);
+    encoder.encode( starts[rank], starts[rank + 1] - starts[rank], starts[count] );
+}
+
+// count has to be at most MAX_CHOICES
+inline uint32_t decode_rank( RangeDecoder& decoder, const RankModel& model, const uint32_t& count ) noexcept
+{
+    uint32_t context = context_of(count);
+    if ( context == 0 ) return 0;
+
+    const uint32_t* starts = model.starts_of(context);
+    uint32_t target = decoder.target( starts[count] );
+    uint32_t rank = 0;
+
+    while ( starts[rank + 1] <= target ) rank++;
+    decoder.remove( starts[rank], starts[rank + 1] - starts[rank] );
+    return rank;
+}
+
+}
+
+
+
+/*
+ Collects games and writes them into an archive. The ranks of the moves are found when a game is added, the
+ models are counted over every game and the games are coded when the archive is written.
+*/
+class GameArchiveWriter
+{
+    private:
+        struct PendingGame
+        {
+            size_t record_begin; // the record without the coded moves
+            size_t record_end;
+            size_t ranks_begin;
+            size_t ranks_end;
+        };
+
+        std::vector<PendingGame> games;
+        std::vector<uint8_t> records;
+        // the piece type, the piece and the target of every move, each as the rank and the number of choices minus one
+        std::vector<uint8_t> ranks;
+        std::array<std::array<uint64_t, archive::MODEL_SYMBOLS>, archive::MODELS> counts{};
+
+
+    public:
+        GameArchiveWriter() { }
+
+        /**
+         * @brief Adds a game, the moves are checked while they are ranked.
+         *
+         * @param result "1-0", "0-1", "1/2-1/2" or "*"
+         * @return false if the start can't be stored or a move isn't legal, the game isn't added then
+         */
+        bool add( const Position& start, helper::span<const Move> moves, const std::string_view& result = "*", const std::vector<PgnTag>& tags = {} )
+        {
+            // the reader restores the start from its packed form, a start that it would refuse makes the game unreadable
+            PackedPosition packed_start = start.packed();
+            Position restored;
+            if ( !restored.set_packed(packed_start) ) return false;
+
+            size_t ranks_begin = ranks.size();
+            Position pos = start;
+            MoveList candidates;
+            std::array<uint32_t, 256> keys;
+
+            for ( const Move& a_move : moves ) {
+                // the list is empty if there is no own piece on the square
+                candidates.clear();
+                pos.generate_pseudo_legal_from( a_move.from(), candidates );
+
+                mask enemy_pawn_attacks = archive::pawn_attacks( pos, pos.side_to_move() ^ 1 );
+                archive::rank_keys( pos, a_move.from(), candidates, enemy_pawn_attacks, keys );
+
+                uint32_t count = candidates.size();
+                uint32_t played = UINT32_MAX;
+                uint32_t rank = 0;
+
+                for ( uint32_t i = 0; i < count; i++ ) {
+                    if ( ( keys[i] & 0xFFFF ) == a_move.data ) played = keys[i];
+                }
+
+                for ( uint32_t i = 0; i < count; i++ ) rank += keys[i] < played;
+
+                if ( played == UINT32_MAX || !pos.leaves_king_safe(a_move) ) {
+                    ranks.resize(ranks_begin);
+                    return false;
+                }
+
+                uint32_t type = piece_type( pos.piece_on( a_move.from() ) );
+                mask same_type = pos.pieces( pos.side_to_move(), type );
+                uint32_t pieces = static_cast<uint32_t>( bitboard::popcount(same_type) );
+                uint32_t index = static_cast<uint32_t>( bitboard::popcount( same_type & ( bitboard::square_bit( a_move.from() ) - 1 ) ) );
+
+                // a set up position can have more pieces of a type than a model has ranks
+                if ( pieces > archive::MAX_CHOICES ) {
+                    ranks.resize(ranks_begin);
+                    return false;
+                }
+
+                const uint32_t move_ranks[] = { type - PAWN, PIECES_COUNT - 1 - PAWN, index, pieces - 1, rank, count - 1 };
+                for ( const uint32_t& value : move_ranks ) ranks.push_back( static_cast<uint8_t>(value) );
+                pos.play(a_move);
+            }
+
+            for ( size_t i = ranks_begin; i < ranks.size(); i += 2 ) {
+                uint32_t context = archive::context_of( ranks[i + 1] + 1u );
+                if ( context > 0 ) counts[ ( i / 2 ) % archive::MODELS ][ archive::context_offset(context) + ranks[i] ]++;
+            }
+
+            PendingGame game;
+            game.record_begin = records.size();
+            game.ranks_begin = ranks_begin;
+            game.ranks_end = ranks.size();
+
+            bool custom_start = packed_start != Position::start_position().packed();
+            uint8_t flags = ( custom_start ? archive::CUSTOM_START : 0 ) | ( tags.empty() ? 0 : archive::HAS_TAGS );
+
+            archive::put_varint( records, moves.size() );
+            records.push_back( archive::result_code(result) );
+            records.push_back(flags);
+
+            if ( custom_start ) records.insert( records.end(), packed_start.bytes.begin(), packed_start.bytes.end() );
+
+            if ( !tags.empty() ) {
+                archive::put_varint( records, tags.size() );
+
+                for ( const PgnTag& a_tag : tags ) {
+                    archive::put_bytes( records, a_tag.name );
+                    archive::put_bytes( records, a_tag.value );
+                }
+            }
+
+            game.record_end = records.size();
+            games.push_back(game);
+            return true;
+        }
+
+        // adds a game that was read by the PgnReader, with its tags
+        bool add( const PgnGame& game )
+        {
+            return add( game.start, helper::span<const Move>( game.moves.data(), game.moves.size() ), game.result, game.tags );
+        }
+
+        // adds the game of a move log, an empty result is taken from the checkmates in the log
+        bool add( const MoveLog& log, std::string_view result = std::string_view(), const std::vector<PgnTag>& tags = {} )
+        {
+            if ( result.empty() ) result = ( log.is_checkmated(WHITE) ) ? "0-1" : ( log.is_checkmated(BLACK) ) ? "1-0" : "*";
+
+            std::vector<Move> moves;
+            moves.reserve( log.size() );
+            for ( size_t ply = 0; ply < log.size(); ply++ ) moves.push_back( log[ply].move );
+
+            return add( log.start_position(), helper::span<const Move>( moves.data(), moves.size() ), result, tags );
+        }
+
+
+        // writes the archive, returns false if the file can't be written
+        bool write( const std::string& path ) const
+        {
+            std::ofstream stream( path, std::ios::binary | std::ios::trunc );
+            if ( !stream ) return false;
+
+            std::array<archive::RankModel, archive::MODELS> models;
+            for ( uint32_t i = 0; i < archive::MODELS; i++ ) models[i].build( counts[i] );
+
+            std::vector<uint8_t> body;
+            std::vector<uint8_t> coded;
+            std::vector<uint64_t> offsets;
+            offsets.reserve( games.size() );
+
+            uint64_t offset = archive::HEADER_SIZE + archive::MODELS * archive::MODEL_SIZE;
+
+            for ( const PendingGame& game : games ) {
+                coded.clear();
+                archive::RangeEncoder encoder(coded);
+
+                for ( size_t i = game.ranks_begin; i < game.ranks_end; i += 2 ) {
+                    archive::encode_rank( encoder, models[ ( i / 2 ) % archive::MODELS ], ranks[i], ranks[i + 1] + 1u );
+                }
+
+                encoder.finish();
+
+                offsets.push_back( offset + body.size() );
+                body.insert( body.end(), records.begin() + static_cast<std::ptrdiff_t>( game.record_begin ), records.begin() + static_cast<std::ptrdiff_t>( game.record_end ) );
+                archive::put_varint( body, coded.size() );
+                body.insert( body.end(), coded.begin(), coded.end() );
+            }
+
+            stream.write( archive::file_magic.data(), 4 );
+            stream.put( static_cast<char>( archive::CONTEXTS ) );
+            for ( uint32_t i = 0; i < 3; i++ ) stream.put(0);
+            archive::write_u64( stream, games.size() );
+            archive::write_u64( stream, move_count() );
+            archive::write_u64( stream, offset + body.size() );
+
+            for ( const archive::RankModel& model : models ) {
+                for ( const uint16_t& frequency : model.frequencies ) {
+                    stream.put( static_cast<char>( frequency & 0xFF ) );
+                    stream.put( static_cast<char>( frequency >> 8 ) );
+                }
+            }
+
+            stream.write( reinterpret_cast<const char*>( body.data() ), static_cast<std::streamsize>( body.size() ) );
+            for ( const uint64_t& game_offset : offsets ) archive::write_u64( stream, game_offset );
+
+            return static_cast<bool>(stream);
+        }
+
+        inline size_t game_count() const noexcept { return games.size(); }
+        inline size_t move_count() const noexcept { return ranks.size() / ( 2 * archive::MODELS ); }
+};
+
+
+
+/*
+ An archive that is memory mapped. The games are decoded into the PgnGame of the PGN reader, so they can be
+ written as PGN or replayed the same way as the games of a PGN file. Reading doesn't change the archive, so many
+ threads can read games at the same time.
+*/
+class GameArchive
+{
+    private:
+        MappedFile file;
+        std::array<archive::RankModel, archive::MODELS> models;
+        uint64_t games = 0;
+        uint64_t moves = 0;
+        const uint8_t* index = nullptr;
+
+        inline const uint8_t* data_end() const noexcept { return index; }
+
+        // returns the key that has rank smaller keys, the moves of a single piece are few enough to count for every key
+        static uint32_t key_of_rank( const std::array<uint32_t, 256>& keys, const uint32_t& count, const uint32_t& rank ) noexcept
+        {
+            for ( uint32_t i = 0; i < count; i++ ) {
+                uint32_t smaller = 0;
+                for ( uint32_t j = 0; j < count; j++ ) smaller += keys[j] < keys[i];
+                if ( smaller == rank ) return keys[i];
+            }
+
+            return 0;
+        }
+
+
+    public:
+        GameArchive() { }
+
+        explicit GameArchive( const std::string& path ) { load(path); }
+
+        // maps the archive, returns false if the file can't be opened or its header and index don't fit
+        bool load( const std::string& path )
+        {
+            games = 0;
+            moves = 0;
+            index = nullptr;
+
+            const uint64_t data_begin = archive::HEADER_SIZE + archive::MODELS * archive::MODEL_SIZE;
+            if ( !file.open(path) || file.size() < data_begin ) return false;
+
+            const uint8_t* header = file.data();
+            if ( !std::equal( archive::file_magic.begin(), archive::file_magic.end(), header ) || header[4] != archive::CONTEXTS ) return false;
+
+            uint64_t count = archive::read_u64( header + 8 );
+            uint64_t index_offset = archive::read_u64( header + 24 );
+
+            if ( index_offset < data_begin || index_offset > file.size()
+                 || ( file.size() - index_offset ) / 8 != count || ( file.size() - index_offset ) % 8 != 0 ) return false;
+
+            const uint8_t* frequencies = header + archive::HEADER_SIZE;
+
+            for ( archive::RankModel& model : models ) {
+                for ( uint32_t i = 0; i < archive::MODEL_SYMBOLS; i++ ) {
+                    model.frequencies[i] = static_cast<uint16_t>( frequencies[2*i] | ( frequencies[2*i + 1] << 8 ) );
+                    if ( model.frequencies[i] == 0 ) return false;
+                }
+
+                model.refresh();
+                frequencies += archive::MODEL_SIZE;
+
+                // a bigger total than the writer makes could leave the decoder without range
+                for ( uint32_t context = 1; context < archive::CONTEXTS; context++ ) {
+                    if ( model.starts_of(context)[ 1u << context ] > archive::MODEL_TOTAL ) return false;
+                }
+            }
+
+            games = count;
+            moves = archive::read_u64( header + 16 );
+            index = file.data() + index_offset;
+            return true;
+        }
+
+        /**
+         * @brief Decodes a single game.
+         *
+         * @param number the number of the game in the archive, starting at zero
+         * @param game gets the game, its offset is the offset of the record in the file
+         * @return false if there is no such game or its record is damaged, the moves before the damage are kept
+         */
+        bool read( const uint64_t& number, PgnGame& game ) const
+        {
+            game.clear();
+            if ( number >= games ) return false;
+
+            game.offset = static_cast<size_t>( archive::read_u64( index + 8*number ) );
+            game.valid = false;
+
+            const uint8_t* end = data_end();
+            if ( game.offset >= static_cast<size_t>( end - file.data() ) ) return false;
+
+            const uint8_t* cursor = file.data() + game.offset;
+
+            uint64_t plies;
+            if ( !archive::get_varint( cursor, end, plies ) || end - cursor < 2 ) return false;
+
+            game.result = archive::result_text( cursor[0] );
+            uint8_t flags = cursor[1];
+            cursor += 2;
+
+            if ( flags & archive::CUSTOM_START ) {
+                PackedPosition packed_start;
+                if ( end - cursor < 32 ) return false;
+
+                std::memcpy( packed_start.bytes.data(), cursor, 32 );
+                cursor += 32;
+                if ( !game.start.set_packed(packed_start) ) return false;
+            }
+
+            if ( flags & archive::HAS_TAGS ) {
+                uint64_t tag_count;
+                if ( !archive::get_varint( cursor, end, tag_count ) ) return false;
+
+                for ( uint64_t i = 0; i < tag_count; i++ ) {
+                    PgnTag a_tag;
+                    if ( !archive::get_bytes( cursor, end, a_tag.name ) || !archive::get_bytes( cursor, end, a_tag.value ) ) return false;
+                    game.tags.push_back( std::move(a_tag) );
+                }
+            }
+
+            uint64_t coded_size;
+            if ( !archive::get_varint( cursor, end, coded_size ) || coded_size > static_cast<uint64_t>( end - cursor ) ) return false;
+
+            archive::RangeDecoder decoder( cursor, cursor + coded_size );
+            Position pos = game.start;
+            MoveList candidates;
+            std::array<uint32_t, 256> keys;
+
+            game.moves.reserve( static_cast<size_t>( std::min<uint64_t>( plies, 1024 ) ) );
+
+            for ( uint64_t ply = 0; ply < plies; ply++ ) {
+                // the piece type and the piece are coded before the target, so only the moves of that piece are generated
+                uint32_t type = PAWN + archive::decode_rank( decoder, models[archive::PIECE_TYPE_MODEL], PIECES_COUNT - PAWN );
+                mask same_type = pos.pieces( pos.side_to_move(), type );
+                uint32_t pieces = static_cast<uint32_t>( bitboard::popcount(same_type) );
+                if ( pieces == 0 || pieces > archive::MAX_CHOICES ) return false;
+
+                int32_t from = archive::nth_square( same_type, archive::decode_rank( decoder, models[archive::PIECE_MODEL], pieces ) );
+
+                candidates.clear();
+                pos.generate_pseudo_legal_from( from, candidates );
+
+                uint32_t count = candidates.size();
+                if ( count == 0 || count > archive::MAX_CHOICES ) return false;
+
+                uint32_t rank = archive::decode_rank( decoder, models[archive::TARGET_MODEL], count );
+
+                mask enemy_pawn_attacks = archive::pawn_attacks( pos, pos.side_to_move() ^ 1 );
+                archive::rank_keys( pos, from, candidates, enemy_pawn_attacks, keys );
+                uint32_t key = key_of_rank( keys, count, rank );
+
+                // the ranks are always below the number of choices and the move is checked, so even a damaged
+                // record only decodes legal moves
+                Move a_move( static_cast<uint16_t>( key & 0xFFFF ) );
+                if ( !pos.leaves_king_safe(a_move) ) return false;
+
+                game.moves.push_back(a_move);
+                pos.play(a_move);
+            }
+
+            game.valid = true;
+            return true;
+        }
+
+
+        /**
+         * @brief Decodes every game in order.
+         * @param on_game is called as on_game( const PgnGame& ) after every game, the game is reused after the call
+         */
+        template<typename F>
+        PgnStats read( F on_game ) const
+        {
+            PgnStats stats;
+            auto start = std::chrono::steady_clock::now();
+            PgnGame game;
+
+            for ( uint64_t i = 0; i < games; i++ ) {
+                if ( !read(i, game) ) stats.invalid_games++;
+
+                stats.games++;
+                stats.moves += game.moves.size();
+                on_game(game);
+            }
+
+            stats.bytes = file.size();
+            stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+            return stats;
+        }
+
+
+        /**
+         * @brief Decodes the games with the threads of the pool, the index lets every thread start at its own games.
+         * @param on_game is called as on_game( worker_index, const PgnGame& ) from the threads of the pool at the same time
+         */
+        template<typename F>
+        PgnStats read_parallel( ThreadPool& pool, F on_game ) const
+        {
+            PgnStats stats;
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<PgnStats> worker_stats( pool.size() );
+
+            pool.parallel_for( static_cast<size_t>(games), 256, [&]( size_t worker, size_t begin, size_t end ) {
+                PgnGame game;
+                PgnStats& local = worker_stats[worker];
+
+                for ( size_t i = begin; i < end; i++ ) {
+                    if ( !read(i, game) ) local.invalid_games++;
+
+                    local.games++;
+                    local.moves += game.moves.size();
+                    on_game( worker, game );
+                }
+            } );
+
+            for ( const PgnStats& worker : worker_stats ) {
+                stats.games += worker.games;
+                stats.moves += worker.moves;
+                stats.invalid_games += worker.invalid_games;
+            }
+
+            stats.bytes = file.size();
+            stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+            return stats;
+        }
+
+        inline bool is_open() const noexcept { return index != nullptr; }
+        inline uint64_t size() const noexcept { return games; }
+        inline uint64_t move_count() const noexcept { return moves; }
+};
+
+#endif
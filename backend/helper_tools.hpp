@@ -47,6 +47,29 @@ static std::array<std::string, 8> chess_letters = {"a", "b", "c", "d", "e", "f",
 
 
 
+// C++17 doesn't have std::span, so we use this small non-owning view
+// when a function takes a contiguous range of objects.
+template <typename T>
+struct span
+{
+    T* ptr = nullptr;
+    size_t len = 0;
+
+    constexpr span() noexcept { }
+    constexpr span( T* ptr0, size_t len0 ) noexcept : ptr(ptr0), len(len0) { }
+
+    template <typename C>
+    constexpr span( C& container ) noexcept : ptr( container.data() ), len( container.size() ) { }
+
+    constexpr size_t size() const noexcept { return len; }
+    constexpr bool empty() const noexcept { return len == 0; }
+    constexpr T* data() const noexcept { return ptr; }
+    constexpr T* begin() const noexcept { return ptr; }
+    constexpr T* end() const noexcept { return ptr + len; }
+    constexpr T& operator [] ( const size_t& index ) const noexcept { return ptr[index]; }
+};
+
+
 // we create a clamp function to only choose the value if its
 // in the accepted range
 template <typename T>
@@ -139,20 +162,21 @@ struct coordinates
 
 
 
-template<typename T, typename D>
+// the size of the board is given at compile time, the default is the normal 8x8 board
+template<uint32_t Files = 8, uint32_t Ranks = Files, typename T, typename D>
 inline coordinates<int64_t> square_to_pos( const coordinates<T>& coords, const D& screen_width, const D& screen_height, const bool& use_clamp )
 {
     T x = coords.x;
     T y = coords.y;
     
     if ( use_clamp ) {
-        x = clamp<T>(x, 0, 7);
-        y = clamp<T>(y, 0, 7);
+        x = clamp<T>(x, 0, Files - 1);
+        y = clamp<T>(y, 0, Ranks - 1);
     }
     
 
-    D square_width = screen_width/8;
-    D square_height = screen_height/8;
+    D square_width = screen_width/Files;
+    D square_height = screen_height/Ranks;
 
     T x1 = x*square_width;
     T y1 = y*square_height;
@@ -0,0 +1,188 @@
+#ifndef KPK_BITBASE
+#define KPK_BITBASE
+
+#include <cstdint>
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+
+
+/*
+ Whether king and pawn against king is won, for every position. The table is calculated by the compiler, so it's
+ part of the binary and costs nothing at startup. The white side has the pawn, and the pawn is on the files a to d,
+ the other positions are mirrored into these.
+
+ The positions are calculated a whole mask at a time: for a pawn square and a white king square one mask holds
+ every black king square. White to move wins when a move reaches a won position with black to move, and black to move
+ loses when none of its king moves leaves the won positions. Every pass uses the results of the previous squares
+ right away and 12 passes are enough to reach every won position. A promotion that the black king can't take right away
+ is counted as a win.
+*/
+namespace kpk
+{
+
+constexpr uint32_t PAWN_SQUARES = 24; // files a to d and ranks 2 to 7
+
+constexpr inline uint32_t pawn_index( const int32_t& pawn ) noexcept
+{
+    return static_cast<uint32_t>( ( bitboard::rank_of(pawn) - 1 ) * 4 + bitboard::file_of(pawn) );
+}
+
+
+// the squares that are next to at least one square of the mask
+constexpr inline mask king_spread( const mask& m ) noexcept
+{
+    mask left = ( m >> 1 ) & ~bitboard::FILE_H;
+    mask right = ( m << 1 ) & ~bitboard::FILE_A;
+    mask row = m | left | right;
+
+    return left | right | ( row << 8 ) | ( row >> 8 );
+}
+
+
+// the black king squares where white wins, indexed by the white king square. The tables are split by the pawn square
+// and use plain arrays, that makes the compile time evaluation a lot cheaper
+struct pawn_slice
+{
+    mask white_to_move[64]{};
+    mask black_to_move[64]{};
+};
+
+struct bitbase_tables
+{
+    pawn_slice slices[PAWN_SQUARES]{};
+};
+
+
+constexpr void update_square( bitbase_tables& tables, const int32_t& pawn, const int32_t& king ) noexcept
+{
+    const mask pawn_bit = bitboard::square_bit(pawn);
+    const mask king_bit = bitboard::square_bit(king);
+    const mask king_zone = king_spread(king_bit);
+    const mask pawn_attacks = ( ( pawn_bit << 7 ) & ~bitboard::FILE_H ) | ( ( pawn_bit << 9 ) & ~bitboard::FILE_A );
+
+    // white to move, the black king can't be in check
+    mask wins = 0;
+
+    pawn_slice& slice = tables.slices[ pawn_index(pawn) ];
+
+    for ( int32_t y = bitboard::rank_of(king) - 1; y <= bitboard::rank_of(king) + 1; y++ ) {
+        for ( int32_t x = bitboard::file_of(king) - 1; x <= bitboard::file_of(king) + 1; x++ ) {
+            int32_t to = bitboard::make_square(x, y);
+            if ( bitboard::on_board(x, y) && to != king && to != pawn ) wins |= slice.black_to_move[to];
+        }
+    }
+
+    int32_t push = pawn + 8;
+    mask push_bit = bitboard::square_bit(push);
+
+    if ( push != king ) {
+        if ( bitboard::rank_of(push) == 7 ) {
+            wins |= ( king_zone & push_bit ) ? ~push_bit : ~( push_bit | king_spread(push_bit) );
+        }
+        else {
+            wins |= tables.slices[ pawn_index(push) ].black_to_move[king] & ~push_bit;
+
+            int32_t double_push = pawn + 16;
+            if ( bitboard::rank_of(pawn) == 1 && double_push != king ) {
+                wins |= tables.slices[ pawn_index(double_push) ].black_to_move[king] & ~( push_bit | bitboard::square_bit(double_push) );
+            }
+        }
+    }
+
+    wins &= ~( pawn_bit | king_bit | king_zone | pawn_attacks );
+
+    // black to move, the pawn can be taken when the white king doesn't guard it
+    mask legal = ~( king_bit | king_zone | pawn_attacks );
+    mask escapes = king_spread( legal & ~wins );
+    mask losses = ~( pawn_bit | king_bit | king_zone ) & ~escapes & ( king_spread(legal) | pawn_attacks );
+
+    slice.white_to_move[king] = wins;
+    slice.black_to_move[king] = losses;
+}
+
+
+// one pass over every position, the pawns closest to promotion go first so the pass already sees the results after the pawn moves
+constexpr bitbase_tables next_pass( bitbase_tables tables ) noexcept
+{
+    for ( int32_t pawn = 55; pawn >= 8; pawn-- ) {
+        if ( bitboard::file_of(pawn) > 3 ) continue;
+
+        for ( int32_t king = 0; king < 64; king++ ) {
+            if ( king != pawn ) update_square( tables, pawn, king );
+        }
+    }
+
+    return tables;
+}
+
+constexpr bool converged( const bitbase_tables& tables ) noexcept
+{
+    bitbase_tables next = next_pass(tables);
+
+    for ( uint32_t i = 0; i < PAWN_SQUARES; i++ ) {
+        for ( uint32_t king = 0; king < 64; king++ ) {
+            if ( next.slices[i].white_to_move[king] != tables.slices[i].white_to_move[king] ) return false;
+            if ( next.slices[i].black_to_move[king] != tables.slices[i].black_to_move[king] ) return false;
+        }
+    }
+
+    return true;
+}
+
+
+// every pass is its own constant expression, so a single evaluation stays far below the operation limits of the compilers
+constexpr uint32_t PASSES = 12;
+
+template<uint32_t Pass>
+inline constexpr bitbase_tables pass_tables = next_pass( pass_tables<Pass - 1> );
+
+template<>
+inline constexpr bitbase_tables pass_tables<0> = bitbase_tables{};
+
+inline constexpr const bitbase_tables& bitbase = pass_tables<PASSES>;
+
+static_assert( converged(bitbase), "the KPK bitbase needs more passes" );
+
+
+
+// the squares are seen from the side with the pawn, which is white here
+constexpr inline bool is_win( int32_t strong_king, int32_t pawn, int32_t weak_king, const bool& strong_to_move ) noexcept
+{
+    if ( bitboard::file_of(pawn) > 3 ) {
+        strong_king ^= 7;
+        pawn ^= 7;
+        weak_king ^= 7;
+    }
+
+    const pawn_slice& slice = bitbase.slices[ pawn_index(pawn) ];
+    mask wins = ( strong_to_move ) ? slice.white_to_move[strong_king] : slice.black_to_move[strong_king];
+
+    return ( wins >> weak_king ) & 1;
+}
+
+
+/**
+ * @brief Looks up a king and pawn against king position.
+ *
+ * @param pos the position, a Board is looked up with its to_position()
+ * @param strong_side the color that has the pawn
+ * @param win whether that color wins, otherwise the position is a draw
+ * @return false if the position isn't king and pawn against king
+ */
+inline bool probe( const Position& pos, uint32_t& strong_side, bool& win ) noexcept
+{
+    mask pawns = pos.pieces(PAWN);
+    if ( bitboard::popcount( pos.occupied() ) != 3 || bitboard::popcount(pawns) != 1 ) return false;
+
+    strong_side = ( pos.pieces(WHITE, PAWN) ) ? WHITE : BLACK;
+    int32_t flip = ( strong_side == WHITE ) ? 0 : 56;
+
+    win = is_win( pos.king_square(strong_side) ^ flip, bitboard::lsb(pawns) ^ flip, pos.king_square( strong_side ^ 1 ) ^ flip, pos.side_to_move() == strong_side );
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef MAPPED_FILE
+#define MAPPED_FILE
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+/*
+ A read-only view of a whole file that the operating system pages in when it's read. The data is shared between
+ the processes that map the same file and nothing is copied into the heap, so big tables can be opened instantly.
+*/
+class MappedFile
+{
+    private:
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = NULL;
+#endif
+
+
+    public:
+        MappedFile() noexcept { }
+
+        explicit MappedFile( const std::string& path ) { open(path); }
+
+        ~MappedFile() { close(); }
+
+        MappedFile( const MappedFile& ) = delete;
+        MappedFile& operator = ( const MappedFile& ) = delete;
+
+        MappedFile( MappedFile&& other ) noexcept { *this = std::move(other); }
+
+        MappedFile& operator = ( MappedFile&& other ) noexcept
+        {
+            if ( this != &other ) {
+                close();
+                std::swap( bytes, other.bytes );
+                std::swap( length, other.length );
+#ifdef _WIN32
+                std::swap( file, other.file );
+                std::swap( mapping, other.mapping );
+#endif
+            }
+            return *this;
+        }
+
+
+        // maps the file, returns false if it can't be opened. An empty file is opened, but has no data
+        bool open( const std::string& path )
+        {
+            close();
+
+#ifdef _WIN32
+            file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+            if ( file == INVALID_HANDLE_VALUE ) return false;
+
+            LARGE_INTEGER size;
+            if ( !GetFileSizeEx( file, &size ) ) {
+                close();
+                return false;
+            }
+
+            length = static_cast<size_t>( size.QuadPart );
+            if ( length == 0 ) return true;
+
+            mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+            if ( mapping == NULL ) {
+                close();
+                return false;
+            }
+
+            bytes = static_cast<const uint8_t*>( MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+            if ( !bytes ) {
+                close();
+                return false;
+            }
+#else
+            int descriptor = ::open( path.c_str(), O_RDONLY );
+            if ( descriptor < 0 ) return false;
+
+            struct stat info;
+            if ( fstat( descriptor, &info ) != 0 ) {
+                ::close(descriptor);
+                return false;
+            }
+
+            length = static_cast<size_t>( info.st_size );
+
+            if ( length > 0 ) {
+                void* view = mmap( nullptr, length, PROT_READ, MAP_SHARED, descriptor, 0 );
+
+                if ( view == MAP_FAILED ) {
+                    ::close(descriptor);
+                    length = 0;
+                    return false;
+                }
+
+                bytes = static_cast<const uint8_t*>(view);
+            }
+
+            // the mapping stays valid after the descriptor is closed
+            ::close(descriptor);
+#endif
+
+            return true;
+        }
+
+        void close() noexcept
+        {
+#ifdef _WIN32
+            if ( bytes ) UnmapViewOfFile(bytes);
+            if ( mapping != NULL ) CloseHandle(mapping);
+            if ( file != INVALID_HANDLE_VALUE ) CloseHandle(file);
+            mapping = NULL;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if ( bytes ) munmap( const_cast<uint8_t*>(bytes), length );
+#endif
+            bytes = nullptr;
+            length = 0;
+        }
+
+        inline const uint8_t* data() const noexcept { return bytes; }
+        inline size_t size() const noexcept { return length; }
+        inline bool is_open() const noexcept { return bytes != nullptr; }
+};
+
+#endif
@@ -0,0 +1,366 @@
+#ifndef MATE_SOLVER
+#define MATE_SOLVER
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "helper_tools.hpp"
+#include "position.hpp"
+
+
+enum mate_outcome
+{
+    MATE_PROVEN,
+    MATE_DISPROVEN, // there is no mate in the asked amount of moves
+    MATE_UNKNOWN // the node budget ran out first
+};
+
+
+// a move of the solution and the answers to it. The replies of an attacking move are every legal defence,
+// the reply of a defence is the attacking move that continues the mate. A mating move has no replies.
+struct MateSolution
+{
+    Move move;
+    std::vector<MateSolution> replies;
+};
+
+
+struct MateResult
+{
+    mate_outcome outcome = MATE_UNKNOWN;
+    uint32_t mate_in = 0; // the shortest mate that was found, in moves of the attacking side
+    MateSolution solution; // starts with the first move of the mate
+    uint64_t nodes = 0;
+    double seconds = 0.0;
+};
+
+
+
+// an entry of the proof table, the key includes the amount of plies that are left
+struct ProofEntry
+{
+    uint64_t key = 0;
+    uint32_t proof = 1;
+    uint32_t disproof = 1;
+    uint64_t work = 0; // the nodes that were searched below the entry, the cheaper entry of a bucket is replaced
+};
+
+
+/*
+ A proof table with a fixed size. Every bucket has 2 entries, a new result replaces the entry that took
+ less work to find, so the expensive results stay in the table when it's full.
+*/
+class ProofTable
+{
+    private:
+        std::vector< std::array<ProofEntry, 2> > buckets;
+
+        static inline uint64_t entry_key( const uint64_t& key, const uint32_t& plies ) noexcept
+        {
+            return key ^ ( ( plies + 1 ) * 0x9E3779B97F4A7C15ULL );
+        }
+
+    public:
+        // the size is rounded down to a power of two
+        explicit ProofTable( size_t entries = 1 << 20 )
+        {
+            size_t rounded = 1;
+            while ( rounded * 4 <= entries ) rounded *= 2;
+            buckets.resize(rounded);
+        }
+
+        // returns false and the starting numbers 1 and 1 if the position isn't in the table
+        bool lookup( const uint64_t& key, const uint32_t& plies, uint32_t& proof, uint32_t& disproof ) const noexcept
+        {
+            uint64_t full_key = entry_key(key, plies);
+
+            for ( const ProofEntry& entry : buckets[ full_key & ( buckets.size() - 1 ) ] ) {
+                if ( entry.key == full_key ) {
+                    proof = entry.proof;
+                    disproof = entry.disproof;
+                    return true;
+                }
+            }
+
+            proof = 1;
+            disproof = 1;
+            return false;
+        }
+
+        void store( const uint64_t& key, const uint32_t& plies, const uint32_t& proof, const uint32_t& disproof, const uint64_t& work ) noexcept
+        {
+            uint64_t full_key = entry_key(key, plies);
+            std::array<ProofEntry, 2>& bucket = buckets[ full_key & ( buckets.size() - 1 ) ];
+
+            ProofEntry* target = ( bucket[0].work <= bucket[1].work ) ? &bucket[0] : &bucket[1];
+
+            for ( ProofEntry& entry : bucket ) {
+                if ( entry.key == full_key ) target = &entry;
+            }
+
+            *target = ProofEntry{ full_key, proof, disproof, work };
+        }
+
+        void clear() noexcept
+        {
+            std::fill( buckets.begin(), buckets.end(), std::array<ProofEntry, 2>() );
+        }
+
+        inline size_t bytes() const noexcept { return buckets.size() * sizeof( std::array<ProofEntry, 2> ); }
+};
+
+
+
+/*
+ Proves or disproves a forced mate with depth-first proof-number search. Instead of searching every move to a
+ fixed depth, it always expands the move that is the closest to being proven or disproven, so a mate that is found
+ with forcing moves is proven after a small part of the tree. The attacking side is the side to move of the
+ position, a Board is solved with its to_position().
+*/
+class MateSolver
+{
+    private:
+        static constexpr uint32_t INFINITE = 100000000;
+
+        ProofTable table;
+        uint64_t nodes = 0;
+        uint64_t node_limit = 0;
+        bool stopped = false;
+
+
+        static inline uint32_t add( const uint32_t& a, const uint32_t& b ) noexcept { return std::min( a + b, INFINITE ); }
+
+        // the moves of a node. On the last attacking move only the checks can give mate
+        static void node_moves( const Position& pos, const bool& attacker, const uint32_t& plies, MoveList& list ) noexcept
+        {
+            MoveList all;
+            pos.generate_legal(all);
+
+            if ( !attacker || plies > 1 ) {
+                list = all;
+                return;
+            }
+
+            list.clear();
+
+            for ( const Move& a_move : all ) {
+                Position next = pos;
+                next.play(a_move);
+                if ( next.in_check() ) list.push_back(a_move);
+            }
+        }
+
+
+        /*
+         The multiple iterative deepening of df-pn: the node is searched until its proof number reaches thproof or its
+         disproof number reaches thdisproof. The attacker needs one of its moves to be proven, the defender needs
+         every move to be proven.
+        */
+        void mid( const Position& pos, const uint32_t& plies, const bool& attacker, const uint32_t& thproof, const uint32_t& thdisproof, uint32_t& proof, uint32_t& disproof ) noexcept
+        {
+            uint64_t start_nodes = nodes++;
+
+            if ( node_limit && nodes >= node_limit ) {
+                stopped = true;
+                table.lookup( pos.key(), plies, proof, disproof );
+                return;
+            }
+
+            MoveList list;
+            node_moves( pos, attacker, plies, list );
+
+            // the terminal nodes: a defender without moves is mated or stalemated, and the attacker can run out of moves
+            if ( !attacker && ( list.empty() || plies == 0 ) ) {
+                bool mated = list.empty() && pos.in_check();
+                proof = ( mated ) ? 0 : INFINITE;
+                disproof = ( mated ) ? INFINITE : 0;
+                table.store( pos.key(), plies, proof, disproof, 1 );
+                return;
+            }
+
+            if ( attacker && list.empty() ) {
+                proof = INFINITE;
+                disproof = 0;
+                table.store( pos.key(), plies, proof, disproof, 1 );
+                return;
+            }
+
+            // the numbers of the children are kept here, so a child whose entry was replaced doesn't start from 1 again
+            std::array<uint64_t, 256> keys;
+            std::array<uint32_t, 256> child_proof;
+            std::array<uint32_t, 256> child_disproof;
+
+            for ( uint32_t i = 0; i < list.size(); i++ ) {
+                Position next = pos;
+                next.play( list[i] );
+                keys[i] = next.key();
+                table.lookup( keys[i], plies - 1, child_proof[i], child_disproof[i] );
+            }
+
+            while ( true ) {
+                uint32_t best = 0;
+                uint32_t second = INFINITE;
+
+                if ( attacker ) {
+                    proof = INFINITE;
+                    disproof = 0;
+
+                    for ( uint32_t i = 0; i < list.size(); i++ ) {
+                        disproof = add( disproof, child_disproof[i] );
+
+                        if ( child_proof[i] < proof ) {
+                            second = proof;
+                            proof = child_proof[i];
+                            best = i;
+                        }
+                        else second = std::min( second, child_proof[i] );
+                    }
+                }
+                else {
+                    proof = 0;
+                    disproof = INFINITE;
+
+                    for ( uint32_t i = 0; i < list.size(); i++ ) {
+                        proof = add( proof, child_proof[i] );
+
+                        if ( child_disproof[i] < disproof ) {
+                            second = disproof;
+                            disproof = child_disproof[i];
+                            best = i;
+                        }
+                        else second = std::min( second, child_disproof[i] );
+                    }
+                }
+
+                if ( proof >= thproof || disproof >= thdisproof || stopped ) break;
+
+                // the best child is searched until it stops being the best one
+                uint32_t child_thproof;
+                uint32_t child_thdisproof;
+
+                if ( attacker ) {
+                    child_thproof = std::min( thproof, add( second, 1 ) );
+                    child_thdisproof = add( thdisproof - disproof, child_disproof[best] );
+                }
+                else {
+                    child_thproof = add( thproof - proof, child_proof[best] );
+                    child_thdisproof = std::min( thdisproof, add( second, 1 ) );
+                }
+
+                Position next = pos;
+                next.play( list[best] );
+                mid( next, plies - 1, !attacker, child_thproof, child_thdisproof, child_proof[best], child_disproof[best] );
+            }
+
+            table.store( pos.key(), plies, proof, disproof, nodes - start_nodes );
+        }
+
+
+        bool prove( const Position& pos, const uint32_t& plies, const bool& attacker ) noexcept
+        {
+            uint32_t proof = 1;
+            uint32_t disproof = 1;
+            table.lookup( pos.key(), plies, proof, disproof );
+
+            if ( proof != 0 && disproof != 0 ) mid( pos, plies, attacker, INFINITE, INFINITE, proof, disproof );
+            return proof == 0;
+        }
+
+
+        // builds the solution below a proven attacking position, the proofs that were replaced in the table are found again
+        MateSolution extract( const Position& pos, const uint32_t& plies ) noexcept
+        {
+            MateSolution solution;
+            MoveList list;
+            node_moves( pos, true, plies, list );
+
+            for ( const Move& a_move : list ) {
+                Position next = pos;
+                next.play(a_move);
+
+                if ( prove( next, plies - 1, false ) ) {
+                    solution.move = a_move;
+
+                    MoveList defences;
+                    next.generate_legal(defences);
+
+                    for ( const Move& defence : defences ) {
+                        Position after = next;
+                        after.play(defence);
+
+                        MateSolution reply;
+                        reply.move = defence;
+                        reply.replies.push_back( extract( after, plies - 2 ) );
+                        solution.replies.push_back( std::move(reply) );
+                    }
+
+                    break;
+                }
+            }
+
+            return solution;
+        }
+
+
+    public:
+        explicit MateSolver( const size_t& table_entries = 1 << 20 ) : table(table_entries) { }
+
+        /**
+         * @brief Looks for a forced mate of the side to move in at most the given amount of moves.
+         * The mates are tried from the shortest one up, so the solution is a shortest mate.
+         *
+         * @param pos the position, the side to move is the attacking side
+         * @param max_moves the longest mate that is looked for, in moves of the attacking side
+         * @param node_budget the most nodes that are searched, 0 means no limit. The solution itself isn't counted
+         * @return MateResult whether the mate was proven, the solution tree and the searched nodes
+         */
+        MateResult solve( const Position& pos, const uint32_t& max_moves, const uint64_t& node_budget = 0 )
+        {
+            MateResult result;
+            auto start = std::chrono::steady_clock::now();
+
+            nodes = 0;
+            node_limit = node_budget;
+            stopped = false;
+            result.outcome = MATE_DISPROVEN;
+
+            for ( uint32_t moves = 1; moves <= max_moves; moves++ ) {
+                uint32_t plies = 2*moves - 1;
+                uint32_t proof = 1;
+                uint32_t disproof = 1;
+
+                mid( pos, plies, true, INFINITE, INFINITE, proof, disproof );
+
+                // the numbers can also stop at the cap without an answer when the tree is huge
+                if ( stopped || ( proof != 0 && disproof != 0 ) ) {
+                    result.outcome = MATE_UNKNOWN;
+                    break;
+                }
+
+                if ( proof == 0 ) {
+                    result.nodes = nodes;
+                    node_limit = 0;
+
+                    result.outcome = MATE_PROVEN;
+                    result.mate_in = moves;
+                    result.solution = extract( pos, plies );
+                    break;
+                }
+            }
+
+            if ( result.outcome != MATE_PROVEN ) result.nodes = nodes;
+            result.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+            return result;
+        }
+
+        // forgets the proofs of the previous positions
+        void clear() noexcept { table.clear(); }
+
+        inline size_t table_bytes() const noexcept { return table.bytes(); }
+};
+
+#endif
@@ -0,0 +1,389 @@
+#ifndef MCTS
+#define MCTS
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "helper_tools.hpp"
+#include "position.hpp"
+#include "evaluation.hpp"
+#include "chess960.hpp"
+#include "opening_book.hpp"
+#include "thread_pool.hpp"
+
+
+constexpr uint32_t NO_NODE = UINT32_MAX;
+
+
+// how long the tree search runs, a value of 0 means that the limit isn't used
+struct MctsLimit
+{
+    uint64_t playouts = 0;
+    double seconds = 0.0;
+};
+
+
+struct MctsResult
+{
+    Move best_move;
+    double win_rate = 0.5; // of the best move, from the side to moves point of view
+    uint64_t playouts = 0;
+    double seconds = 0.0;
+    double playouts_per_second = 0.0;
+    size_t nodes = 0;
+    size_t tree_bytes = 0; // the memory that the used nodes take
+    bool arena_full = false; // the tree stopped growing because the arena ran out of nodes
+    bool from_book = false; // the move came from the opening book and no playouts were run
+};
+
+
+
+/*
+ A node of the tree. Every field that the threads change during the search is atomic, so the threads
+ can walk through the tree at the same time without locks. The children of a node are next to each other in the arena.
+*/
+struct MctsNode
+{
+    enum expansion : uint8_t
+    {
+        LEAF,
+        EXPANDING, // a thread is adding the children, the other threads treat the node as a leaf until it's done
+        EXPANDED,
+        NO_SPACE // the arena didn't have room for the children, the node stays a leaf
+    };
+
+    Move move; // the move that leads into this node
+    uint32_t parent = NO_NODE;
+    uint32_t first_child = NO_NODE;
+    uint16_t child_count = 0;
+
+    std::atomic<uint8_t> state{LEAF};
+    std::atomic<uint32_t> visits{0};
+    std::atomic<uint32_t> score{0}; // half points of the side that played the move: 2 for a win and 1 for a draw
+    std::atomic<uint32_t> virtual_loss{0}; // threads that are below this node right now
+};
+
+
+
+/*
+ The nodes of the tree in one block that is allocated once. A thread takes the space of its nodes with a single
+ atomic add, so growing the tree doesn't call the allocator or take a lock. reset() makes the whole block free again.
+*/
+class NodeArena
+{
+    private:
+        std::unique_ptr<MctsNode[]> nodes;
+        size_t capacity = 0;
+        std::atomic<size_t> used{0};
+
+    public:
+        explicit NodeArena( const size_t& capacity0 ) : nodes( new MctsNode[capacity0] ), capacity(capacity0) { }
+
+        // returns the index of the first of count nodes, or NO_NODE if the arena is full
+        uint32_t allocate( const uint32_t& count ) noexcept
+        {
+            size_t first = used.fetch_add(count);
+
+            if ( first + count > capacity ) {
+                used.fetch_sub(count);
+                return NO_NODE;
+            }
+
+            return static_cast<uint32_t>(first);
+        }
+
+        void reset() noexcept { used = 0; }
+
+        inline MctsNode& operator [] ( const uint32_t& index ) noexcept { return nodes[index]; }
+        inline const MctsNode& operator [] ( const uint32_t& index ) const noexcept { return nodes[index]; }
+
+        inline size_t size() const noexcept { return std::min( used.load(), capacity ); }
+        inline size_t bytes_used() const noexcept { return size() * sizeof(MctsNode); }
+        inline size_t bytes_reserved() const noexcept { return capacity * sizeof(MctsNode); }
+};
+
+
+
+/*
+ A UCT tree search that doesn't need an evaluation function, the positions are scored with random games.
+ The threads share one tree: a thread that walks through a node adds a virtual loss to it, so the other threads
+ choose different branches while its playout is still running.
+*/
+class MctsSearcher
+{
+    private:
+        static constexpr double EXPLORATION = 1.4;
+        static constexpr uint32_t MAX_PLAYOUT_PLIES = 200;
+        static constexpr int32_t DECISIVE_MARGIN = 300; // a cut off playout is a win for the side that is this far ahead
+
+        NodeArena arena;
+        std::atomic<uint64_t> playouts{0};
+        std::atomic<bool> arena_full{false};
+        const OpeningBook* opening_book = nullptr;
+
+
+        // makes the node ready to be used as a fresh leaf
+        void init_node( const uint32_t& index, const Move& a_move, const uint32_t& parent ) noexcept
+        {
+            MctsNode& node = arena[index];
+            node.move = a_move;
+            node.parent = parent;
+            node.first_child = NO_NODE;
+            node.child_count = 0;
+            node.state.store( MctsNode::LEAF, std::memory_order_relaxed );
+            node.visits.store( 0, std::memory_order_relaxed );
+            node.score.store( 0, std::memory_order_relaxed );
+            node.virtual_loss.store( 0, std::memory_order_relaxed );
+        }
+
+
+        // adds the legal moves of the position as the children of the node, only the thread that claimed the node does this
+        void expand( const uint32_t& index, const Position& pos ) noexcept
+        {
+            MctsNode& node = arena[index];
+            MoveList list;
+            pos.generate_legal(list);
+
+            uint32_t first = ( list.empty() ) ? NO_NODE : arena.allocate( list.size() );
+
+            if ( !list.empty() && first == NO_NODE ) {
+                arena_full = true;
+                node.state.store( MctsNode::NO_SPACE, std::memory_order_release );
+                return;
+            }
+
+            for ( uint32_t i = 0; i < list.size(); i++ ) {
+                init_node( first + i, list[i], index );
+            }
+
+            node.first_child = first;
+            node.child_count = static_cast<uint16_t>( list.size() );
+
+            // the release makes the children visible to the threads that see the EXPANDED state
+            node.state.store( MctsNode::EXPANDED, std::memory_order_release );
+        }
+
+
+        // the child with the best upper confidence bound, the virtual losses count as visits that were lost
+        uint32_t select_child( const MctsNode& node ) const noexcept
+        {
+            double parent_visits = node.visits.load(std::memory_order_relaxed) + node.virtual_loss.load(std::memory_order_relaxed);
+            double log_parent = std::log( std::max( parent_visits, 1.0 ) );
+
+            uint32_t best = node.first_child;
+            double best_value = -1.0;
+
+            for ( uint32_t i = node.first_child; i < node.first_child + node.child_count; i++ ) {
+                const MctsNode& child = arena[i];
+                double visits = child.visits.load(std::memory_order_relaxed) + child.virtual_loss.load(std::memory_order_relaxed);
+
+                if ( visits == 0 ) return i;
+
+                double value = child.score.load(std::memory_order_relaxed) / ( 2.0 * visits ) + EXPLORATION * std::sqrt( log_parent / visits );
+
+                if ( value > best_value ) {
+                    best_value = value;
+                    best = i;
+                }
+            }
+
+            return best;
+        }
+
+
+        // returns the half points of the side to move at the end of a game without legal moves
+        static inline uint32_t terminal_score( const Position& pos ) noexcept
+        {
+            return ( pos.in_check() ) ? 0 : 1;
+        }
+
+        /*
+         Plays random moves until the game ends or the ply limit is reached and returns the half points of the side
+         that is to move in the given position. The moves are picked from the pseudo legal moves and an illegal pick is
+         removed from the list, so most plies only check the move that was picked. Nothing is allocated.
+        */
+        static uint32_t playout( Position pos, chess960::Random& random ) noexcept
+        {
+            uint32_t start_side = pos.side_to_move();
+
+            for ( uint32_t ply = 0; ply < MAX_PLAYOUT_PLIES; ply++ ) {
+                if ( bitboard::popcount( pos.occupied() ) <= 2 ) return 1;
+                if ( pos.halfmove_clock() >= 100 ) return 1; // the 50 move rule
+
+                MoveList list;
+                pos.generate_pseudo_legal(list);
+                bool moved = false;
+
+                while ( !list.empty() ) {
+                    uint32_t pick = static_cast<uint32_t>( ( ( random.next() >> 32 ) * list.size() ) >> 32 );
+                    Move a_move = list[pick];
+
+                    if ( pos.leaves_king_safe(a_move) ) {
+                        pos.play(a_move);
+                        moved = true;
+                        break;
+                    }
+
+                    list[pick] = list[ list.size() - 1 ];
+                    list.count--;
+                }
+
+                if ( !moved ) {
+                    uint32_t score = terminal_score(pos);
+                    return ( pos.side_to_move() == start_side ) ? score : 2 - score;
+                }
+            }
+
+            // random moves almost never give mate, so a game that is cut off by the ply limit is decided by the material
+            int32_t balance = evaluation::material_and_squares(pos, start_side) - evaluation::material_and_squares(pos, start_side ^ 1);
+            if ( balance >= DECISIVE_MARGIN ) return 2;
+            if ( balance <= -DECISIVE_MARGIN ) return 0;
+            return 1;
+        }
+
+
+        // one selection, expansion, playout and backpropagation from the root
+        void iterate( const Position& root, chess960::Random& random ) noexcept
+        {
+            Position pos = root;
+            uint32_t index = 0;
+            arena[index].virtual_loss.fetch_add(1, std::memory_order_relaxed);
+
+            while ( arena[index].state.load(std::memory_order_acquire) == MctsNode::EXPANDED && arena[index].child_count ) {
+                index = select_child( arena[index] );
+                arena[index].virtual_loss.fetch_add(1, std::memory_order_relaxed);
+                pos.play( arena[index].move );
+            }
+
+            uint32_t score;
+            MctsNode& leaf = arena[index];
+            uint8_t leaf_state = MctsNode::LEAF;
+
+            // the first thread that reaches a leaf that has been visited before adds its children and continues into one of them
+            if ( leaf.visits.load(std::memory_order_relaxed) > 0 &&
+                 leaf.state.compare_exchange_strong( leaf_state, MctsNode::EXPANDING, std::memory_order_acq_rel ) ) {
+                expand(index, pos);
+
+                if ( leaf.child_count ) {
+                    index = leaf.first_child + static_cast<uint32_t>( ( ( random.next() >> 32 ) * leaf.child_count ) >> 32 );
+                    arena[index].virtual_loss.fetch_add(1, std::memory_order_relaxed);
+                    pos.play( arena[index].move );
+                }
+            }
+
+            if ( arena[index].state.load(std::memory_order_acquire) == MctsNode::EXPANDED && !arena[index].child_count ) score = terminal_score(pos);
+            else score = playout(pos, random);
+
+            // the score is for the side to move at the leaf, a node is scored for the side that played its move
+            for ( uint32_t i = index; i != NO_NODE; i = arena[i].parent ) {
+                MctsNode& node = arena[i];
+                score = 2 - score;
+
+                node.score.fetch_add(score, std::memory_order_relaxed);
+                node.visits.fetch_add(1, std::memory_order_relaxed);
+                node.virtual_loss.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            playouts.fetch_add(1, std::memory_order_relaxed);
+        }
+
+
+    public:
+        // the arena gets room for the given amount of nodes, that is all the memory that the tree ever uses
+        explicit MctsSearcher( const size_t& node_capacity = 1 << 20 ) : arena(node_capacity) { }
+
+        MctsSearcher( const MctsSearcher& ) = delete;
+        MctsSearcher& operator = ( const MctsSearcher& ) = delete;
+
+        // the book is asked before every search and isn't owned. A nullptr turns the book off
+        void set_book( const OpeningBook* book0 ) noexcept { opening_book = book0; }
+
+
+        /**
+         * @brief Searches the position with the threads of the pool until the playout or the time limit is reached.
+         * The tree of a previous search is thrown away.
+         *
+         * @param root the position to search
+         * @param limit the amount of playouts or seconds, at least one of them should be set
+         * @param pool the threads that share the tree
+         * @param seed makes the random playouts reproducible with a single thread
+         * @return MctsResult the most visited move, the playouts per second and the memory of the tree, or the book move
+         */
+        MctsResult search( const Position& root, const MctsLimit& limit, ThreadPool& pool, const uint64_t& seed = 1 )
+        {
+            MctsResult result;
+
+            if ( opening_book ) {
+                uint64_t state = seed;
+                result.best_move = opening_book->pick( root, zobrist::next_key(state) );
+                result.from_book = !result.best_move.is_null();
+                if ( result.from_book ) return result;
+            }
+
+            arena.reset();
+            playouts = 0;
+            arena_full = false;
+
+            init_node( arena.allocate(1), Move(), NO_NODE );
+
+            auto start = std::chrono::steady_clock::now();
+            auto out_of_time = [&]() {
+                return limit.seconds > 0.0 && std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() >= limit.seconds;
+            };
+
+            // every worker runs its own loop, the playout counter is shared so each thread passes the limit by one playout at most
+            pool.parallel_for( pool.size(), 1, [&]( size_t worker, size_t, size_t ) {
+                chess960::Random random( seed + worker * 0x9E3779B97F4A7C15ULL );
+
+                while ( true ) {
+                    if ( limit.playouts && playouts.load(std::memory_order_relaxed) >= limit.playouts ) break;
+                    if ( out_of_time() || ( !limit.playouts && limit.seconds <= 0.0 ) ) break;
+
+                    iterate( root, random );
+                }
+            } );
+
+            result.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+            result.playouts = playouts.load();
+            if ( result.seconds > 0.0 ) result.playouts_per_second = static_cast<double>(result.playouts) / result.seconds;
+
+            result.nodes = arena.size();
+            result.tree_bytes = arena.bytes_used();
+            result.arena_full = arena_full.load();
+
+            // the most visited move is the one that the search trusts the most
+            const MctsNode& root_node = arena[0];
+            uint32_t best_visits = 0;
+
+            if ( root_node.state.load() == MctsNode::EXPANDED ) {
+                for ( uint32_t i = root_node.first_child; i < root_node.first_child + root_node.child_count; i++ ) {
+                    uint32_t visits = arena[i].visits.load();
+
+                    if ( visits > best_visits ) {
+                        best_visits = visits;
+                        result.best_move = arena[i].move;
+                        result.win_rate = arena[i].score.load() / ( 2.0 * visits );
+                    }
+                }
+            }
+
+            return result;
+        }
+
+        // the same as above, but it creates a thread pool that uses every core of the machine.
+        MctsResult search( const Position& root, const MctsLimit& limit )
+        {
+            ThreadPool pool;
+            return search( root, limit, pool );
+        }
+
+        // the memory that the arena reserved for the nodes
+        size_t reserved_bytes() const noexcept { return arena.bytes_reserved(); }
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef MOVE_LOG
+#define MOVE_LOG
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+#include "helper_tools.hpp"
+#include "position.hpp"
+
+
+// the flags of a logged move, they are known when the move is played so we store them instead of recalculating them
+enum move_log_flags
+{
+    LOG_CAPTURE = 1,
+    LOG_CHECK = 2,
+    LOG_CHECKMATE = 4
+};
+
+
+// one ply of a game packed into 4 bytes
+struct MoveLogEntry
+{
+    Move move;
+    uint8_t piece = 0; // the piece that moved, in the byte format of Position
+    uint8_t flags = 0;
+};
+
+
+
+/*
+ The moves history of a single game. Every ply is stored as a packed MoveLogEntry and the
+ text is only created when it's asked for, by replaying the moves from the starting position.
+*/
+class MoveLog
+{
+    private:
+        Position start;
+        std::vector<MoveLogEntry> entries;
+        uint8_t checkmated_colors = 0; // bit per color_id
+        uint32_t resets = 0;
+
+
+        // returns the position before the given ply
+        Position position_at( const size_t& ply ) const noexcept
+        {
+            Position pos = start;
+
+            for ( size_t i = 0; i < ply && i < entries.size(); i++ ) {
+                pos.play( entries[i].move );
+            }
+
+            return pos;
+        }
+
+
+    public:
+        size_t size() const noexcept { return entries.size(); }
+        bool empty() const noexcept { return entries.empty(); }
+        const Position& start_position() const noexcept { return start; }
+
+        // grows every time the log is cleared or a move is taken back, so a reader can tell that its cached text is outdated
+        uint32_t reset_count() const noexcept { return resets; }
+
+        // empties the log and sets the position that the game starts from, before the first move is played
+        void reset( const Position& start0 ) noexcept
+        {
+            start = start0;
+            entries.clear();
+            checkmated_colors = 0;
+            resets++;
+        }
+
+
+        /**
+         * @brief Adds a move into the log.
+         * @param before the position before the move
+         * @param a_move a legal move of the position
+         */
+        void push( const Position& before, const Move& a_move )
+        {
+            Position after = before;
+            after.play(a_move);
+
+            MoveLogEntry entry;
+            entry.move = a_move;
+            entry.piece = before.piece_on( a_move.from() );
+
+            if ( a_move.is_capture() ) entry.flags |= LOG_CAPTURE;
+            if ( after.in_check() ) entry.flags |= ( after.has_legal_moves() ) ? LOG_CHECK : LOG_CHECKMATE;
+
+            entries.push_back(entry);
+        }
+
+        // removes the last move, a checkmate can only happen on the last move so it's forgotten too
+        void pop_back() noexcept
+        {
+            if ( entries.empty() ) return;
+
+            entries.pop_back();
+            checkmated_colors = 0;
+            resets++;
+        }
+
+        void mark_checkmated( const uint32_t& color_id ) noexcept
+        {
+            checkmated_colors |= 1 << color_id;
+        }
+
+        bool is_checkmated( const uint32_t& color_id ) const noexcept
+        {
+            return ( checkmated_colors >> color_id ) & 1;
+        }
+
+
+        const MoveLogEntry& operator [] ( const size_t& ply ) const noexcept { return entries[ply]; }
+
+        // returns only the entries that were added after the given ply
+        helper::span<const MoveLogEntry> entries_since( const size_t& ply ) const noexcept
+        {
+            if ( ply >= entries.size() ) return helper::span<const MoveLogEntry>();
+
+            return helper::span<const MoveLogEntry>( entries.data() + ply, entries.size() - ply );
+        }
+
+
+        // returns the SAN text of a single ply
+        std::string san( const size_t& ply ) const
+        {
+            if ( ply >= entries.size() ) return "";
+
+            return position_at(ply).san( entries[ply].move );
+        }
+
+        /**
+         * @brief Appends the SAN text of every ply from the given one into text, one move per line, and moves the reader
+         * to the end of the log. The reader keeps the position at its ply, so only the new plies are played and a panel
+         * that shows the whole game pays for every move once.
+         *
+         * @param ply the first ply to write, it's set to the length of the log
+         * @param position the position before that ply, it's set to the position after the last ply. At ply 0 the start is used
+         */
+        void san_since( size_t& ply, Position& position, std::string& text ) const
+        {
+            if ( ply == 0 ) position = start;
+
+            for ( ; ply < entries.size(); ply++ ) {
+                text += position.san( entries[ply].move ) + "\n";
+                position.play( entries[ply].move );
+            }
+        }
+
+        // appends the SAN text of every ply after the given one into text, one move per line. This replays the moves
+        // before the ply, a reader that asks again and again should keep its position with the other san_since()
+        void san_since( const size_t& ply, std::string& text ) const
+        {
+            Position pos = position_at(ply);
+
+            for ( size_t i = ply; i < entries.size(); i++ ) {
+                text += pos.san( entries[i].move ) + "\n";
+                pos.play( entries[i].move );
+            }
+        }
+
+        // the text that tells which colors got checkmated, it's empty while the game is running
+        std::string result_text() const
+        {
+            std::string text;
+
+            for ( uint32_t color = WHITE; color <= BLACK; color++ ) {
+                if ( is_checkmated(color) ) text += "The color: " + std::string( ( color == WHITE ) ? "w" : "b" ) + " got checkmated.\n";
+            }
+
+            return text;
+        }
+};
+
+#endif
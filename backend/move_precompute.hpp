@@ -0,0 +1,124 @@
+#ifndef MOVE_PRECOMPUTE
+#define MOVE_PRECOMPUTE
+
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "position.hpp"
+#include "epoch.hpp"
+
+
+// the legal moves of a single position grouped by the MovePrecomputer, the map has no mobility of the side that isn't to move
+struct PrecomputedMoves
+{
+    uint64_t key = 0; // the hash of the position that the moves belong to
+    Position position;
+    MoveList moves;
+    LegalMoveMap map;
+
+    inline bool matches( const Position& a_position ) const noexcept { return key == a_position.key(); }
+};
+
+
+
+/*
+ Groups the legal moves of a position by their origin square on its own thread, so they are ready before the user
+ clicks a piece. The board already generated the moves for its snapshot, so they come with the request and aren't
+ generated again. Only the latest requested position matters: a request replaces the one that is still waiting,
+ and the result is published as a snapshot that the gui thread reads without waiting for the worker.
+*/
+class MovePrecomputer
+{
+    private:
+        std::mutex lock;
+        std::condition_variable wake;
+
+        Position pending;
+        MoveList pending_moves;
+        bool has_pending = false;
+        bool stopping = false;
+
+        SnapshotCell<PrecomputedMoves> results;
+        std::atomic<uint64_t> computed{0};
+
+        std::thread worker; // the last member, so everything that the worker uses exists when it starts
+
+
+        void worker_loop()
+        {
+            while ( true ) {
+                PrecomputedMoves result;
+
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait( guard, [this]{ return stopping || has_pending; } );
+
+                    if ( stopping ) return;
+
+                    result.position = pending;
+                    result.moves = pending_moves;
+                    has_pending = false;
+                }
+
+                result.key = result.position.key();
+                result.map = result.position.legal_move_targets(result.moves);
+
+                results.publish( std::move(result) );
+                computed++;
+            }
+        }
+
+
+    public:
+        MovePrecomputer() : worker( &MovePrecomputer::worker_loop, this ) { }
+
+        ~MovePrecomputer()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+
+            wake.notify_all();
+            worker.join();
+        }
+
+        MovePrecomputer( const MovePrecomputer& ) = delete;
+        MovePrecomputer& operator = ( const MovePrecomputer& ) = delete;
+
+
+        /**
+         * @brief Asks the worker to group the moves of the position, a position that is already grouped is skipped.
+         * @param legal the legal moves of the position, like the ones of a BoardSnapshot
+         */
+        void request( const Position& a_position, const MoveList& legal )
+        {
+            {
+                SnapshotCell<PrecomputedMoves>::Reader latest = results.read();
+                if ( latest && latest->matches(a_position) ) return;
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                pending = a_position;
+                pending_moves = legal;
+                has_pending = true;
+            }
+
+            wake.notify_one();
+        }
+
+        // returns the latest calculated moves, they belong to the asked position only if matches() is true for it
+        SnapshotCell<PrecomputedMoves>::Reader latest() const
+        {
+            return results.read();
+        }
+
+        // how many positions the worker has grouped the moves of
+        uint64_t computed_count() const noexcept { return computed.load(); }
+};
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef OPENING_BOOK
+#define OPENING_BOOK
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <unordered_map>
+#include <algorithm>
+
+#include "helper_tools.hpp"
+#include "position.hpp"
+#include "mapped_file.hpp"
+
+
+// a move of the book. The key is the hash of the position before the move, the moves of a position are sorted by weight
+struct BookEntry
+{
+    uint64_t key = 0;
+    Move move;
+    uint16_t weight = 0;
+    uint32_t learn = 0; // unused, kept so the entries have the layout of a Polyglot book
+};
+
+
+namespace book
+{
+
+// an entry on disk: key, move, weight and learn in big endian, like a Polyglot book. The keys are the hashes of
+// Position and the moves are packed Moves, so the files are only read by this book and not by Polyglot itself
+constexpr size_t ENTRY_SIZE = 16;
+constexpr uint32_t MAX_MOVES = 64; // the most moves of a single position that are read
+
+inline uint64_t read_big_endian( const uint8_t* bytes, const uint32_t& count ) noexcept
+{
+    uint64_t value = 0;
+    for ( uint32_t i = 0; i < count; i++ ) value = ( value << 8 ) | bytes[i];
+    return value;
+}
+
+inline void write_big_endian( std::ofstream& stream, const uint64_t& value, const uint32_t& count )
+{
+    for ( uint32_t i = count; i > 0; i-- ) stream.put( static_cast<char>( ( value >> ( 8*( i - 1 ) ) ) & 0xFF ) );
+}
+
+}
+
+
+
+/*
+ Builds a book from the moves of many games. Every move of the first plies of a game is counted for the position that
+ it was played in, the moves of the winning side count twice and the moves of the losing side don't count.
+ The book is written sorted by key, so the reader can binary search it.
+*/
+class BookBuilder
+{
+    private:
+        struct KeyMove
+        {
+            uint64_t key;
+            uint16_t move;
+
+            bool operator == ( const KeyMove& other ) const noexcept { return key == other.key && move == other.move; }
+        };
+
+        struct KeyMoveHash
+        {
+            size_t operator () ( const KeyMove& a ) const noexcept { return static_cast<size_t>( a.key ^ ( static_cast<uint64_t>(a.move) * 0x9E3779B97F4A7C15ULL ) ); }
+        };
+
+        std::unordered_map<KeyMove, uint64_t, KeyMoveHash> counts;
+        uint32_t max_plies;
+        uint64_t games = 0;
+
+
+    public:
+        // only the first max_plies moves of every game go into the book
+        explicit BookBuilder( const uint32_t& max_plies0 = 24 ) : max_plies(max_plies0) { }
+
+        /**
+         * @brief Adds the moves of a game, the moves must be legal from the start position.
+         *
+         * @param result 1 if white won, -1 if black won and 0 for a draw or an unknown result
+         * @return how many moves were added
+         */
+        uint32_t add_game( const Position& start, helper::span<const Move> moves, const int32_t& result = 0 )
+        {
+            Position pos = start;
+            uint32_t added = 0;
+
+            for ( const Move& a_move : moves ) {
+                if ( added >= max_plies ) break;
+
+                int32_t mover_result = ( pos.side_to_move() == WHITE ) ? result : -result;
+
+                if ( mover_result >= 0 ) {
+                    counts[ KeyMove{ pos.key(), a_move.data } ] += static_cast<uint64_t>( mover_result + 1 );
+                }
+
+                pos.play(a_move);
+                added++;
+            }
+
+            games++;
+            return added;
+        }
+
+        // adds a game that is written as UCI moves from the standard start, for example "e2e4 e7e5 g1f3".
+        // The moves are added until the first one that isn't legal
+        uint32_t add_game( const std::string& uci_moves, const int32_t& result = 0 )
+        {
+            std::vector<Move> moves;
+            std::istringstream stream(uci_moves);
+            std::string text;
+            Position pos = Position::start_position();
+
+            while ( stream >> text && moves.size() < max_plies ) {
+                Move a_move = pos.parse_uci(text);
+                if ( a_move.is_null() ) break;
+
+                moves.push_back(a_move);
+                pos.play(a_move);
+            }
+
+            return add_game( Position::start_position(), helper::span<const Move>( moves.data(), moves.size() ), result );
+        }
+
+        // the entries sorted by key and by weight inside a key, the weights are scaled down so they fit 16 bits
+        std::vector<BookEntry> entries() const
+        {
+            std::vector<BookEntry> result;
+            result.reserve( counts.size() );
+
+            uint64_t largest = 1;
+            for ( const auto& item : counts ) largest = std::max( largest, item.second );
+
+            uint64_t divisor = ( largest + 65534 ) / 65535;
+
+            for ( const auto& item : counts ) {
+                uint64_t weight = std::max<uint64_t>( item.second / divisor, 1 );
+                result.push_back( BookEntry{ item.first.key, Move( item.first.move ), static_cast<uint16_t>(weight), 0 } );
+            }
+
+            std::sort( result.begin(), result.end(), []( const BookEntry& a, const BookEntry& b ) {
+                if ( a.key != b.key ) return a.key < b.key;
+                if ( a.weight != b.weight ) return a.weight > b.weight;
+                return a.move.data < b.move.data;
+            } );
+
+            return result;
+        }
+
+        // writes the book, returns false if the file can't be written
+        bool write( const std::string& path ) const
+        {
+            std::ofstream stream( path, std::ios::binary | std::ios::trunc );
+            if ( !stream ) return false;
+
+            for ( const BookEntry& entry : entries() ) {
+                book::write_big_endian( stream, entry.key, 8 );
+                book::write_big_endian( stream, entry.move.data, 2 );
+                book::write_big_endian( stream, entry.weight, 2 );
+                book::write_big_endian( stream, entry.learn, 4 );
+            }
+
+            return static_cast<bool>(stream);
+        }
+
+        inline uint64_t game_count() const noexcept { return games; }
+        inline size_t size() const noexcept { return counts.size(); }
+};
+
+
+
+/*
+ A book file that is memory mapped and binary searched, so opening it is instant and a probe reads a few pages of the
+ file. Probing doesn't allocate and can be done from many threads at once.
+*/
+class OpeningBook
+{
+    private:
+        MappedFile file;
+        size_t count = 0;
+
+        inline uint64_t key_at( const size_t& index ) const noexcept { return book::read_big_endian( file.data() + index * book::ENTRY_SIZE, 8 ); }
+
+        BookEntry entry_at( const size_t& index ) const noexcept
+        {
+            const uint8_t* bytes = file.data() + index * book::ENTRY_SIZE;
+
+            BookEntry entry;
+            entry.key = book::read_big_endian( bytes, 8 );
+            entry.move = Move( static_cast<uint16_t>( book::read_big_endian( bytes + 8, 2 ) ) );
+            entry.weight = static_cast<uint16_t>( book::read_big_endian( bytes + 10, 2 ) );
+            entry.learn = static_cast<uint32_t>( book::read_big_endian( bytes + 12, 4 ) );
+            return entry;
+        }
+
+
+    public:
+        OpeningBook() { }
+
+        explicit OpeningBook( const std::string& path ) { load(path); }
+
+        // maps the book, returns false if the file can't be opened or isn't made of whole entries
+        bool load( const std::string& path )
+        {
+            count = 0;
+            if ( !file.open(path) || file.size() % book::ENTRY_SIZE != 0 ) return false;
+
+            count = file.size() / book::ENTRY_SIZE;
+            return true;
+        }
+
+        /**
+         * @brief Finds the book moves of the position with a binary search over the keys.
+         * Moves that aren't legal in the position are left out, so a hash collision can't give a wrong move.
+         *
+         * @param entries gets the moves, the heaviest first
+         * @return how many moves were found
+         */
+        uint32_t probe( const Position& pos, std::array<BookEntry, book::MAX_MOVES>& entries ) const noexcept
+        {
+            size_t low = 0;
+            size_t high = count;
+            uint64_t key = pos.key();
+
+            while ( low < high ) {
+                size_t middle = low + ( high - low ) / 2;
+
+                if ( key_at(middle) < key ) low = middle + 1;
+                else high = middle;
+            }
+
+            if ( low == count || key_at(low) != key ) return 0;
+
+            MoveList legal;
+            pos.generate_legal(legal);
+            uint32_t found = 0;
+
+            for ( size_t i = low; i < count && found < book::MAX_MOVES && key_at(i) == key; i++ ) {
+                BookEntry entry = entry_at(i);
+                if ( entry.weight > 0 && legal.contains(entry.move) ) entries[ found++ ] = entry;
+            }
+
+            return found;
+        }
+
+        // chooses a book move with a chance that follows the weights, random is any random number.
+        // Returns a null move if the position isn't in the book
+        Move pick( const Position& pos, const uint64_t& random ) const noexcept
+        {
+            std::array<BookEntry, book::MAX_MOVES> entries;
+            uint32_t found = probe(pos, entries);
+
+            uint64_t total = 0;
+            for ( uint32_t i = 0; i < found; i++ ) total += entries[i].weight;
+            if ( total == 0 ) return Move();
+
+            uint64_t target = random % total;
+
+            for ( uint32_t i = 0; i < found; i++ ) {
+                if ( target < entries[i].weight ) return entries[i].move;
+                target -= entries[i].weight;
+            }
+
+            return entries[0].move;
+        }
+
+        inline bool is_open() const noexcept { return count > 0; }
+        inline size_t size() const noexcept { return count; }
+};
+
+#endif
@@ -0,0 +1,199 @@
+#ifndef PAWN_STRUCTURE
+#define PAWN_STRUCTURE
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <algorithm>
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+
+
+namespace pawns
+{
+
+// the scores of the pawn structure in centipawns
+constexpr int32_t DOUBLED_PENALTY = 12;
+constexpr int32_t ISOLATED_PENALTY = 10;
+constexpr std::array<int32_t, 8> passed_bonus = { 0, 10, 15, 25, 40, 65, 100, 0 }; // indexed by the rank seen from the pawns side
+constexpr int32_t SHIELD_NEAR = 12; // a pawn right in front of the king
+constexpr int32_t SHIELD_FAR = 6; // a pawn two ranks in front of the king
+
+
+struct span_tables
+{
+    std::array<mask, 8> adjacent_files{};
+    std::array<std::array<mask, 64>, 2> front{}; // the squares in front of a pawn on its own file, indexed by the color
+    std::array<std::array<mask, 64>, 2> passed{}; // the squares that an enemy pawn must not be on for the pawn to be passed
+};
+
+constexpr span_tables make_span_tables() noexcept
+{
+    span_tables tables{};
+
+    for ( int32_t file = 0; file < 8; file++ ) {
+        if ( file > 0 ) tables.adjacent_files[file] |= bitboard::FILE_A << ( file - 1 );
+        if ( file < 7 ) tables.adjacent_files[file] |= bitboard::FILE_A << ( file + 1 );
+    }
+
+    for ( int32_t square = 0; square < 64; square++ ) {
+        int32_t x = bitboard::file_of(square);
+        int32_t y = bitboard::rank_of(square);
+
+        for ( int32_t y1 = y + 1; y1 < 8; y1++ ) tables.front[WHITE][square] |= bitboard::square_bit( bitboard::make_square(x, y1) );
+        for ( int32_t y1 = y - 1; y1 >= 0; y1-- ) tables.front[BLACK][square] |= bitboard::square_bit( bitboard::make_square(x, y1) );
+
+        for ( uint32_t color = WHITE; color <= BLACK; color++ ) {
+            mask front = tables.front[color][square];
+            tables.passed[color][square] = front | ( ( front << 1 ) & ~bitboard::FILE_A ) | ( ( front >> 1 ) & ~bitboard::FILE_H );
+        }
+    }
+
+    return tables;
+}
+
+inline constexpr span_tables spans = make_span_tables();
+
+
+
+/*
+ The pawn structure of a position. Everything except the king shield only depends on the pawns,
+ so an entry can be reused for every position that has the same pawns.
+ A zeroed entry is the correct analysis of a position without pawns.
+*/
+struct PawnEntry
+{
+    uint64_t key = 0;
+    int32_t score = 0; // doubled, isolated and passed pawns from whites point of view
+    std::array<mask, 2> passed{}; // the passed pawns of both colors
+
+    // the shield is only calculated again when the king has moved
+    std::array<uint8_t, 2> shield_king = { bitboard::NO_SQUARE, bitboard::NO_SQUARE };
+    std::array<int16_t, 2> shield{};
+};
+
+
+// calculates everything of the entry that only depends on the pawns
+inline void analyse( const Position& pos, PawnEntry& entry ) noexcept
+{
+    entry = PawnEntry();
+    entry.key = pos.pawn_key();
+
+    for ( uint32_t color = WHITE; color <= BLACK; color++ ) {
+        mask own = pos.pieces(color, PAWN);
+        mask enemy = pos.pieces(color ^ 1, PAWN);
+        mask remaining = own;
+        int32_t score = 0;
+
+        while ( remaining ) {
+            int32_t square = bitboard::pop_lsb(remaining);
+
+            // only the pawns that have an own pawn in front of them are counted, so 2 pawns on a file give one penalty
+            if ( spans.front[color][square] & own ) score -= DOUBLED_PENALTY;
+            if ( !( spans.adjacent_files[ bitboard::file_of(square) ] & own ) ) score -= ISOLATED_PENALTY;
+
+            if ( !( spans.passed[color][square] & enemy ) && !( spans.front[color][square] & own ) ) {
+                entry.passed[color] |= bitboard::square_bit(square);
+                score += passed_bonus[ ( color == WHITE ) ? bitboard::rank_of(square) : 7 - bitboard::rank_of(square) ];
+            }
+        }
+
+        entry.score += ( color == WHITE ) ? score : -score;
+    }
+}
+
+
+// the own pawns on the 2 ranks in front of the king, this only counts while the king is still on its first 2 ranks
+inline int32_t king_shield( const Position& pos, const uint32_t& color, const int32_t& king ) noexcept
+{
+    if ( king == bitboard::NO_SQUARE ) return 0;
+
+    int32_t rank = bitboard::rank_of(king);
+    if ( ( color == WHITE ) ? rank > 1 : rank < 6 ) return 0;
+
+    int32_t file = bitboard::file_of(king);
+    mask files = spans.adjacent_files[file] | ( bitboard::FILE_A << file );
+    int32_t forward = ( color == WHITE ) ? 1 : -1;
+
+    mask near = files & ( bitboard::RANK_1 << ( 8 * ( rank + forward ) ) );
+    mask far = files & ( bitboard::RANK_1 << ( 8 * ( rank + 2*forward ) ) );
+    mask own = pos.pieces(color, PAWN);
+
+    return SHIELD_NEAR * bitboard::popcount( near & own ) + SHIELD_FAR * bitboard::popcount( far & own );
+}
+
+
+// returns the pawn structure and king shield score of the entry from whites point of view,
+// the shield of a color is updated first if its king isn't on the square the shield was calculated for
+inline int32_t entry_score( const Position& pos, PawnEntry& entry ) noexcept
+{
+    for ( uint32_t color = WHITE; color <= BLACK; color++ ) {
+        int32_t king = pos.king_square(color);
+
+        if ( entry.shield_king[color] != king ) {
+            entry.shield_king[color] = static_cast<uint8_t>(king);
+            entry.shield[color] = static_cast<int16_t>( king_shield(pos, color, king) );
+        }
+    }
+
+    return entry.score + entry.shield[WHITE] - entry.shield[BLACK];
+}
+
+}
+
+
+
+/*
+ A cache of pawn structures that is keyed by the pawn hash of the position. The pawns change only with pawn moves and
+ captures of pawns, so most positions of a search find their structure here. A table isn't thread safe,
+ every thread uses its own table, for example the one of its Searcher.
+*/
+class PawnTable
+{
+    private:
+        std::vector<pawns::PawnEntry> entries;
+        uint64_t probes = 0;
+        uint64_t hits = 0;
+
+    public:
+        // the size is rounded down to a power of two, so the index is the low bits of the key
+        explicit PawnTable( size_t size = 8192 )
+        {
+            size_t rounded = 1;
+            while ( rounded * 2 <= size ) rounded *= 2;
+            entries.resize(rounded);
+        }
+
+        // returns the entry of the pawns of the position, it's analysed first when it isn't in the table
+        pawns::PawnEntry& probe( const Position& pos ) noexcept
+        {
+            pawns::PawnEntry& entry = entries[ pos.pawn_key() & ( entries.size() - 1 ) ];
+
+            probes++;
+            if ( entry.key == pos.pawn_key() ) hits++;
+            else pawns::analyse(pos, entry);
+
+            return entry;
+        }
+
+        // the pawn structure score of the position from whites point of view
+        inline int32_t score( const Position& pos ) noexcept
+        {
+            return pawns::entry_score( pos, probe(pos) );
+        }
+
+        void clear() noexcept
+        {
+            std::fill( entries.begin(), entries.end(), pawns::PawnEntry() );
+            probes = 0;
+            hits = 0;
+        }
+
+        inline uint64_t probe_count() const noexcept { return probes; }
+        inline uint64_t hit_count() const noexcept { return hits; }
+        inline double hit_rate() const noexcept { return ( probes ) ? static_cast<double>(hits) / static_cast<double>(probes) : 0.0; }
+};
+
+#endif
@@ -0,0 +1,499 @@
+#ifndef PGN
+#define PGN
+
+#include <cstdint>
+#include <cctype>
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "helper_tools.hpp"
+#include "position.hpp"
+#include "move_log.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+
+struct PgnTag
+{
+    std::string name;
+    std::string value;
+};
+
+
+// a game that was read from a PGN file. The object is reused for the next game, so its vectors keep their memory
+struct PgnGame
+{
+    std::vector<PgnTag> tags;
+    Position start; // the standard start, or the FEN tag of the game
+    std::vector<Move> moves;
+    std::string result = "*"; // "1-0", "0-1", "1/2-1/2" or "*"
+    bool valid = true; // false if a move or the FEN couldn't be read, the moves before it are kept
+    size_t offset = 0; // where the game starts in the text
+
+    void clear()
+    {
+        tags.clear();
+        start = Position::start_position();
+        moves.clear();
+        result = "*";
+        valid = true;
+    }
+
+    // returns the value of the tag, or an empty string
+    std::string_view tag( const std::string_view& name ) const noexcept
+    {
+        for ( const PgnTag& a_tag : tags ) {
+            if ( a_tag.name == name ) return a_tag.value;
+        }
+        return std::string_view();
+    }
+
+    // 1 if white won, -1 if black won and 0 for a draw or an unfinished game
+    int32_t score() const noexcept
+    {
+        if ( result == "1-0" ) return 1;
+        if ( result == "0-1" ) return -1;
+        return 0;
+    }
+};
+
+
+struct PgnStats
+{
+    uint64_t games = 0;
+    uint64_t moves = 0;
+    uint64_t invalid_games = 0;
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+};
+
+
+
+namespace pgn
+{
+
+inline bool is_space( const char& letter ) noexcept { return letter == ' ' || letter == '\n' || letter == '\r' || letter == '\t'; }
+
+// the characters that end a move token
+inline bool is_delimiter( const char& letter ) noexcept { return is_space(letter) || letter == '{' || letter == '(' || letter == ')' || letter == '[' || letter == ';'; }
+
+
+/*
+ Reads every game of the text and calls on_game( game ) after each one. The text is read in place, only the tag values
+ are copied. A game ends with its result or when the tags of the next game start, so a missing result is fine.
+ Comments, variations, NAGs and escape lines are skipped.
+*/
+template<typename F>
+void parse( const char* begin, const char* end, PgnStats& stats, F on_game )
+{
+    PgnGame game;
+    game.clear();
+
+    const char* text = begin;
+    bool has_content = false;
+    bool in_movetext = false;
+    Position pos = game.start;
+
+    auto finish = [&]() {
+        if ( has_content ) {
+            stats.games++;
+            stats.moves += game.moves.size();
+            if ( !game.valid ) stats.invalid_games++;
+            on_game( static_cast<const PgnGame&>(game) );
+        }
+
+        game.clear();
+        pos = game.start;
+        has_content = false;
+        in_movetext = false;
+    };
+
+    while ( text < end ) {
+        char letter = *text;
+
+        if ( is_space(letter) ) {
+            text++;
+            continue;
+        }
+
+        if ( !has_content ) game.offset = static_cast<size_t>( text - begin );
+
+        // a tag, the tags of the next game end the current one
+        if ( letter == '[' ) {
+            if ( in_movetext ) {
+                finish();
+                game.offset = static_cast<size_t>( text - begin );
+            }
+
+            const char* name_start = ++text;
+            while ( text < end && !is_space(*text) && *text != ']' ) text++;
+
+            PgnTag a_tag;
+            a_tag.name.assign( name_start, text );
+
+            while ( text < end && *text != '"' && *text != ']' ) text++;
+
+            if ( text < end && *text == '"' ) {
+                for ( text++; text < end && *text != '"'; text++ ) {
+                    if ( *text == '\\' && text + 1 < end ) text++;
+                    a_tag.value += *text;
+                }
+            }
+
+            while ( text < end && *text != ']' && *text != '\n' ) text++;
+            if ( text < end && *text == ']' ) text++;
+
+            if ( a_tag.name == "FEN" ) {
+                game.valid = game.start.set_fen(a_tag.value) && game.valid;
+                pos = game.start;
+            }
+
+            game.tags.push_back( std::move(a_tag) );
+            has_content = true;
+            continue;
+        }
+
+        has_content = true;
+        in_movetext = true;
+
+        if ( letter == '{' ) {
+            while ( text < end && *text != '}' ) text++;
+            if ( text < end ) text++;
+            continue;
+        }
+
+        // the rest of the line is a comment, and a "%" at the start of a line escapes it
+        if ( letter == ';' || ( letter == '%' && ( text == begin || text[-1] == '\n' ) ) ) {
+            while ( text < end && *text != '\n' ) text++;
+            continue;
+        }
+
+        // a variation, they can be nested and contain comments
+        if ( letter == '(' ) {
+            uint32_t depth = 0;
+
+            for ( ; text < end; text++ ) {
+                if ( *text == '{' ) {
+                    while ( text < end && *text != '}' ) text++;
+                    if ( text == end ) break;
+                }
+                else if ( *text == '(' ) depth++;
+                else if ( *text == ')' && --depth == 0 ) break;
+            }
+
+            // an unclosed comment or variation runs to the end of the text
+            if ( text < end ) text++;
+            continue;
+        }
+
+        const char* token_start = text;
+        while ( text < end && !is_delimiter(*text) ) text++;
+        std::string_view token( token_start, static_cast<size_t>( text - token_start ) );
+
+        // a stray ")" or "]"
+        if ( token.empty() ) {
+            text++;
+            continue;
+        }
+
+        if ( token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*" ) {
+            game.result.assign( token.data(), token.size() );
+            finish();
+            continue;
+        }
+
+        if ( token.front() == '$' ) continue;
+
+        // a move number like "12." or "12...", it can be written together with the move
+        if ( std::isdigit( static_cast<unsigned char>( token.front() ) ) ) {
+            size_t digits = 0;
+            while ( digits < token.size() && std::isdigit( static_cast<unsigned char>( token[digits] ) ) ) digits++;
+
+            if ( digits == token.size() || token[digits] == '.' ) {
+                while ( digits < token.size() && token[digits] == '.' ) digits++;
+                token.remove_prefix(digits);
+                if ( token.empty() ) continue;
+            }
+        }
+
+        if ( !game.valid ) continue;
+
+        Move a_move = pos.parse_san(token);
+
+        if ( a_move.is_null() ) {
+            game.valid = false;
+            continue;
+        }
+
+        game.moves.push_back(a_move);
+        pos.play(a_move);
+    }
+
+    finish();
+}
+
+}
+
+
+
+/*
+ Reads games from a PGN file that is memory mapped, so even files of many gigabytes are read without loading them.
+ Every move is read as SAN against the legal moves of the position, and each complete game is handed to a callback.
+*/
+class PgnReader
+{
+    private:
+        MappedFile file;
+
+        inline const char* text() const noexcept { return reinterpret_cast<const char*>( file.data() ); }
+
+        // the start of the first game at or after the offset. The games are found by their "[Event" tag,
+        // which is the first tag of a game, so a file without it is read by a single thread
+        size_t game_start( size_t offset ) const noexcept
+        {
+            std::string_view all( text(), file.size() );
+
+            while ( offset < all.size() ) {
+                size_t found = all.find( "[Event ", offset );
+                if ( found == std::string_view::npos ) return all.size();
+                if ( found == 0 || all[found - 1] == '\n' ) return found;
+                offset = found + 1;
+            }
+
+            return all.size();
+        }
+
+
+    public:
+        PgnReader() { }
+
+        explicit PgnReader( const std::string& path ) { open(path); }
+
+        bool open( const std::string& path ) { return file.open(path); }
+
+        inline bool is_open() const noexcept { return file.is_open(); }
+        inline size_t size() const noexcept { return file.size(); }
+
+
+        /**
+         * @brief Reads every game of the file in order.
+         * @param on_game is called as on_game( const PgnGame& ) after every game, the game is reused after the call
+         */
+        template<typename F>
+        PgnStats read( F on_game ) const
+        {
+            PgnStats stats;
+            auto start = std::chrono::steady_clock::now();
+
+            if ( file.is_open() ) pgn::parse( text(), text() + file.size(), stats, on_game );
+
+            stats.bytes = file.size();
+            stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+            return stats;
+        }
+
+
+        /**
+         * @brief Reads the file with the threads of the pool. The file is split into pieces at the start of a game,
+         * so every game is read by one thread, but the games aren't handed over in the order of the file.
+         *
+         * @param on_game is called as on_game( worker_index, const PgnGame& ) from the threads of the pool at the same time
+         */
+        template<typename F>
+        PgnStats read_parallel( ThreadPool& pool, F on_game ) const
+        {
+            PgnStats stats;
+            auto start = std::chrono::steady_clock::now();
+
+            if ( !file.is_open() ) return stats;
+
+            // a few pieces per thread, so a thread that gets long games doesn't keep the others waiting
+            size_t piece_count = std::max<size_t>( pool.size() * 4, 1 );
+            std::vector<size_t> bounds = { 0 };
+
+            for ( size_t i = 1; i < piece_count; i++ ) {
+                size_t bound = game_start( std::max( file.size() * i / piece_count, bounds.back() ) );
+                if ( bound > bounds.back() && bound < file.size() ) bounds.push_back(bound);
+            }
+
+            bounds.push_back( file.size() );
+
+            std::vector<PgnStats> piece_stats( bounds.size() - 1 );
+
+            pool.parallel_for( piece_stats.size(), 1, [&]( size_t worker, size_t begin, size_t end ) {
+                for ( size_t i = begin; i < end; i++ ) {
+                    pgn::parse( text() + bounds[i], text() + bounds[i + 1], piece_stats[i], [&]( const PgnGame& game ) { on_game( worker, game ); } );
+                }
+            } );
+
+            for ( const PgnStats& piece : piece_stats ) {
+                stats.games += piece.games;
+                stats.moves += piece.moves;
+                stats.invalid_games += piece.invalid_games;
+            }
+
+            stats.bytes = file.size();
+            stats.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+            return stats;
+        }
+};
+
+
+
+/*
+ Writes games as PGN into a stream. The moves are replayed from the start position and every SAN is written straight
+ from a small buffer into the stream, so no strings are built for the moves. The lines are wrapped at 80 characters.
+*/
+class PgnWriter
+{
+    private:
+        static constexpr uint32_t LINE_LENGTH = 80;
+
+        std::ostream& out;
+        uint32_t column = 0;
+
+
+        // writes a word of the movetext, it goes to a new line when it doesn't fit anymore
+        void put_word( const char* word, const uint32_t& length )
+        {
+            if ( column > 0 && column + 1 + length > LINE_LENGTH ) {
+                out.put('\n');
+                column = 0;
+            }
+            else if ( column > 0 ) {
+                out.put(' ');
+                column++;
+            }
+
+            out.write( word, length );
+            column += length;
+        }
+
+        void put_move_number( const Position& pos, const bool& first )
+        {
+            if ( pos.side_to_move() == BLACK && !first ) return;
+
+            std::array<char, 16> number;
+            uint32_t length = 0;
+            uint32_t value = pos.fullmove_number();
+
+            do {
+                number[ length++ ] = static_cast<char>( '0' + value % 10 );
+                value /= 10;
+            } while ( value );
+
+            std::reverse( number.begin(), number.begin() + length );
+            number[ length++ ] = '.';
+
+            if ( pos.side_to_move() == BLACK ) {
+                number[ length++ ] = '.';
+                number[ length++ ] = '.';
+            }
+
+            put_word( number.data(), length );
+        }
+
+        void put_tag( const std::string_view& name, const std::string_view& value )
+        {
+            out << '[' << name << " \"";
+
+            for ( const char& letter : value ) {
+                if ( letter == '"' || letter == '\\' ) out.put('\\');
+                out.put(letter);
+            }
+
+            out << "\"]\n";
+        }
+
+        void put_tags( const std::vector<PgnTag>& tags, const Position& start, const std::string_view& result )
+        {
+            bool has_result = false;
+            bool has_fen = false;
+
+            for ( const PgnTag& a_tag : tags ) {
+                if ( a_tag.name == "Result" ) {
+                    put_tag( a_tag.name, result );
+                    has_result = true;
+                }
+                else put_tag( a_tag.name, a_tag.value );
+
+                has_fen |= a_tag.name == "FEN";
+            }
+
+            if ( !has_result ) put_tag( "Result", result );
+
+            if ( !has_fen && start.key() != Position::start_position().key() ) {
+                put_tag( "SetUp", "1" );
+                put_tag( "FEN", start.fen() );
+            }
+
+            out.put('\n');
+            column = 0;
+        }
+
+        void put_result( const std::string_view& result )
+        {
+            put_word( result.data(), static_cast<uint32_t>( result.size() ) );
+            out << "\n\n";
+            column = 0;
+        }
+
+
+    public:
+        explicit PgnWriter( std::ostream& out0 ) : out(out0) { }
+
+        /**
+         * @brief Writes the game of a move log. The checks come from the flags of the log, so they aren't calculated again.
+         *
+         * @param tags the tags in the order they are written, the Result tag is always written with the result
+         * @param result "1-0", "0-1", "1/2-1/2" or "*". An empty result is taken from the checkmates in the log
+         */
+        void write( const MoveLog& log, const std::vector<PgnTag>& tags = {}, std::string_view result = std::string_view() )
+        {
+            if ( result.empty() ) result = ( log.is_checkmated(WHITE) ) ? "0-1" : ( log.is_checkmated(BLACK) ) ? "1-0" : "*";
+
+            Position pos = log.start_position();
+            put_tags( tags, pos, result );
+
+            std::array<char, MAX_SAN_LENGTH> san;
+
+            for ( size_t ply = 0; ply < log.size(); ply++ ) {
+                const MoveLogEntry& entry = log[ply];
+                put_move_number( pos, ply == 0 );
+
+                uint32_t length = pos.write_san( entry.move, san.data(), false );
+                if ( entry.flags & LOG_CHECKMATE ) san[ length++ ] = '#';
+                else if ( entry.flags & LOG_CHECK ) san[ length++ ] = '+';
+
+                put_word( san.data(), length );
+                pos.play( entry.move );
+            }
+
+            put_result(result);
+        }
+
+        // writes a game that was read by the PgnReader
+        void write( const PgnGame& game )
+        {
+            Position pos = game.start;
+            put_tags( game.tags, pos, game.result );
+
+            std::array<char, MAX_SAN_LENGTH> san;
+
+            for ( size_t ply = 0; ply < game.moves.size(); ply++ ) {
+                put_move_number( pos, ply == 0 );
+                put_word( san.data(), pos.write_san( game.moves[ply], san.data() ) );
+                pos.play( game.moves[ply] );
+            }
+
+            put_result( game.result );
+        }
+};
+
+#endif
@@ -0,0 +1,1223 @@
+#ifndef POSITION
+#define POSITION
+
+#include <cstdint>
+#include <array>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+
+using bitboard::mask;
+
+
+
+// a piece on a Position is stored as a single byte: the low 3 bits contain the piece type
+// ( PAWN...KING from the pieces enum ) and the 4th bit contains the color, 0 means an empty square.
+constexpr inline uint8_t make_piece( const uint32_t& type, const uint32_t& color ) noexcept { return static_cast<uint8_t>( type | ( color << 3 ) ); }
+constexpr inline uint32_t piece_type( const uint8_t& piece ) noexcept { return piece & 7; }
+constexpr inline uint32_t piece_color( const uint8_t& piece ) noexcept { return piece >> 3; }
+
+
+// the castling rights are stored as bits, the index of a bit is color*2 + wing.
+enum castling_rights
+{
+    WHITE_KING_SIDE = 1,
+    WHITE_QUEEN_SIDE = 2,
+    BLACK_KING_SIDE = 4,
+    BLACK_QUEEN_SIDE = 8,
+
+    ALL_CASTLING = 15
+};
+
+
+/*
+ the 4 highest bits of a Move. The promotion flags store the promoted piece in the 2 lowest bits
+ ( KNIGHT, BISHOP, ROOK, QUEEN ) and the capture bit tells us if the promotion also captured a piece.
+*/
+enum move_flags
+{
+    QUIET_MOVE = 0,
+    DOUBLE_PAWN_PUSH = 1,
+    KING_SIDE_CASTLE = 2,
+    QUEEN_SIDE_CASTLE = 3,
+    CAPTURE = 4,
+    EN_PASSANT_CAPTURE = 5,
+    PROMOTION = 8
+};
+
+
+// A move packed into 16 bits: 6 bits for the origin square, 6 bits for the target square and 4 bits for the flags.
+// Castling moves store the kings origin and the kings target square.
+struct Move
+{
+    uint16_t data = 0;
+
+    constexpr Move() noexcept { }
+
+    constexpr explicit Move( uint16_t data0 ) noexcept : data(data0) { }
+
+    constexpr Move( uint32_t from0, uint32_t to0, uint32_t flags0 = QUIET_MOVE ) noexcept
+        : data( static_cast<uint16_t>( from0 | ( to0 << 6 ) | ( flags0 << 12 ) ) ) { }
+
+    constexpr int32_t from() const noexcept { return data & 63; }
+    constexpr int32_t to() const noexcept { return ( data >> 6 ) & 63; }
+    constexpr uint32_t flags() const noexcept { return data >> 12; }
+
+    constexpr bool is_null() const noexcept { return data == 0; }
+    constexpr bool is_capture() const noexcept { return ( flags() & CAPTURE ) != 0; }
+    constexpr bool is_promotion() const noexcept { return ( flags() & PROMOTION ) != 0; }
+    constexpr bool is_castling() const noexcept { return flags() == KING_SIDE_CASTLE || flags() == QUEEN_SIDE_CASTLE; }
+    constexpr bool is_en_passant() const noexcept { return flags() == EN_PASSANT_CAPTURE; }
+    constexpr uint32_t promotion_piece() const noexcept { return KNIGHT + ( flags() & 3 ); }
+
+    constexpr bool operator == ( const Move& a ) const noexcept { return data == a.data; }
+    constexpr bool operator != ( const Move& a ) const noexcept { return data != a.data; }
+
+    // returns the move in the long algebraic form that is used by UCI, e.g "e2e4" or "e7e8q"
+    std::string to_string() const
+    {
+        if ( is_null() ) return "0000";
+
+        std::string text = helper::chess_letters[ bitboard::file_of(from()) ] + std::to_string( bitboard::rank_of(from()) + 1 ) +
+                           helper::chess_letters[ bitboard::file_of(to()) ] + std::to_string( bitboard::rank_of(to()) + 1 );
+
+        if ( is_promotion() ) {
+            text += "nbrq"[ promotion_piece() - KNIGHT ];
+        }
+
+        return text;
+    }
+};
+
+// the longest SAN text of a move, like "Qa1xb2+" or "exd8=Q#", with room to spare
+constexpr uint32_t MAX_SAN_LENGTH = 8;
+
+
+// a fixed size list of moves, no legal chess position has more than 218 moves.
+struct MoveList
+{
+    std::array<Move, 256> moves;
+    uint32_t count = 0;
+
+    inline void push_back( const Move& a_move ) noexcept { moves[count++] = a_move; }
+    inline uint32_t size() const noexcept { return count; }
+    inline bool empty() const noexcept { return count == 0; }
+    inline void clear() noexcept { count = 0; }
+
+    inline Move& operator [] ( const size_t& index ) noexcept { return moves[index]; }
+    inline const Move& operator [] ( const size_t& index ) const noexcept { return moves[index]; }
+
+    inline Move* begin() noexcept { return moves.data(); }
+    inline Move* end() noexcept { return moves.data() + count; }
+    inline const Move* begin() const noexcept { return moves.data(); }
+    inline const Move* end() const noexcept { return moves.data() + count; }
+
+    bool contains( const Move& a_move ) const noexcept
+    {
+        for ( const Move& move : *this ) {
+            if ( move == a_move ) return true;
+        }
+        return false;
+    }
+};
+
+
+
+// every legal move of a position grouped by the origin square. It's built in one pass over the legal moves,
+// so the highlighting, the move validation and the evaluation don't have to generate the moves of each piece separately.
+struct LegalMoveMap
+{
+    std::array<mask, 64> targets{}; // the target squares of the normal moves, indexed by the origin square
+    mask origins = 0; // the squares of the pieces that have a legal move
+    mask castling = 0; // the king target squares of the castling moves, the king is on king_square
+    int32_t king_square = bitboard::NO_SQUARE;
+    std::array<uint32_t, 2> mobility{}; // the number of legal moves of both colors, as if each of them was to move
+
+    inline bool has_move( const int32_t& from, const int32_t& to ) const noexcept
+    {
+        return ( ( targets[from] | ( ( from == king_square ) ? castling : 0 ) ) & bitboard::square_bit(to) ) != 0;
+    }
+
+    inline uint32_t target_count( const int32_t& from ) const noexcept { return bitboard::popcount( targets[from] ); }
+};
+
+
+
+// the state that Position::play() overwrites and can't be calculated back from the move,
+// with it Position::undo() takes the move back in O(1).
+struct UndoRecord
+{
+    Move move;
+    uint8_t captured = 0; // the captured piece in the byte format of Position, 0 if the move didn't capture
+    uint8_t castling = 0;
+    uint8_t ep_square = 64;
+    uint8_t halfmoves = 0;
+    uint64_t hash = 0;
+};
+
+
+
+/*
+ A position packed into 32 bytes, made by Position::packed() and read by Position::set_packed().
+ Bytes 0-7 hold the occupied squares and bytes 8-23 hold a nibble per piece in the order of the squares, the nibble
+ is the piece byte of Position. The unused piece types 7 and 15 mark a rook that can still castle, so shuffled
+ starting positions need no extra bytes. Byte 24 holds the side to move, bit 4 tells if there is an en passant
+ square and bits 1-3 hold its file. Byte 25 is the halfmove clock, bytes 26-27 the fullmove number and the rest is zero.
+
+ Every position has exactly one packing and the board comes before the clocks, so sorting packed positions puts
+ the same boards next to each other. All numbers are little endian, so the bytes can be written to disk as they are.
+*/
+struct PackedPosition
+{
+    std::array<uint8_t, 32> bytes{};
+
+    inline bool operator == ( const PackedPosition& other ) const noexcept { return std::memcmp( bytes.data(), other.bytes.data(), 32 ) == 0; }
+    inline bool operator != ( const PackedPosition& other ) const noexcept { return !( *this == other ); }
+    inline bool operator < ( const PackedPosition& other ) const noexcept { return std::memcmp( bytes.data(), other.bytes.data(), 32 ) < 0; }
+};
+
+struct PackedPositionHash
+{
+    size_t operator () ( const PackedPosition& packed ) const noexcept
+    {
+        std::array<uint64_t, 4> words;
+        std::memcpy( words.data(), packed.bytes.data(), 32 );
+
+        uint64_t mixed = words[0] * 0x9E3779B97F4A7C15ULL ^ words[1] * 0xBF58476D1CE4E5B9ULL ^ words[2] * 0x94D049BB133111EBULL ^ words[3];
+        return static_cast<size_t>( mixed ^ ( mixed >> 29 ) );
+    }
+};
+
+
+
+namespace zobrist
+{
+
+// splitmix64 is used to fill the key tables at compile time, so the keys are the same in every build.
+constexpr uint64_t next_key( uint64_t& state ) noexcept
+{
+    uint64_t z = ( state += 0x9E3779B97F4A7C15ULL );
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+    return z ^ ( z >> 31 );
+}
+
+struct key_tables
+{
+    std::array<std::array<uint64_t, 64>, 16> pieces{}; // indexed by the piece byte and the square
+    std::array<uint64_t, 16> castling{};
+    std::array<uint64_t, 8> en_passant{};
+    uint64_t side = 0;
+};
+
+constexpr key_tables make_keys() noexcept
+{
+    key_tables keys{};
+    uint64_t state = 0x5EED0C4E55ULL;
+
+    for ( auto& piece_keys : keys.pieces ) {
+        for ( uint64_t& key : piece_keys ) key = next_key(state);
+    }
+    for ( uint64_t& key : keys.castling ) key = next_key(state);
+    keys.castling[0] = 0; // an empty position without castling rights has the hash 0
+    for ( uint64_t& key : keys.en_passant ) key = next_key(state);
+
+    keys.side = next_key(state);
+
+    return keys;
+}
+
+inline constexpr key_tables keys = make_keys();
+
+}
+
+
+
+/*
+ Position is a compact and copyable chess position that is built on bitboards.
+ Board is the object that the gui uses, while Position is meant for the code that has to handle
+ alot of positions quickly, for example the search and the batch evaluation.
+ Castling is stored with the rooks origin squares so the same code also handles shuffled starting positions.
+*/
+class Position
+{
+    private:
+        std::array<mask, PIECES_COUNT> by_type{}; // indexed by the pieces enum, index 0 is unused
+        std::array<mask, 2> by_color{};
+        std::array<uint8_t, 64> squares{};
+
+        uint8_t side = WHITE;
+        uint8_t castling = 0;
+        uint8_t ep_square = bitboard::NO_SQUARE;
+        uint8_t halfmoves = 0;
+        uint16_t fullmoves = 1;
+
+        // the squares of the rooks that can castle, indexed with color*2 + wing ( 0 = king side, 1 = queen side )
+        std::array<uint8_t, 4> castling_rooks = { 7, 0, 63, 56 };
+
+        uint64_t hash = 0;
+        uint64_t pawn_hash = 0; // only the pawns, the pawn structure evaluation caches its results with it
+
+
+        inline void put_piece( const int32_t& square, const uint8_t& piece ) noexcept
+        {
+            by_type[ piece_type(piece) ] |= bitboard::square_bit(square);
+            by_color[ piece_color(piece) ] |= bitboard::square_bit(square);
+            squares[square] = piece;
+            hash ^= zobrist::keys.pieces[piece][square];
+            if ( piece_type(piece) == PAWN ) pawn_hash ^= zobrist::keys.pieces[piece][square];
+        }
+
+        inline uint8_t remove_piece( const int32_t& square ) noexcept
+        {
+            uint8_t piece = squares[square];
+
+            by_type[ piece_type(piece) ] &= ~bitboard::square_bit(square);
+            by_color[ piece_color(piece) ] &= ~bitboard::square_bit(square);
+            squares[square] = 0;
+            hash ^= zobrist::keys.pieces[piece][square];
+            if ( piece_type(piece) == PAWN ) pawn_hash ^= zobrist::keys.pieces[piece][square];
+
+            return piece;
+        }
+
+        // the en passant square is only stored when a pawn of the capturing color can actually capture,
+        // this way the same position always has the same hash.
+        inline void set_en_passant( const int32_t& square, const uint32_t& capturer ) noexcept
+        {
+            if ( bitboard::tables.pawn[ capturer ^ 1 ][square] & pieces( capturer, PAWN ) ) {
+                ep_square = static_cast<uint8_t>(square);
+                hash ^= zobrist::keys.en_passant[ bitboard::file_of(square) ];
+            }
+        }
+
+        inline void add_moves( MoveList& list, const int32_t& from, mask targets ) const noexcept
+        {
+            while ( targets ) {
+                int32_t to = bitboard::pop_lsb(targets);
+                list.push_back( Move( from, to, ( squares[to] ) ? CAPTURE : QUIET_MOVE ) );
+            }
+        }
+
+        inline void add_promotions( MoveList& list, const int32_t& from, const int32_t& to, const uint32_t& capture ) const noexcept
+        {
+            for ( uint32_t piece = QUEEN; piece >= KNIGHT; piece-- ) {
+                list.push_back( Move( from, to, PROMOTION | capture | ( piece - KNIGHT ) ) );
+            }
+        }
+
+        void add_pawn_moves( MoveList& list, const int32_t& from ) const noexcept
+        {
+            mask occ = occupied();
+            int32_t forward = ( side == WHITE ) ? 8 : -8;
+            mask start_rank = ( side == WHITE ) ? ( bitboard::RANK_1 << 8 ) : ( bitboard::RANK_8 >> 8 );
+            mask promotion_rank = ( side == WHITE ) ? bitboard::RANK_8 : bitboard::RANK_1;
+            int32_t to = from + forward;
+
+            if ( !( occ & bitboard::square_bit(to) ) ) {
+                if ( bitboard::square_bit(to) & promotion_rank ) {
+                    add_promotions( list, from, to, 0 );
+                }
+                else {
+                    list.push_back( Move(from, to, QUIET_MOVE) );
+
+                    if ( ( bitboard::square_bit(from) & start_rank ) && !( occ & bitboard::square_bit( to + forward ) ) ) {
+                        list.push_back( Move(from, to + forward, DOUBLE_PAWN_PUSH) );
+                    }
+                }
+            }
+
+            mask captures = bitboard::tables.pawn[side][from] & by_color[ side ^ 1 ];
+            while ( captures ) {
+                to = bitboard::pop_lsb(captures);
+
+                if ( bitboard::square_bit(to) & promotion_rank ) add_promotions( list, from, to, CAPTURE );
+                else list.push_back( Move(from, to, CAPTURE) );
+            }
+
+            if ( ep_square != bitboard::NO_SQUARE && ( bitboard::tables.pawn[side][from] & bitboard::square_bit(ep_square) ) ) {
+                list.push_back( Move(from, ep_square, EN_PASSANT_CAPTURE) );
+            }
+        }
+
+        void add_castling( MoveList& list ) const noexcept
+        {
+            uint32_t them = side ^ 1;
+            int32_t king = king_square(side);
+            int32_t back_rank = ( side == WHITE ) ? 0 : 56;
+
+            if ( !( castling & ( 3 << ( side*2 ) ) ) || in_check() ) return;
+
+            for ( uint32_t wing = 0; wing < 2; wing++ ) {
+                if ( !( castling & ( 1 << ( side*2 + wing ) ) ) ) continue;
+
+                int32_t rook = castling_rooks[ side*2 + wing ];
+                int32_t king_target = back_rank + ( ( wing == 0 ) ? 6 : 2 );
+                int32_t rook_target = back_rank + ( ( wing == 0 ) ? 5 : 3 );
+
+                // every square that the king or the rook passes has to be empty, except for the king and the rook themselves
+                mask must_be_empty = ( bitboard::between(king, king_target) | bitboard::square_bit(king_target) |
+                                       bitboard::between(rook, rook_target) | bitboard::square_bit(rook_target) ) &
+                                     ~( bitboard::square_bit(king) | bitboard::square_bit(rook) );
+
+                if ( must_be_empty & occupied() ) continue;
+
+                // the king cannot pass through an attacked square
+                mask king_path = bitboard::between(king, king_target) | bitboard::square_bit(king_target);
+                bool path_attacked = false;
+
+                while ( king_path && !path_attacked ) {
+                    path_attacked = square_attacked( bitboard::pop_lsb(king_path), them );
+                }
+
+                if ( !path_attacked ) {
+                    list.push_back( Move( king, king_target, ( wing == 0 ) ? KING_SIDE_CASTLE : QUEEN_SIDE_CASTLE ) );
+                }
+            }
+        }
+
+
+    public:
+        // these methods return the basic values of the position
+        inline uint32_t side_to_move() const noexcept { return side; }
+        inline uint32_t castling_state() const noexcept { return castling; }
+        inline int32_t en_passant() const noexcept { return ep_square; }
+        inline uint32_t halfmove_clock() const noexcept { return halfmoves; }
+        inline uint32_t fullmove_number() const noexcept { return fullmoves; }
+        inline uint64_t key() const noexcept { return hash; }
+        inline uint64_t pawn_key() const noexcept { return pawn_hash; }
+        inline int32_t castling_rook( const uint32_t& color, const uint32_t& wing ) const noexcept { return castling_rooks[ color*2 + wing ]; }
+
+        inline uint8_t piece_on( const int32_t& square ) const noexcept { return squares[square]; }
+        inline mask occupied() const noexcept { return by_color[WHITE] | by_color[BLACK]; }
+        inline mask color_pieces( const uint32_t& color ) const noexcept { return by_color[color]; }
+        inline mask pieces( const uint32_t& type ) const noexcept { return by_type[type]; }
+        inline mask pieces( const uint32_t& color, const uint32_t& type ) const noexcept { return by_color[color] & by_type[type]; }
+
+        inline int32_t king_square( const uint32_t& color ) const noexcept
+        {
+            mask king = pieces(color, KING);
+            return ( king ) ? bitboard::lsb(king) : bitboard::NO_SQUARE;
+        }
+
+
+        Position() { }
+
+        // removes every piece and resets the state
+        void clear() noexcept
+        {
+            *this = Position();
+        }
+
+        // returns the standard starting position
+        static Position start_position()
+        {
+            Position pos;
+            pos.set_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+            return pos;
+        }
+
+
+        // adds a piece onto an empty square, this is used when a position is built piece by piece
+        void add_piece( const int32_t& square, const uint32_t& type, const uint32_t& color ) noexcept
+        {
+            if ( squares[square] ) remove_piece(square);
+            put_piece( square, make_piece(type, color) );
+        }
+
+        // sets the remaining state after the pieces have been added with add_piece()
+        void set_state( const uint32_t& side0, const uint32_t& castling0, const int32_t& ep0, const uint32_t& halfmoves0, const uint32_t& fullmoves0 ) noexcept
+        {
+            if ( side != side0 ) hash ^= zobrist::keys.side;
+            side = static_cast<uint8_t>(side0);
+
+            hash ^= zobrist::keys.castling[castling];
+            castling = static_cast<uint8_t>(castling0 & ALL_CASTLING);
+            hash ^= zobrist::keys.castling[castling];
+
+            if ( ep_square != bitboard::NO_SQUARE ) hash ^= zobrist::keys.en_passant[ bitboard::file_of(ep_square) ];
+            ep_square = bitboard::NO_SQUARE;
+            if ( ep0 >= 0 && ep0 < 64 ) set_en_passant(ep0, side);
+
+            halfmoves = static_cast<uint8_t>( helper::clamp<uint32_t>(halfmoves0, 0, 255) );
+            fullmoves = static_cast<uint16_t>( helper::clamp<uint32_t>(fullmoves0, 1, 65535) );
+        }
+
+        void set_castling_rook( const uint32_t& color, const uint32_t& wing, const int32_t& square ) noexcept
+        {
+            castling_rooks[ color*2 + wing ] = static_cast<uint8_t>(square);
+        }
+
+
+        // returns a mask of all the pieces of both colors that attack the given square
+        mask attackers_to( const int32_t& square, const mask& occ ) const noexcept
+        {
+            return ( bitboard::tables.pawn[BLACK][square] & pieces(WHITE, PAWN) ) |
+                   ( bitboard::tables.pawn[WHITE][square] & pieces(BLACK, PAWN) ) |
+                   ( bitboard::tables.knight[square] & by_type[KNIGHT] ) |
+                   ( bitboard::tables.king[square] & by_type[KING] ) |
+                   ( bitboard::bishop_attacks(square, occ) & ( by_type[BISHOP] | by_type[QUEEN] ) ) |
+                   ( bitboard::rook_attacks(square, occ) & ( by_type[ROOK] | by_type[QUEEN] ) );
+        }
+
+        inline bool square_attacked( const int32_t& square, const uint32_t& by ) const noexcept
+        {
+            return ( attackers_to( square, occupied() ) & by_color[by] ) != 0;
+        }
+
+        // returns the squares that the piece on the given square attacks
+        mask attacks_from( const int32_t& square ) const noexcept
+        {
+            uint8_t piece = squares[square];
+
+            switch ( piece_type(piece) ) {
+                case PAWN: return bitboard::tables.pawn[ piece_color(piece) ][square];
+                case KNIGHT: return bitboard::tables.knight[square];
+                case BISHOP: return bitboard::bishop_attacks( square, occupied() );
+                case ROOK: return bitboard::rook_attacks( square, occupied() );
+                case QUEEN: return bitboard::queen_attacks( square, occupied() );
+                case KING: return bitboard::tables.king[square];
+                default: return 0;
+            }
+        }
+
+        inline bool in_check() const noexcept
+        {
+            int32_t king = king_square(side);
+            return king != bitboard::NO_SQUARE && square_attacked( king, side ^ 1 );
+        }
+
+
+        // generates every move without checking whether the own king is left in check
+        void generate_pseudo_legal( MoveList& list ) const noexcept
+        {
+            mask pawns = pieces(side, PAWN);
+            while ( pawns ) add_pawn_moves( list, bitboard::pop_lsb(pawns) );
+
+            mask own = by_color[side];
+            mask others = own & ~by_type[PAWN];
+            while ( others ) {
+                int32_t from = bitboard::pop_lsb(others);
+                add_moves( list, from, attacks_from(from) & ~own );
+            }
+
+            add_castling(list);
+        }
+
+        // generates the moves of the own piece on the given square without checking whether the own king is left in check,
+        // in the same order as generate_pseudo_legal()
+        void generate_pseudo_legal_from( const int32_t& from, MoveList& list ) const noexcept
+        {
+            uint8_t piece = squares[from];
+            if ( !piece || piece_color(piece) != side ) return;
+
+            if ( piece_type(piece) == PAWN ) {
+                add_pawn_moves( list, from );
+                return;
+            }
+
+            add_moves( list, from, attacks_from(from) & ~by_color[side] );
+            if ( piece_type(piece) == KING ) add_castling(list);
+        }
+
+
+        // returns true if the given pseudo legal move doesn't leave the own king in check
+        inline bool leaves_king_safe( const Move& a_move ) const noexcept
+        {
+            Position after = *this;
+            after.play(a_move);
+
+            int32_t king = after.king_square(side);
+            return king == bitboard::NO_SQUARE || !after.square_attacked( king, side ^ 1 );
+        }
+
+        // the own pieces that are the only piece between the king and an enemy slider, moving them off the line can expose the king
+        mask pinned_pieces( const int32_t& king ) const noexcept
+        {
+            uint32_t them = side ^ 1;
+            mask queens = pieces(them, QUEEN);
+            mask snipers = ( bitboard::rook_attacks( king, 0 ) & ( pieces(them, ROOK) | queens ) )
+                         | ( bitboard::bishop_attacks( king, 0 ) & ( pieces(them, BISHOP) | queens ) );
+            mask pinned = 0;
+
+            while ( snipers ) {
+                mask line = bitboard::between( king, bitboard::pop_lsb(snipers) ) & occupied();
+                if ( bitboard::popcount(line) == 1 ) pinned |= line & by_color[side];
+            }
+
+            return pinned;
+        }
+
+        // most moves are checked without playing them: a king move needs a safe target square and the other moves need a
+        // target that takes or blocks a single checker. Only castling, en passant and the moves of pinned pieces are played
+        void generate_legal( MoveList& list ) const noexcept
+        {
+            MoveList pseudo;
+            generate_pseudo_legal(pseudo);
+
+            int32_t king = king_square(side);
+            if ( king == bitboard::NO_SQUARE ) {
+                for ( const Move& a_move : pseudo ) list.push_back(a_move);
+                return;
+            }
+
+            mask occ = occupied();
+            mask checkers = attackers_to( king, occ ) & by_color[side ^ 1];
+            mask pinned = pinned_pieces(king);
+
+            mask evasions = ~mask(0);
+            if ( checkers ) evasions = ( bitboard::popcount(checkers) > 1 ) ? 0 : ( checkers | bitboard::between( king, bitboard::lsb(checkers) ) );
+
+            for ( const Move& a_move : pseudo ) {
+                int32_t from = a_move.from();
+                bool legal;
+
+                if ( from == king && !a_move.is_castling() ) {
+                    legal = !( attackers_to( a_move.to(), occ ^ bitboard::square_bit(king) ) & by_color[side ^ 1] );
+                }
+                else if ( from == king || a_move.is_en_passant() || ( pinned & bitboard::square_bit(from) ) ) {
+                    legal = leaves_king_safe(a_move);
+                }
+                else {
+                    legal = ( evasions & bitboard::square_bit( a_move.to() ) ) != 0;
+                }
+
+                if ( legal ) list.push_back(a_move);
+            }
+        }
+
+        bool has_legal_moves() const noexcept
+        {
+            MoveList pseudo;
+            generate_pseudo_legal(pseudo);
+
+            for ( const Move& a_move : pseudo ) {
+                if ( leaves_king_safe(a_move) ) return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief Groups the legal moves of the side to move by their origin square. Only the mobility of the side
+         * to move is counted, the other color stays at zero.
+         * @param legal the legal moves of this position
+         */
+        LegalMoveMap legal_move_targets( const MoveList& legal ) const noexcept
+        {
+            LegalMoveMap map;
+            map.king_square = king_square(side);
+            map.mobility[side] = legal.size();
+
+            for ( const Move& a_move : legal ) {
+                map.origins |= bitboard::square_bit( a_move.from() );
+
+                if ( a_move.is_castling() ) map.castling |= bitboard::square_bit( a_move.to() );
+                else map.targets[ a_move.from() ] |= bitboard::square_bit( a_move.to() );
+            }
+
+            return map;
+        }
+
+        /**
+         * @brief Groups the legal moves of the side to move by their origin square and counts the mobility of both colors.
+         * @param legal the legal moves of this position, if they are already generated they aren't generated again
+         */
+        LegalMoveMap legal_move_map( const MoveList& legal ) const noexcept
+        {
+            LegalMoveMap map = legal_move_targets(legal);
+
+            // the other color is counted with a null move, so its moves are legal in the same way
+            Position other = *this;
+            other.play_null();
+
+            MoveList other_moves;
+            other.generate_legal(other_moves);
+            map.mobility[ side ^ 1 ] = other_moves.size();
+
+            return map;
+        }
+
+        LegalMoveMap legal_move_map() const noexcept
+        {
+            MoveList legal;
+            generate_legal(legal);
+
+            return legal_move_map(legal);
+        }
+
+        inline bool is_checkmate() const noexcept { return in_check() && !has_legal_moves(); }
+        inline bool is_stalemate() const noexcept { return !in_check() && !has_legal_moves(); }
+
+
+
+        // executes a move, the move has to be at least pseudo legal
+        void play( const Move& a_move ) noexcept
+        {
+            int32_t from = a_move.from();
+            int32_t to = a_move.to();
+            uint8_t piece = squares[from];
+            uint32_t type = piece_type(piece);
+            uint8_t old_castling = castling;
+
+            if ( ep_square != bitboard::NO_SQUARE ) {
+                hash ^= zobrist::keys.en_passant[ bitboard::file_of(ep_square) ];
+                ep_square = bitboard::NO_SQUARE;
+            }
+
+            halfmoves++;
+
+            if ( a_move.is_castling() ) {
+                uint32_t wing = ( a_move.flags() == KING_SIDE_CASTLE ) ? 0 : 1;
+                int32_t rook = castling_rooks[ side*2 + wing ];
+                int32_t back_rank = ( side == WHITE ) ? 0 : 56;
+
+                // we first remove both pieces, because in shuffled games the king can land on the rooks square
+                uint8_t rook_piece = remove_piece(rook);
+                remove_piece(from);
+                put_piece( to, piece );
+                put_piece( back_rank + ( ( wing == 0 ) ? 5 : 3 ), rook_piece );
+            }
+
+            else {
+                if ( a_move.is_capture() ) {
+                    remove_piece( ( a_move.is_en_passant() ) ? to - ( ( side == WHITE ) ? 8 : -8 ) : to );
+                    halfmoves = 0;
+                }
+
+                remove_piece(from);
+                put_piece( to, ( a_move.is_promotion() ) ? make_piece( a_move.promotion_piece(), side ) : piece );
+
+                if ( type == PAWN ) {
+                    halfmoves = 0;
+
+                    if ( a_move.flags() == DOUBLE_PAWN_PUSH ) set_en_passant( ( from + to ) / 2, side ^ 1 );
+                }
+            }
+
+            // a king move removes both castling rights and moving or capturing a rook removes one
+            if ( type == KING ) castling &= ~( 3 << ( side*2 ) );
+
+            for ( uint32_t i = 0; i < 4; i++ ) {
+                if ( castling_rooks[i] == from || castling_rooks[i] == to ) castling &= ~( 1 << i );
+            }
+
+            hash ^= zobrist::keys.castling[old_castling] ^ zobrist::keys.castling[castling];
+
+            side ^= 1;
+            hash ^= zobrist::keys.side;
+
+            if ( side == WHITE ) fullmoves++;
+        }
+
+        // stores what play() is going to overwrite, this has to be called before the move is played.
+        UndoRecord undo_record( const Move& a_move ) const noexcept
+        {
+            UndoRecord record;
+            record.move = a_move;
+            record.castling = castling;
+            record.ep_square = ep_square;
+            record.halfmoves = halfmoves;
+            record.hash = hash;
+
+            if ( a_move.is_en_passant() ) record.captured = make_piece( PAWN, side ^ 1 );
+            else if ( a_move.is_capture() ) record.captured = squares[ a_move.to() ];
+
+            return record;
+        }
+
+        // takes back the move of the record, it has to be the last move that was played.
+        void undo( const UndoRecord& record ) noexcept
+        {
+            int32_t from = record.move.from();
+            int32_t to = record.move.to();
+
+            side ^= 1;
+            if ( side == BLACK ) fullmoves--;
+
+            if ( record.move.is_castling() ) {
+                uint32_t wing = ( record.move.flags() == KING_SIDE_CASTLE ) ? 0 : 1;
+                int32_t back_rank = ( side == WHITE ) ? 0 : 56;
+
+                uint8_t rook_piece = remove_piece( back_rank + ( ( wing == 0 ) ? 5 : 3 ) );
+                uint8_t king_piece = remove_piece(to);
+                put_piece( from, king_piece );
+                put_piece( castling_rooks[ side*2 + wing ], rook_piece );
+            }
+
+            else {
+                uint8_t piece = remove_piece(to);
+                put_piece( from, ( record.move.is_promotion() ) ? make_piece( PAWN, side ) : piece );
+
+                if ( record.captured ) {
+                    put_piece( ( record.move.is_en_passant() ) ? to - ( ( side == WHITE ) ? 8 : -8 ) : to, record.captured );
+                }
+            }
+
+            // the hash already includes everything that was restored, so it's copied instead of updated
+            castling = record.castling;
+            ep_square = record.ep_square;
+            halfmoves = record.halfmoves;
+            hash = record.hash;
+        }
+
+
+        // passes the turn to the opponent, the search uses this for null move pruning.
+        void play_null() noexcept
+        {
+            if ( ep_square != bitboard::NO_SQUARE ) {
+                hash ^= zobrist::keys.en_passant[ bitboard::file_of(ep_square) ];
+                ep_square = bitboard::NO_SQUARE;
+            }
+
+            side ^= 1;
+            hash ^= zobrist::keys.side;
+        }
+
+
+        // finds the legal move that matches the given UCI string, returns a null move if theres none.
+        Move parse_uci( const std::string& text ) const noexcept
+        {
+            MoveList list;
+            generate_legal(list);
+
+            for ( const Move& a_move : list ) {
+                if ( a_move.to_string() == text ) return a_move;
+            }
+
+            return Move();
+        }
+
+
+
+        /**
+         * @brief Writes the move in standard algebraic notation ( SAN ), e.g "Nbd2", "exd5", "O-O" or "e8=Q+".
+         * Nothing is allocated, so a whole game can be written without building strings.
+         *
+         * @param text gets the characters, it needs room for MAX_SAN_LENGTH of them. No terminating zero is written
+         * @param with_check adds the "+" or "#", which costs playing the move and looking for legal moves
+         * @return the amount of characters
+         */
+        uint32_t write_san( const Move& a_move, char* text, const bool& with_check = true ) const noexcept
+        {
+            int32_t from = a_move.from();
+            int32_t to = a_move.to();
+            uint32_t type = piece_type( squares[from] );
+            uint32_t length = 0;
+
+            auto put_square = [&]( const int32_t& square ) {
+                text[ length++ ] = static_cast<char>( 'a' + bitboard::file_of(square) );
+                text[ length++ ] = static_cast<char>( '1' + bitboard::rank_of(square) );
+            };
+
+            if ( a_move.is_castling() ) {
+                const char* castle = ( a_move.flags() == KING_SIDE_CASTLE ) ? "O-O" : "O-O-O";
+                for ( ; *castle; castle++ ) text[ length++ ] = *castle;
+            }
+
+            else if ( type == PAWN ) {
+                if ( a_move.is_capture() ) {
+                    text[ length++ ] = static_cast<char>( 'a' + bitboard::file_of(from) );
+                    text[ length++ ] = 'x';
+                }
+
+                put_square(to);
+
+                if ( a_move.is_promotion() ) {
+                    text[ length++ ] = '=';
+                    text[ length++ ] = "NBRQ"[ a_move.promotion_piece() - KNIGHT ];
+                }
+            }
+
+            else {
+                text[ length++ ] = " PNBRQK"[type];
+
+                // if another piece of the same type can move to the same square, we add its file, rank or both
+                if ( bitboard::popcount( pieces(side, type) ) > 1 ) {
+                    MoveList list;
+                    generate_legal(list);
+
+                    bool ambiguous = false, same_file = false, same_rank = false;
+
+                    for ( const Move& other : list ) {
+                        if ( other.to() != to || other.from() == from || piece_type( squares[ other.from() ] ) != type ) continue;
+
+                        ambiguous = true;
+                        same_file |= bitboard::file_of( other.from() ) == bitboard::file_of(from);
+                        same_rank |= bitboard::rank_of( other.from() ) == bitboard::rank_of(from);
+                    }
+
+                    if ( ambiguous && ( !same_file || same_rank ) ) text[ length++ ] = static_cast<char>( 'a' + bitboard::file_of(from) );
+                    if ( ambiguous && same_file ) text[ length++ ] = static_cast<char>( '1' + bitboard::rank_of(from) );
+                }
+
+                if ( a_move.is_capture() ) text[ length++ ] = 'x';
+
+                put_square(to);
+            }
+
+            if ( with_check ) {
+                Position after = *this;
+                after.play(a_move);
+
+                if ( after.in_check() ) text[ length++ ] = ( after.has_legal_moves() ) ? '+' : '#';
+            }
+
+            return length;
+        }
+
+        // returns the move in standard algebraic notation ( SAN ), e.g "Nbd2", "exd5", "O-O" or "e8=Q+".
+        std::string san( const Move& a_move ) const
+        {
+            std::array<char, MAX_SAN_LENGTH> text;
+            return std::string( text.data(), write_san( a_move, text.data() ) );
+        }
+
+
+        /**
+         * @brief Finds the legal move that matches the SAN text. The check marks and annotations like "!?" are
+         * ignored, castling can be written with zeros and the "=" of a promotion can be left out.
+         *
+         * @return the move, or a null move if no legal move or more than one matches
+         */
+        Move parse_san( std::string_view text ) const noexcept
+        {
+            while ( !text.empty() && std::strchr( "+#!?", text.back() ) ) text.remove_suffix(1);
+            if ( text.empty() ) return Move();
+
+            // only the moves that match the text are checked for legality, which is most of the work of generate_legal()
+            MoveList list;
+            generate_pseudo_legal(list);
+
+            if ( text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0" ) {
+                uint32_t flags = ( text.size() == 3 ) ? KING_SIDE_CASTLE : QUEEN_SIDE_CASTLE;
+
+                for ( const Move& a_move : list ) {
+                    if ( a_move.flags() == flags && leaves_king_safe(a_move) ) return a_move;
+                }
+
+                return Move();
+            }
+
+            uint32_t type = PAWN;
+            const char* piece_letter = std::strchr( "NBRQK", text.front() );
+
+            if ( piece_letter ) {
+                type = KNIGHT + static_cast<uint32_t>( piece_letter - "NBRQK" );
+                text.remove_prefix(1);
+            }
+
+            // the promotion is at the end, with or without the "="
+            uint32_t promotion = 0;
+
+            if ( !text.empty() && std::strchr( "NBRQ", text.back() ) ) {
+                promotion = KNIGHT + static_cast<uint32_t>( std::strchr( "NBRQ", text.back() ) - "NBRQ" );
+                text.remove_suffix(1);
+                if ( !text.empty() && text.back() == '=' ) text.remove_suffix(1);
+            }
+
+            if ( text.size() < 2 ) return Move();
+
+            int32_t to_file = text[ text.size() - 2 ] - 'a';
+            int32_t to_rank = text[ text.size() - 1 ] - '1';
+            if ( !bitboard::on_board(to_file, to_rank) ) return Move();
+
+            text.remove_suffix(2);
+
+            // what is left is the file or the rank of the moving piece, the capture sign isn't checked
+            int32_t from_file = -1;
+            int32_t from_rank = -1;
+
+            for ( const char& letter : text ) {
+                if ( letter >= 'a' && letter <= 'h' ) from_file = letter - 'a';
+                else if ( letter >= '1' && letter <= '8' ) from_rank = letter - '1';
+                else if ( letter != 'x' && letter != ':' && letter != '-' ) return Move();
+            }
+
+            int32_t to = bitboard::make_square(to_file, to_rank);
+            Move found;
+
+            for ( const Move& a_move : list ) {
+                int32_t from = a_move.from();
+
+                if ( a_move.to() != to || piece_type( squares[from] ) != type || a_move.is_castling() ) continue;
+                if ( from_file >= 0 && bitboard::file_of(from) != from_file ) continue;
+                if ( from_rank >= 0 && bitboard::rank_of(from) != from_rank ) continue;
+                if ( a_move.is_promotion() != ( promotion != 0 ) ) continue;
+                if ( promotion && a_move.promotion_piece() != promotion ) continue;
+                if ( !leaves_king_safe(a_move) ) continue;
+
+                if ( !found.is_null() ) return Move();
+                found = a_move;
+            }
+
+            return found;
+        }
+
+
+        // reads a position from a FEN string, the castling field can also use file letters ( Shredder-FEN )
+        bool set_fen( const std::string& fen )
+        {
+            std::istringstream stream(fen);
+            std::string placement, side_field, castling_field = "-", ep_field = "-";
+            uint32_t halfmoves0 = 0;
+            uint32_t fullmoves0 = 1;
+
+            if ( !( stream >> placement >> side_field ) ) return false;
+            stream >> castling_field >> ep_field >> halfmoves0 >> fullmoves0;
+
+            clear();
+
+            int32_t x = 0;
+            int32_t y = 7;
+
+            for ( const char& c : placement ) {
+                if ( c == '/' ) {
+                    x = 0;
+                    y--;
+                }
+                else if ( std::isdigit( static_cast<unsigned char>(c) ) ) {
+                    x += c - '0';
+                }
+                else {
+                    std::string letters = "pnbrqk";
+                    size_t type = letters.find( static_cast<char>( std::tolower( static_cast<unsigned char>(c) ) ) );
+
+                    if ( type == std::string::npos || !bitboard::on_board(x, y) ) return false;
+
+                    add_piece( bitboard::make_square(x, y), static_cast<uint32_t>(type) + 1, ( std::isupper( static_cast<unsigned char>(c) ) ) ? WHITE : BLACK );
+                    x++;
+                }
+            }
+
+            uint32_t rights = 0;
+
+            for ( const char& c : castling_field ) {
+                if ( c == '-' ) break;
+
+                uint32_t color = ( std::isupper( static_cast<unsigned char>(c) ) ) ? WHITE : BLACK;
+                char lower = static_cast<char>( std::tolower( static_cast<unsigned char>(c) ) );
+                int32_t king = king_square(color);
+                int32_t back_rank = ( color == WHITE ) ? 0 : 56;
+                int32_t rook = bitboard::NO_SQUARE;
+
+                if ( king == bitboard::NO_SQUARE ) continue;
+
+                // with K and Q we use the outermost rook on that side of the king
+                if ( lower == 'k' ) {
+                    for ( int32_t file = 7; file > bitboard::file_of(king) && rook == bitboard::NO_SQUARE; file-- ) {
+                        if ( squares[ back_rank + file ] == make_piece(ROOK, color) ) rook = back_rank + file;
+                    }
+                }
+                else if ( lower == 'q' ) {
+                    for ( int32_t file = 0; file < bitboard::file_of(king) && rook == bitboard::NO_SQUARE; file++ ) {
+                        if ( squares[ back_rank + file ] == make_piece(ROOK, color) ) rook = back_rank + file;
+                    }
+                }
+                else if ( lower >= 'a' && lower <= 'h' ) {
+                    rook = back_rank + ( lower - 'a' );
+                }
+
+                if ( rook == bitboard::NO_SQUARE ) continue;
+
+                uint32_t wing = ( bitboard::file_of(rook) > bitboard::file_of(king) ) ? 0 : 1;
+                castling_rooks[ color*2 + wing ] = static_cast<uint8_t>(rook);
+                rights |= 1 << ( color*2 + wing );
+            }
+
+            int32_t ep0 = -1;
+            if ( ep_field.size() == 2 ) {
+                ep0 = bitboard::make_square( ep_field[0] - 'a', ep_field[1] - '1' );
+            }
+
+            set_state( ( side_field == "b" ) ? BLACK : WHITE, rights, ep0, halfmoves0, fullmoves0 );
+
+            return king_square(WHITE) != bitboard::NO_SQUARE && king_square(BLACK) != bitboard::NO_SQUARE;
+        }
+
+
+        // returns the position as a FEN string
+        std::string fen() const
+        {
+            std::string text;
+            std::string letters = " pnbrqk";
+
+            for ( int32_t y = 7; y >= 0; y-- ) {
+                int32_t empty = 0;
+
+                for ( int32_t x = 0; x < 8; x++ ) {
+                    uint8_t piece = squares[ bitboard::make_square(x, y) ];
+
+                    if ( !piece ) {
+                        empty++;
+                        continue;
+                    }
+
+                    if ( empty ) text += std::to_string(empty);
+                    empty = 0;
+
+                    char letter = letters[ piece_type(piece) ];
+                    text += ( piece_color(piece) == WHITE ) ? static_cast<char>( std::toupper(letter) ) : letter;
+                }
+
+                if ( empty ) text += std::to_string(empty);
+                if ( y ) text += "/";
+            }
+
+            text += ( side == WHITE ) ? " w " : " b ";
+
+            constexpr std::array<uint8_t, 4> standard_rooks = { 7, 0, 63, 56 };
+            std::string castling_text;
+
+            for ( uint32_t i = 0; i < 4; i++ ) {
+                if ( !( castling & ( 1 << i ) ) ) continue;
+
+                char letter = ( castling_rooks[i] == standard_rooks[i] ) ? "kq"[i % 2] : static_cast<char>( 'a' + bitboard::file_of( castling_rooks[i] ) );
+                castling_text += ( i < 2 ) ? static_cast<char>( std::toupper(letter) ) : letter;
+            }
+
+            text += ( castling_text.empty() ) ? "-" : castling_text;
+            text += " ";
+
+            if ( ep_square == bitboard::NO_SQUARE ) text += "-";
+            else text += helper::chess_letters[ bitboard::file_of(ep_square) ] + std::to_string( bitboard::rank_of(ep_square) + 1 );
+
+            text += " " + std::to_string(halfmoves) + " " + std::to_string(fullmoves);
+
+            return text;
+        }
+
+
+        // packs the position into 32 bytes, see PackedPosition. The loop over the pieces has no branches
+        PackedPosition packed() const noexcept
+        {
+            mask occ = occupied();
+
+            mask castling_squares = 0;
+            for ( uint32_t i = 0; i < 4; i++ ) {
+                castling_squares |= ( mask(0) - ( ( castling >> i ) & 1 ) ) & bitboard::square_bit( castling_rooks[i] ) & by_color[ i >> 1 ];
+            }
+            castling_squares &= by_type[ROOK];
+
+            std::array<uint64_t, 2> nibbles = { 0, 0 };
+            mask pieces_left = occ;
+
+            for ( uint32_t i = 0; pieces_left; i++ ) {
+                int32_t square = bitboard::pop_lsb(pieces_left);
+                uint64_t nibble = squares[square] | ( ( ( castling_squares >> square ) & 1 ) * 3 ); // a rook ( 4 ) becomes 7
+                nibbles[ ( i >> 4 ) & 1 ] |= nibble << ( 4 * ( i & 15 ) );
+            }
+
+            uint32_t ep_bits = ( ep_square == bitboard::NO_SQUARE ) ? 0 : 16 | ( bitboard::file_of(ep_square) << 1 );
+
+            PackedPosition result;
+            for ( uint32_t i = 0; i < 8; i++ ) {
+                result.bytes[i] = static_cast<uint8_t>( occ >> ( 8*i ) );
+                result.bytes[8 + i] = static_cast<uint8_t>( nibbles[0] >> ( 8*i ) );
+                result.bytes[16 + i] = static_cast<uint8_t>( nibbles[1] >> ( 8*i ) );
+            }
+
+            result.bytes[24] = static_cast<uint8_t>( side | ep_bits );
+            result.bytes[25] = halfmoves;
+            result.bytes[26] = static_cast<uint8_t>( fullmoves & 0xFF );
+            result.bytes[27] = static_cast<uint8_t>( fullmoves >> 8 );
+
+            return result;
+        }
+
+        /**
+         * @brief Reads a packed position straight into the bitboards, the castling rooks and the hash.
+         * The position has the same hash as the one that was packed.
+         *
+         * @return false if the bytes aren't a packing that packed() can make of a position with one king per side,
+         * castling rooks and kings on their back rank and no pawns on the first or last rank. The position is cleared then
+         */
+        bool set_packed( const PackedPosition& packed ) noexcept
+        {
+            clear();
+
+            mask occ = 0;
+            std::array<uint64_t, 2> nibbles = { 0, 0 };
+
+            for ( uint32_t i = 0; i < 8; i++ ) {
+                occ |= static_cast<mask>( packed.bytes[i] ) << ( 8*i );
+                nibbles[0] |= static_cast<uint64_t>( packed.bytes[8 + i] ) << ( 8*i );
+                nibbles[1] |= static_cast<uint64_t>( packed.bytes[16 + i] ) << ( 8*i );
+            }
+
+            uint32_t count = static_cast<uint32_t>( bitboard::popcount(occ) );
+            uint32_t state = packed.bytes[24];
+            bool valid = count <= 32 && ( state >> 5 ) == 0 && ( state & 16 || ( state & 14 ) == 0 ) &&
+                         ( packed.bytes[26] | packed.bytes[27] ) != 0 &&
+                         packed.bytes[28] == 0 && packed.bytes[29] == 0 && packed.bytes[30] == 0 && packed.bytes[31] == 0;
+
+            // the nibbles after the last piece have to be zero, so every position has a single packing
+            if ( count < 32 ) {
+                uint32_t shift = 4 * ( count & 15 );
+                mask rest_low = ( count < 16 ) ? ( ( shift ) ? nibbles[0] >> shift : nibbles[0] ) : 0;
+                mask rest_high = ( count < 16 ) ? nibbles[1] : ( ( shift ) ? nibbles[1] >> shift : nibbles[1] );
+                valid = valid && rest_low == 0 && rest_high == 0;
+            }
+
+            if ( !valid ) return false;
+
+            // each side needs exactly one king and no pawn may stand on the first or the last rank
+            mask back_ranks = 0xFF000000000000FFULL;
+            mask castling_squares = 0;
+            mask pieces_left = occ;
+
+            for ( uint32_t i = 0; pieces_left; i++ ) {
+                int32_t square = bitboard::pop_lsb(pieces_left);
+                uint8_t nibble = static_cast<uint8_t>( ( nibbles[ ( i >> 4 ) & 1 ] >> ( 4 * ( i & 15 ) ) ) & 15 );
+                uint8_t castling_rook = ( nibble & 7 ) == 7;
+
+                valid = valid && ( nibble & 7 ) != 0;
+                castling_squares |= static_cast<mask>(castling_rook) << square;
+                put_piece( square, static_cast<uint8_t>( nibble ^ ( castling_rook * 3 ) ) );
+            }
+
+            valid = valid && bitboard::popcount( pieces(WHITE, KING) ) == 1 && bitboard::popcount( pieces(BLACK, KING) ) == 1 &&
+                    !( by_type[PAWN] & back_ranks );
+
+            // the wing of a castling rook is the side of its king that it stands on, both have to be on their back rank
+            uint32_t rights = 0;
+
+            while ( castling_squares && valid ) {
+                int32_t rook = bitboard::pop_lsb(castling_squares);
+                uint32_t color = piece_color( squares[rook] );
+                int32_t king = king_square(color);
+                int32_t back_rank = ( color == WHITE ) ? 0 : 7;
+                uint32_t wing = ( bitboard::file_of(rook) < bitboard::file_of(king) ) ? 1 : 0;
+
+                valid = bitboard::rank_of(rook) == back_rank && bitboard::rank_of(king) == back_rank && !( rights & ( 1 << ( color*2 + wing ) ) );
+                rights |= 1 << ( color*2 + wing );
+                castling_rooks[ color*2 + wing ] = static_cast<uint8_t>(rook);
+            }
+
+            if ( !valid ) {
+                clear();
+                return false;
+            }
+
+            uint32_t side0 = state & 1;
+            int32_t ep = ( state & 16 ) ? bitboard::make_square( ( state >> 1 ) & 7, ( side0 == WHITE ) ? 5 : 2 ) : -1;
+
+            set_state( side0, rights, ep, packed.bytes[25], packed.bytes[26] | ( packed.bytes[27] << 8 ) );
+
+            // set_state() only keeps an en passant square that can be captured
+            if ( ( ep >= 0 ) != ( ep_square != bitboard::NO_SQUARE ) ) {
+                clear();
+                return false;
+            }
+
+            return true;
+        }
+
+};
+
+
+#endif
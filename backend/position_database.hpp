@@ -0,0 +1,685 @@
+#ifndef POSITION_DATABASE
+#define POSITION_DATABASE
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <atomic>
+#include <queue>
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#include "helper_tools.hpp"
+#include "position.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include "pgn.hpp"
+#include "game_archive.hpp"
+
+
+/*
+ A database of every position of many games, it tells how often a position was reached, how the games went on
+ and which moves were played in it.
+
+ A database is a main file and a few segment files next to it, named path.0, path.1 and so on, every file with
+ a number is a segment even if the numbers have gaps. New games are collected in memory and written as a new
+ segment when the buffer is full, so adding games never rewrites the data that is already on disk. compact() merges the segments into the main file.
+
+ Every file is a 32 byte header, the entries sorted by key and move, and a table with the first entry of every
+ bucket of keys. A lookup reads the table and binary searches a bucket of a few dozen entries, so it touches a
+ couple of pages of the mapped file. All numbers are little endian.
+*/
+namespace position_db
+{
+
+constexpr std::array<char, 4> file_magic = { 'C', 'P', 'D', '1' };
+constexpr uint32_t HEADER_SIZE = 32;
+constexpr uint32_t ENTRY_SIZE = 26; // key, move, occurrences, white wins, draws and black wins
+constexpr uint32_t MAX_MOVES = 256;
+constexpr uint32_t MIN_BUCKET_BITS = 4;
+constexpr uint32_t MAX_BUCKET_BITS = 24;
+
+// the counts of an entry stop at the largest 32 bit number instead of wrapping around
+inline uint32_t add_saturated( const uint32_t& a, const uint32_t& b ) noexcept
+{
+    uint64_t sum = static_cast<uint64_t>(a) + b;
+    return static_cast<uint32_t>( std::min<uint64_t>( sum, UINT32_MAX ) );
+}
+
+// about 32 entries per bucket
+inline uint32_t bucket_bits_for( const uint64_t& entries ) noexcept
+{
+    uint32_t bits = MIN_BUCKET_BITS;
+    while ( bits < MAX_BUCKET_BITS && ( entries >> ( bits + 5 ) ) > 0 ) bits++;
+    return bits;
+}
+
+inline std::string segment_path( const std::string& path, const uint32_t& number )
+{
+    return path + "." + std::to_string(number);
+}
+
+inline bool file_exists( const std::string& path )
+{
+    std::ifstream stream( path, std::ios::binary );
+    return static_cast<bool>(stream);
+}
+
+// the paths of every segment of a database sorted by their numbers, a missing number doesn't hide the later ones
+inline std::vector<std::string> segment_paths( const std::string& path )
+{
+    std::filesystem::path main_path(path);
+    std::string prefix = main_path.filename().string() + ".";
+    std::filesystem::path directory = main_path.has_parent_path() ? main_path.parent_path() : std::filesystem::path(".");
+
+    std::vector<uint32_t> numbers;
+    std::error_code error;
+    for ( std::filesystem::directory_iterator it( directory, error ), end; !error && it != end; it.increment(error) ) {
+        std::string name = it->path().filename().string();
+        if ( name.size() <= prefix.size() || name.size() > prefix.size() + 9 || name.compare( 0, prefix.size(), prefix ) != 0 ) continue;
+
+        std::string digits = name.substr( prefix.size() );
+        if ( !std::all_of( digits.begin(), digits.end(), []( char c ) { return c >= '0' && c <= '9'; } ) ) continue;
+        numbers.push_back( static_cast<uint32_t>( std::stoul(digits) ) );
+    }
+
+    std::sort( numbers.begin(), numbers.end() );
+
+    std::vector<std::string> paths;
+    for ( const uint32_t& number : numbers ) paths.push_back( segment_path( path, number ) );
+    return paths;
+}
+
+inline uint32_t read_u32( const uint8_t* bytes ) noexcept
+{
+    return static_cast<uint32_t>( bytes[0] ) | ( static_cast<uint32_t>( bytes[1] ) << 8 ) |
+           ( static_cast<uint32_t>( bytes[2] ) << 16 ) | ( static_cast<uint32_t>( bytes[3] ) << 24 );
+}
+
+inline void put_u16( uint8_t* bytes, const uint32_t& value ) noexcept
+{
+    bytes[0] = static_cast<uint8_t>( value & 0xFF );
+    bytes[1] = static_cast<uint8_t>( value >> 8 );
+}
+
+inline void put_u32( uint8_t* bytes, const uint32_t& value ) noexcept
+{
+    for ( uint32_t i = 0; i < 4; i++ ) bytes[i] = static_cast<uint8_t>( ( value >> ( 8*i ) ) & 0xFF );
+}
+
+inline void put_u64( uint8_t* bytes, const uint64_t& value ) noexcept
+{
+    for ( uint32_t i = 0; i < 8; i++ ) bytes[i] = static_cast<uint8_t>( ( value >> ( 8*i ) ) & 0xFF );
+}
+
+}
+
+
+
+// how often a position was reached, or a move was played in it, and how the games went on. Every time counts, also
+// a position that is repeated inside one game. Games without a result count only in the occurrences
+struct PositionStats
+{
+    uint32_t occurrences = 0;
+    uint32_t white_wins = 0;
+    uint32_t draws = 0;
+    uint32_t black_wins = 0;
+
+    PositionStats& operator += ( const PositionStats& other ) noexcept
+    {
+        occurrences = position_db::add_saturated( occurrences, other.occurrences );
+        white_wins = position_db::add_saturated( white_wins, other.white_wins );
+        draws = position_db::add_saturated( draws, other.draws );
+        black_wins = position_db::add_saturated( black_wins, other.black_wins );
+        return *this;
+    }
+
+    // the score of white from 0 to 1 over the occurrences that have a result, 0.5 if there are none
+    double white_score() const noexcept
+    {
+        uint64_t decided = static_cast<uint64_t>(white_wins) + draws + black_wins;
+        return ( decided ) ? ( white_wins + 0.5 * draws ) / static_cast<double>(decided) : 0.5;
+    }
+};
+
+// a move that was played in a position, a null move stands for the games that ended in the position
+struct PositionMove
+{
+    Move move;
+    PositionStats stats;
+};
+
+
+namespace position_db
+{
+
+struct Entry
+{
+    uint64_t key = 0;
+    uint16_t move = 0;
+    PositionStats stats;
+};
+
+inline bool entry_before( const Entry& a, const Entry& b ) noexcept
+{
+    return ( a.key != b.key ) ? a.key < b.key : a.move < b.move;
+}
+
+inline Entry read_entry( const uint8_t* bytes ) noexcept
+{
+    Entry entry;
+    entry.key = archive::read_u64(bytes);
+    entry.move = static_cast<uint16_t>( bytes[8] | ( bytes[9] << 8 ) );
+    entry.stats.occurrences = read_u32( bytes + 10 );
+    entry.stats.white_wins = read_u32( bytes + 14 );
+    entry.stats.draws = read_u32( bytes + 18 );
+    entry.stats.black_wins = read_u32( bytes + 22 );
+    return entry;
+}
+
+
+/*
+ Writes a database file from entries that come in sorted order, the bucket table is filled while the entries
+ are written and the header is written last. The file is written under a temporary name and renamed to its
+ destination when it's complete, so a reader never maps half a file.
+*/
+class SortedFileWriter
+{
+    private:
+        std::ofstream stream;
+        std::string path;
+        std::vector<uint8_t> buffer;
+        std::vector<uint64_t> buckets;
+        uint32_t bits = MIN_BUCKET_BITS;
+        uint32_t next_bucket = 0;
+        uint64_t count = 0;
+        bool has_last = false;
+        Entry last;
+
+        void write_last()
+        {
+            uint32_t bucket = static_cast<uint32_t>( last.key >> ( 64 - bits ) );
+            while ( next_bucket <= bucket ) buckets[ next_bucket++ ] = count;
+
+            buffer.resize( buffer.size() + ENTRY_SIZE );
+            uint8_t* bytes = buffer.data() + buffer.size() - ENTRY_SIZE;
+
+            put_u64( bytes, last.key );
+            put_u16( bytes + 8, last.move );
+            put_u32( bytes + 10, last.stats.occurrences );
+            put_u32( bytes + 14, last.stats.white_wins );
+            put_u32( bytes + 18, last.stats.draws );
+            put_u32( bytes + 22, last.stats.black_wins );
+            count++;
+
+            if ( buffer.size() >= ( 1 << 20 ) ) {
+                stream.write( reinterpret_cast<const char*>( buffer.data() ), static_cast<std::streamsize>( buffer.size() ) );
+                buffer.clear();
+            }
+        }
+
+
+    public:
+        // the expected count only sets the size of the bucket table, it may be larger than the real count
+        bool open( const std::string& temporary_path, const uint64_t& expected_count )
+        {
+            path = temporary_path;
+            bits = bucket_bits_for(expected_count);
+            buckets.assign( ( size_t(1) << bits ) + 1, 0 );
+            next_bucket = 0;
+            count = 0;
+            has_last = false;
+            buffer.clear();
+
+            stream.open( path, std::ios::binary | std::ios::trunc );
+            std::vector<char> header( HEADER_SIZE, 0 );
+            stream.write( header.data(), HEADER_SIZE );
+            return static_cast<bool>(stream);
+        }
+
+        // adds an entry, entries with the same key and move are added up
+        void add( const Entry& entry )
+        {
+            if ( has_last && entry.key == last.key && entry.move == last.move ) {
+                last.stats += entry.stats;
+                return;
+            }
+
+            if ( has_last ) write_last();
+            last = entry;
+            has_last = true;
+        }
+
+        // writes the table and the header, the file is removed if it couldn't be written
+        bool finish( const uint64_t& games )
+        {
+            if ( has_last ) write_last();
+            has_last = false;
+
+            while ( next_bucket < buckets.size() ) buckets[ next_bucket++ ] = count;
+
+            size_t table_begin = buffer.size();
+            buffer.resize( table_begin + buckets.size() * 8 );
+            for ( size_t i = 0; i < buckets.size(); i++ ) put_u64( buffer.data() + table_begin + i * 8, buckets[i] );
+
+            stream.write( reinterpret_cast<const char*>( buffer.data() ), static_cast<std::streamsize>( buffer.size() ) );
+            buffer.clear();
+
+            std::array<uint8_t, HEADER_SIZE> header{};
+            std::copy( file_magic.begin(), file_magic.end(), header.begin() );
+            put_u32( header.data() + 4, bits );
+            put_u64( header.data() + 8, count );
+            put_u64( header.data() + 16, games );
+
+            stream.seekp(0);
+            stream.write( reinterpret_cast<const char*>( header.data() ), HEADER_SIZE );
+            stream.close();
+
+            if ( !stream ) {
+                std::remove( path.c_str() );
+                return false;
+            }
+
+            return true;
+        }
+
+        // moves the finished file into its place
+        bool move_to( const std::string& destination )
+        {
+            // renaming over an existing file fails on Windows
+            std::remove( destination.c_str() );
+            if ( std::rename( path.c_str(), destination.c_str() ) == 0 ) return true;
+
+            std::remove( path.c_str() );
+            return false;
+        }
+};
+
+
+/*
+ A mapped database file. The bucket table isn't checked when the file is opened, a damaged table only makes
+ lookups miss because the bounds that are read from it are clamped to the entries.
+*/
+class SortedFile
+{
+    private:
+        MappedFile file;
+        uint64_t count = 0;
+        uint64_t games = 0;
+        uint32_t bits = MIN_BUCKET_BITS;
+        const uint8_t* entries = nullptr;
+        const uint8_t* table = nullptr;
+
+        inline uint64_t key_at( const uint64_t& index ) const noexcept { return archive::read_u64( entries + index * ENTRY_SIZE ); }
+
+
+    public:
+        bool open( const std::string& path )
+        {
+            count = 0;
+            entries = nullptr;
+            table = nullptr;
+
+            if ( !file.open(path) || file.size() < HEADER_SIZE ) return false;
+
+            const uint8_t* header = file.data();
+            if ( !std::equal( file_magic.begin(), file_magic.end(), header ) ) return false;
+
+            uint32_t bits0 = read_u32( header + 4 );
+            uint64_t count0 = archive::read_u64( header + 8 );
+            if ( bits0 < MIN_BUCKET_BITS || bits0 > MAX_BUCKET_BITS || count0 > file.size() / ENTRY_SIZE ) return false;
+
+            uint64_t table_size = ( ( uint64_t(1) << bits0 ) + 1 ) * 8;
+            if ( file.size() != HEADER_SIZE + count0 * ENTRY_SIZE + table_size ) return false;
+
+            bits = bits0;
+            count = count0;
+            games = archive::read_u64( header + 16 );
+            entries = file.data() + HEADER_SIZE;
+            table = entries + count * ENTRY_SIZE;
+            return true;
+        }
+
+        // the index of the first entry of the key, or the end of its bucket if the key isn't there
+        uint64_t find( const uint64_t& key ) const noexcept
+        {
+            uint64_t bucket = key >> ( 64 - bits );
+            uint64_t low = std::min( archive::read_u64( table + bucket * 8 ), count );
+            uint64_t high = std::min( std::max( archive::read_u64( table + bucket * 8 + 8 ), low ), count );
+
+            // the keys are hashes, so they are spread evenly over the bucket and the place of the key in it is a
+            // good guess. We walk from the guess to the first entry that isn't below the key, it's a few entries away
+            uint64_t span = std::min<uint64_t>( high - low, UINT32_MAX );
+            uint64_t guess = low + ( ( ( key << bits ) >> 32 ) * span >> 32 );
+
+            while ( guess > low && key_at( guess - 1 ) >= key ) guess--;
+            while ( guess < high && key_at(guess) < key ) guess++;
+
+            return guess;
+        }
+
+        inline Entry entry_at( const uint64_t& index ) const noexcept { return read_entry( entries + index * ENTRY_SIZE ); }
+        inline bool has_key( const uint64_t& index, const uint64_t& key ) const noexcept { return index < count && key_at(index) == key; }
+
+        inline bool is_open() const noexcept { return entries != nullptr; }
+        inline uint64_t size() const noexcept { return count; }
+        inline uint64_t game_count() const noexcept { return games; }
+};
+
+}
+
+
+
+/*
+ Adds games to a database, every worker of a thread pool has its own buffer so the games can be added from many
+ threads at once. Every position of a game is counted with the move that was played in it and the result of the
+ game, the last position is counted with a null move.
+
+ Only one writer may add segments to a database at a time.
+*/
+class PositionDatabaseWriter
+{
+    private:
+        struct Occurrence
+        {
+            uint64_t key;
+            uint16_t move;
+            uint8_t result; // the codes of archive::result_code()
+        };
+
+        struct alignas(64) WorkerBuffer
+        {
+            std::vector<Occurrence> occurrences;
+            uint64_t games = 0;
+        };
+
+        std::string path;
+        std::vector<WorkerBuffer> buffers;
+        size_t buffer_size;
+        std::atomic<uint32_t> next_segment{0};
+        std::atomic<bool> failed{false};
+
+
+    public:
+        /**
+         * @param workers how many threads add games at once, add_games() adds the ones that its pool needs
+         * @param buffer_size how many positions a worker collects before they are written as a segment
+         */
+        explicit PositionDatabaseWriter( const std::string& path0, const size_t& workers = 1, const size_t& buffer_size0 = size_t(1) << 22 )
+            : path(path0), buffers( std::max<size_t>( workers, 1 ) ), buffer_size( std::max<size_t>( buffer_size0, 1024 ) )
+        {
+            std::vector<std::string> segments = position_db::segment_paths(path);
+            next_segment = segments.empty() ? 0 : static_cast<uint32_t>( std::stoul( segments.back().substr( path.size() + 1 ) ) ) + 1;
+        }
+
+        ~PositionDatabaseWriter() { finish(); }
+
+        PositionDatabaseWriter( const PositionDatabaseWriter& ) = delete;
+        PositionDatabaseWriter& operator = ( const PositionDatabaseWriter& ) = delete;
+
+
+        /**
+         * @brief Counts the positions of a game, the moves must be legal from the start position.
+         * @return false if the worker has no buffer or a full buffer couldn't be written
+         */
+        bool add( const size_t& worker, const Position& start, helper::span<const Move> moves, const std::string_view& result )
+        {
+            if ( worker >= buffers.size() ) return false;
+
+            WorkerBuffer& buffer = buffers[worker];
+            uint8_t code = archive::result_code(result);
+            Position pos = start;
+
+            for ( const Move& a_move : moves ) {
+                buffer.occurrences.push_back( Occurrence{ pos.key(), a_move.data, code } );
+                pos.play(a_move);
+            }
+
+            buffer.occurrences.push_back( Occurrence{ pos.key(), 0, code } );
+            buffer.games++;
+
+            return ( buffer.occurrences.size() >= buffer_size ) ? flush(worker) : true;
+        }
+
+        // games that couldn't be read completely are left out, their last position isn't where they ended
+        bool add( const size_t& worker, const PgnGame& game )
+        {
+            if ( !game.valid ) return true;
+            return add( worker, game.start, helper::span<const Move>( game.moves.data(), game.moves.size() ), game.result );
+        }
+
+        /**
+         * @brief Adds every game of a PgnReader or a GameArchive with the threads of the pool and writes
+         * the rest of the buffers. The writer gets a buffer for every thread of the pool that it doesn't have yet.
+         */
+        template<typename Reader>
+        PgnStats add_games( ThreadPool& pool, const Reader& reader )
+        {
+            if ( buffers.size() < pool.size() ) buffers.resize( pool.size() );
+
+            PgnStats stats = reader.read_parallel( pool, [&]( size_t worker, const PgnGame& game ) { add(worker, game); } );
+            finish();
+            return stats;
+        }
+
+
+        // sorts the buffer of the worker and writes it as a new segment
+        bool flush( const size_t& worker )
+        {
+            if ( worker >= buffers.size() ) return false;
+
+            WorkerBuffer& buffer = buffers[worker];
+            if ( buffer.occurrences.empty() && buffer.games == 0 ) return true;
+
+            std::sort( buffer.occurrences.begin(), buffer.occurrences.end(), []( const Occurrence& a, const Occurrence& b ) {
+                return ( a.key != b.key ) ? a.key < b.key : a.move < b.move;
+            } );
+
+            // the segment gets its number once it's written, a failed write doesn't leave a gap
+            std::string temporary = path + ".worker" + std::to_string(worker) + ".tmp";
+            position_db::SortedFileWriter writer;
+            bool written = writer.open( temporary, buffer.occurrences.size() );
+
+            for ( const Occurrence& occurrence : buffer.occurrences ) {
+                position_db::Entry entry;
+                entry.key = occurrence.key;
+                entry.move = occurrence.move;
+                entry.stats.occurrences = 1;
+                entry.stats.white_wins = occurrence.result == 1;
+                entry.stats.black_wins = occurrence.result == 2;
+                entry.stats.draws = occurrence.result == 3;
+                writer.add(entry);
+            }
+
+            written = writer.finish(buffer.games) && written;
+            if ( written ) written = writer.move_to( position_db::segment_path( path, next_segment++ ) );
+
+            buffer.occurrences.clear();
+            buffer.games = 0;
+
+            if ( !written ) failed = true;
+            return written;
+        }
+
+        // writes the buffers of every worker, returns false if any segment of this writer couldn't be written
+        bool finish()
+        {
+            for ( size_t i = 0; i < buffers.size(); i++ ) flush(i);
+            return !failed;
+        }
+
+
+        /**
+         * @brief Merges the main file and every segment of the database into a new main file and removes the segments.
+         * The files are read through their mappings, so merging doesn't need memory for the entries.
+         *
+         * @return false if a file is damaged or the new file couldn't be written, the old files are kept then
+         */
+        static bool compact( const std::string& path )
+        {
+            std::vector<position_db::SortedFile> sources;
+            std::vector<std::string> segments = position_db::segment_paths(path);
+            uint64_t expected = 0;
+            uint64_t games = 0;
+
+            std::vector<std::string> names = segments;
+            if ( position_db::file_exists(path) ) names.push_back(path);
+
+            for ( const std::string& name : names ) {
+                sources.emplace_back();
+                if ( !sources.back().open(name) ) return false;
+
+                expected += sources.back().size();
+                games += sources.back().game_count();
+            }
+
+            if ( segments.empty() ) return true;
+
+            // the next entry of every source, the smallest on top
+            using Cursor = std::pair<position_db::Entry, size_t>;
+            auto later = []( const Cursor& a, const Cursor& b ) { return position_db::entry_before( b.first, a.first ); };
+            std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heads(later);
+            std::vector<uint64_t> positions( sources.size(), 0 );
+
+            for ( size_t i = 0; i < sources.size(); i++ ) {
+                if ( sources[i].size() > 0 ) heads.push( Cursor{ sources[i].entry_at(0), i } );
+            }
+
+            position_db::SortedFileWriter writer;
+            if ( !writer.open( path + ".tmp", expected ) ) return false;
+
+            while ( !heads.empty() ) {
+                Cursor head = heads.top();
+                heads.pop();
+                writer.add(head.first);
+
+                size_t source = head.second;
+                if ( ++positions[source] < sources[source].size() ) heads.push( Cursor{ sources[source].entry_at( positions[source] ), source } );
+            }
+
+            // the mappings go before the files are replaced
+            sources.clear();
+            if ( !writer.finish(games) || !writer.move_to(path) ) return false;
+
+            for ( const std::string& segment : segments ) std::remove( segment.c_str() );
+            return true;
+        }
+};
+
+
+
+/*
+ Answers how often a position was reached and how the games went on from it. The main file and the segments are
+ mapped, a lookup binary searches a bucket of every file and adds up what it finds.
+ Lookups don't allocate and can be done from many threads at once.
+*/
+class PositionDatabase
+{
+    private:
+        std::vector<position_db::SortedFile> files;
+        uint64_t games = 0;
+        uint64_t entries = 0;
+
+
+    public:
+        PositionDatabase() { }
+
+        explicit PositionDatabase( const std::string& path ) { load(path); }
+
+        /**
+         * @brief Maps the main file and the segments of the database, loading again picks up new segments.
+         * @return false if no file could be opened or one of them is damaged
+         */
+        bool load( const std::string& path )
+        {
+            files.clear();
+            games = 0;
+            entries = 0;
+
+            std::vector<std::string> names;
+            if ( position_db::file_exists(path) ) names.push_back(path);
+
+            for ( const std::string& segment : position_db::segment_paths(path) ) names.push_back(segment);
+
+            for ( const std::string& name : names ) {
+                files.emplace_back();
+
+                if ( !files.back().open(name) ) {
+                    files.clear();
+                    games = 0;
+                    entries = 0;
+                    return false;
+                }
+
+                games += files.back().game_count();
+                entries += files.back().size();
+            }
+
+            return !files.empty();
+        }
+
+        // adds up every time the position was reached, a different position with the same key is counted as well
+        PositionStats probe( const Position& pos ) const noexcept
+        {
+            PositionStats stats;
+            uint64_t key = pos.key();
+
+            for ( const position_db::SortedFile& file : files ) {
+                for ( uint64_t i = file.find(key); file.has_key(i, key); i++ ) stats += file.entry_at(i).stats;
+            }
+
+            return stats;
+        }
+
+        /**
+         * @brief Finds the moves that were played in the position, moves that aren't legal in it are left out.
+         *
+         * @param moves gets the moves, the most played first. A null move counts the games that ended in the position
+         * @return how many moves were found
+         */
+        uint32_t probe_moves( const Position& pos, std::array<PositionMove, position_db::MAX_MOVES>& moves ) const noexcept
+        {
+            MoveList legal;
+            pos.generate_legal(legal);
+
+            uint64_t key = pos.key();
+            uint32_t found = 0;
+
+            for ( const position_db::SortedFile& file : files ) {
+                for ( uint64_t i = file.find(key); file.has_key(i, key); i++ ) {
+                    position_db::Entry entry = file.entry_at(i);
+                    Move a_move( entry.move );
+                    if ( !a_move.is_null() && !legal.contains(a_move) ) continue;
+
+                    uint32_t index = 0;
+                    while ( index < found && moves[index].move.data != entry.move ) index++;
+
+                    if ( index == found ) {
+                        if ( found == position_db::MAX_MOVES ) continue;
+                        moves[ found++ ] = PositionMove{ a_move, PositionStats() };
+                    }
+
+                    moves[index].stats += entry.stats;
+                }
+            }
+
+            std::sort( moves.begin(), moves.begin() + found, []( const PositionMove& a, const PositionMove& b ) {
+                if ( a.stats.occurrences != b.stats.occurrences ) return a.stats.occurrences > b.stats.occurrences;
+                return a.move.data < b.move.data;
+            } );
+
+            return found;
+        }
+
+        inline bool is_open() const noexcept { return !files.empty(); }
+        inline size_t file_count() const noexcept { return files.size(); }
+        inline uint64_t game_count() const noexcept { return games; }
+        inline uint64_t size() const noexcept { return entries; }
+};
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef SEARCH
+#define SEARCH
+
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <cstdlib>
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+#include "evaluation.hpp"
+#include "opening_book.hpp"
+
+
+constexpr int32_t MATE_SCORE = 32000;
+constexpr int32_t MAX_PLY = 128;
+
+
+// tells the search when to stop, a value of 0 means that the limit isn't used.
+// If both are 0, the search only returns the quiescence score of the position.
+struct SearchLimit
+{
+    int32_t depth = 0;
+    uint64_t nodes = 0;
+};
+
+
+struct SearchResult
+{
+    int32_t score = 0;
+    Move best_move;
+    uint64_t nodes = 0;
+    int32_t depth = 0; // the deepest iteration that was fully completed
+    bool from_book = false; // the move came from the opening book and nothing was searched
+};
+
+
+
+/*
+ A simple alpha-beta searcher that works on Position. Every Searcher has its own state,
+ so we can give each thread its own Searcher and run them at the same time.
+*/
+class Searcher
+{
+    private:
+        uint64_t nodes = 0;
+        uint64_t node_limit = 0;
+        bool stopped = false;
+
+        // the hashes of the positions on the current search path, used to find repetitions
+        std::array<uint64_t, MAX_PLY + 1> path{};
+
+        // the pawn structures that this searcher has seen, it's kept between searches
+        PawnTable pawn_table;
+
+        // the book is asked before every search, the random state chooses between its moves
+        const OpeningBook* opening_book = nullptr;
+        uint64_t book_random = 0x5851F42D4C957F2DULL;
+
+
+        inline bool out_of_nodes() noexcept
+        {
+            if ( node_limit && nodes >= node_limit ) stopped = true;
+            return stopped;
+        }
+
+
+        // captures that don't lose material are searched first, the most valuable victim with the least valuable attacker first.
+        // Captures that lose material in the static exchange are searched after the quiet moves.
+        static inline int32_t move_order_score( const Position& pos, const Move& a_move ) noexcept
+        {
+            int32_t score = 0;
+
+            if ( a_move.is_capture() ) {
+                int32_t exchange = evaluation::see(pos, a_move);
+
+                if ( exchange < 0 ) score += exchange;
+                else {
+                    uint32_t victim = ( a_move.is_en_passant() ) ? static_cast<uint32_t>(PAWN) : piece_type( pos.piece_on( a_move.to() ) );
+                    score += 10*evaluation::piece_values[victim] - evaluation::piece_values[ piece_type( pos.piece_on( a_move.from() ) ) ] + 10000;
+                }
+            }
+
+            if ( a_move.is_promotion() ) {
+                score += evaluation::piece_values[ a_move.promotion_piece() ];
+            }
+
+            return score;
+        }
+
+        static void order_moves( const Position& pos, MoveList& list, const Move& first ) noexcept
+        {
+            std::array<int32_t, 256> scores;
+
+            for ( uint32_t i = 0; i < list.size(); i++ ) {
+                scores[i] = ( list[i] == first ) ? 1000000 : move_order_score( pos, list[i] );
+            }
+
+            // insertion sort, the lists are short so this is faster than std::sort
+            for ( uint32_t i = 1; i < list.size(); i++ ) {
+                Move a_move = list[i];
+                int32_t score = scores[i];
+                uint32_t j = i;
+
+                for ( ; j > 0 && scores[j-1] < score; j-- ) {
+                    list[j] = list[j-1];
+                    scores[j] = scores[j-1];
+                }
+
+                list[j] = a_move;
+                scores[j] = score;
+            }
+        }
+
+
+        int32_t quiescence( const Position& pos, int32_t alpha, int32_t beta, int32_t ply ) noexcept
+        {
+            nodes++;
+
+            int32_t stand_pat = evaluation::evaluate(pos, pawn_table);
+
+            if ( ply >= MAX_PLY ) return stand_pat;
+            if ( stand_pat >= beta ) return stand_pat;
+            alpha = std::max(alpha, stand_pat);
+
+            MoveList list;
+            pos.generate_pseudo_legal(list);
+            order_moves( pos, list, Move() );
+
+            for ( const Move& a_move : list ) {
+                if ( !a_move.is_capture() && !a_move.is_promotion() ) continue;
+
+                // a capture that loses material in the static exchange can't raise alpha, so it isn't searched
+                if ( a_move.is_capture() && !a_move.is_promotion() && !evaluation::see_ge(pos, a_move, 0) ) continue;
+                if ( !pos.leaves_king_safe(a_move) ) continue;
+
+                Position next = pos;
+                next.play(a_move);
+
+                int32_t score = -quiescence( next, -beta, -alpha, ply + 1 );
+
+                if ( score >= beta ) return score;
+                alpha = std::max(alpha, score);
+            }
+
+            return alpha;
+        }
+
+
+        int32_t alpha_beta( const Position& pos, int32_t depth, int32_t alpha, int32_t beta, int32_t ply, Move& best ) noexcept
+        {
+            if ( depth <= 0 || ply >= MAX_PLY ) return quiescence( pos, alpha, beta, ply );
+
+            nodes++;
+            path[ply] = pos.key();
+
+            if ( ply > 0 ) {
+                if ( pos.halfmove_clock() >= 100 ) return 0;
+
+                // a repetition inside the search is scored as a draw
+                for ( int32_t i = ply - 2; i >= 0 && i >= ply - static_cast<int32_t>( pos.halfmove_clock() ); i -= 2 ) {
+                    if ( path[i] == pos.key() ) return 0;
+                }
+            }
+
+            MoveList list;
+            pos.generate_legal(list);
+
+            if ( list.empty() ) {
+                return ( pos.in_check() ) ? -MATE_SCORE + ply : 0;
+            }
+
+            order_moves( pos, list, best );
+
+            int32_t best_score = -MATE_SCORE;
+            Move child_best;
+
+            for ( const Move& a_move : list ) {
+                Position next = pos;
+                next.play(a_move);
+
+                child_best = Move();
+                int32_t score = -alpha_beta( next, depth - 1, -beta, -alpha, ply + 1, child_best );
+
+                if ( out_of_nodes() ) return best_score;
+
+                if ( score > best_score ) {
+                    best_score = score;
+                    best = a_move;
+                }
+
+                alpha = std::max(alpha, score);
+                if ( alpha >= beta ) break;
+            }
+
+            return best_score;
+        }
+
+
+    public:
+        uint64_t searched_nodes() const noexcept { return nodes; }
+        const PawnTable& pawn_cache() const noexcept { return pawn_table; }
+
+        // the book isn't owned, it has to live as long as the searcher uses it. A nullptr turns the book off
+        void set_book( const OpeningBook* book0 ) noexcept { opening_book = book0; }
+
+        // searches the position with iterative deepening until the depth or the node limit is reached.
+        SearchResult search( const Position& root, const SearchLimit& limit ) noexcept
+        {
+            SearchResult result;
+
+            nodes = 0;
+            node_limit = limit.nodes;
+            stopped = false;
+
+            if ( opening_book ) {
+                result.best_move = opening_book->pick( root, zobrist::next_key(book_random) );
+                result.from_book = !result.best_move.is_null();
+                if ( result.from_book ) return result;
+            }
+
+            if ( limit.depth <= 0 && limit.nodes == 0 ) {
+                result.score = quiescence( root, -MATE_SCORE, MATE_SCORE, 0 );
+                result.nodes = nodes;
+                return result;
+            }
+
+            int32_t max_depth = ( limit.depth > 0 ) ? std::min(limit.depth, MAX_PLY) : MAX_PLY;
+
+            for ( int32_t depth = 1; depth <= max_depth; depth++ ) {
+                Move best = result.best_move;
+                int32_t score = alpha_beta( root, depth, -MATE_SCORE, MATE_SCORE, 0, best );
+
+                // the result of an unfinished iteration is only used if the previous one didn't give us a move
+                if ( stopped && !result.best_move.is_null() ) break;
+
+                result.score = score;
+                result.best_move = best;
+                if ( !stopped ) result.depth = depth;
+
+                if ( stopped || std::abs(score) >= MATE_SCORE - MAX_PLY ) break;
+            }
+
+            result.nodes = nodes;
+            return result;
+        }
+};
+
+#endif
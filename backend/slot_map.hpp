@@ -0,0 +1,142 @@
+#ifndef SLOT_MAP
+#define SLOT_MAP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+
+// A handle into a SlotMap. The generation changes every time the slot is reused,
+// so a handle to a removed object never points to a newer object that took its slot.
+struct SlotHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    constexpr bool is_null() const noexcept { return index == UINT32_MAX; }
+
+    constexpr bool operator == ( const SlotHandle& a ) const noexcept { return index == a.index && generation == a.generation; }
+    constexpr bool operator != ( const SlotHandle& a ) const noexcept { return !( *this == a ); }
+};
+
+
+
+/*
+ A slot map stores its objects contiguously and gives out handles that stay valid until the object is removed.
+ Inserting and removing are O(1): removing moves the last object into the hole, and the freed slot
+ is put into a free list so the next insert can reuse it.
+*/
+template<typename T>
+class SlotMap
+{
+    private:
+        struct Slot
+        {
+            uint32_t dense_index = 0; // the index of the object in values, or the next free slot if this slot is free
+            uint32_t generation = 0;
+        };
+
+        std::vector<T> values;
+        std::vector<uint32_t> value_slots; // the slot of each object in values
+        std::vector<Slot> slots;
+        uint32_t free_head = UINT32_MAX;
+
+
+        inline bool valid( const SlotHandle& handle ) const noexcept
+        {
+            // a removed slot always has a newer generation than the handles that were given out for it
+            return handle.index < slots.size() && slots[handle.index].generation == handle.generation;
+        }
+
+
+    public:
+        size_t size() const noexcept { return values.size(); }
+        bool empty() const noexcept { return values.empty(); }
+
+        void reserve( const size_t& amount )
+        {
+            values.reserve(amount);
+            value_slots.reserve(amount);
+            slots.reserve(amount);
+        }
+
+
+        // adds an object and returns the handle to it
+        SlotHandle insert( T value )
+        {
+            uint32_t index;
+
+            if ( free_head != UINT32_MAX ) {
+                index = free_head;
+                free_head = slots[index].dense_index;
+            }
+
+            else {
+                index = static_cast<uint32_t>( slots.size() );
+                slots.push_back( Slot() );
+            }
+
+            slots[index].dense_index = static_cast<uint32_t>( values.size() );
+            values.push_back( std::move(value) );
+            value_slots.push_back(index);
+
+            return SlotHandle{ index, slots[index].generation };
+        }
+
+
+        // removes the object of the handle, returns false if the handle was already removed
+        bool erase( const SlotHandle& handle )
+        {
+            if ( !valid(handle) ) return false;
+
+            uint32_t dense = slots[handle.index].dense_index;
+            uint32_t last = static_cast<uint32_t>( values.size() ) - 1;
+
+            // we move the last object into the place of the removed one to keep the objects contiguous
+            if ( dense != last ) {
+                values[dense] = std::move( values[last] );
+                value_slots[dense] = value_slots[last];
+                slots[ value_slots[dense] ].dense_index = dense;
+            }
+
+            values.pop_back();
+            value_slots.pop_back();
+
+            slots[handle.index].generation++;
+            slots[handle.index].dense_index = free_head;
+            free_head = handle.index;
+
+            return true;
+        }
+
+
+        bool contains( const SlotHandle& handle ) const noexcept { return valid(handle); }
+
+        // returns a pointer to the object, or nullptr if the handle isn't valid anymore
+        T* get( const SlotHandle& handle ) noexcept
+        {
+            return ( valid(handle) ) ? &values[ slots[handle.index].dense_index ] : nullptr;
+        }
+
+        const T* get( const SlotHandle& handle ) const noexcept
+        {
+            return ( valid(handle) ) ? &values[ slots[handle.index].dense_index ] : nullptr;
+        }
+
+        // returns the handle of the object at the given position of the contiguous storage
+        SlotHandle handle_at( const size_t& dense_index ) const noexcept
+        {
+            uint32_t index = value_slots[dense_index];
+            return SlotHandle{ index, slots[index].generation };
+        }
+
+
+        // iterating goes through the live objects in their contiguous storage
+        typename std::vector<T>::iterator begin() noexcept { return values.begin(); }
+        typename std::vector<T>::iterator end() noexcept { return values.end(); }
+        typename std::vector<T>::const_iterator begin() const noexcept { return values.begin(); }
+        typename std::vector<T>::const_iterator end() const noexcept { return values.end(); }
+};
+
+#endif
@@ -0,0 +1,963 @@
+#ifndef TABLEBASE
+#define TABLEBASE
+
+#include <cstdint>
+#include <cctype>
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+
+#include "helper_tools.hpp"
+#include "bitboard.hpp"
+#include "position.hpp"
+#include "evaluation.hpp"
+#include "thread_pool.hpp"
+#include "mapped_file.hpp"
+
+
+enum tablebase_wdl
+{
+    TB_LOSS,
+    TB_DRAW,
+    TB_WIN
+};
+
+
+// the result of a probe from the side to moves point of view, moves is the distance to mate in full moves
+struct TablebaseResult
+{
+    tablebase_wdl wdl = TB_DRAW;
+    uint32_t moves = 0;
+};
+
+
+namespace tablebase
+{
+
+constexpr uint32_t MAX_PIECES = 5;
+
+/*
+ Every position is one byte that holds both the result and the distance: 0 is a draw, 1 to 127 is a win in that many
+ moves, LOSS_BASE + n is a loss in n moves and INVALID is an index that isn't a legal position or that is the mirror
+ image of another index.
+*/
+constexpr uint8_t DRAW_BYTE = 0;
+constexpr uint8_t LOSS_BASE = 128;
+constexpr uint8_t INVALID_BYTE = 255;
+constexpr uint32_t MAX_DISTANCE = 126;
+
+constexpr std::array<char, 4> file_magic = { 'C', 'T', 'B', '2' };
+constexpr size_t HEADER_SIZE = 32;
+
+
+/*
+ The squares of both kings are indexed together, so the pairs where the kings touch or stand on the same square
+ take no room. Without pawns the board has 8 symmetries, the white king ends up in the a1-d1-d4 triangle and when it's
+ on the diagonal the black king is on or below the diagonal, which leaves 462 pairs. With pawns only the left and right
+ side of the board are mirror images, the white king ends up on the files a to d and there are 1806 pairs.
+*/
+constexpr uint32_t TRIANGLE_PAIRS = 462;
+constexpr uint32_t HALF_PAIRS = 1806;
+
+struct king_pairs
+{
+    std::array<int16_t, 64*64> triangle{}; // the index of the pair white king + 64 * black king, or -1
+    std::array<int16_t, 64*64> half{};
+    std::array<uint16_t, TRIANGLE_PAIRS> triangle_pair{}; // the squares of a pair, white king + 64 * black king
+    std::array<uint16_t, HALF_PAIRS> half_pair{};
+};
+
+constexpr king_pairs make_king_pairs() noexcept
+{
+    king_pairs pairs{};
+    uint32_t triangle_count = 0;
+    uint32_t half_count = 0;
+
+    for ( int32_t white = 0; white < 64; white++ ) {
+        for ( int32_t black = 0; black < 64; black++ ) {
+            int32_t x = bitboard::file_of(white);
+            int32_t y = bitboard::rank_of(white);
+            int32_t dx = x - bitboard::file_of(black);
+            int32_t dy = y - bitboard::rank_of(black);
+            bool apart = dx > 1 || dx < -1 || dy > 1 || dy < -1;
+
+            pairs.triangle[ white + 64*black ] = -1;
+            pairs.half[ white + 64*black ] = -1;
+
+            if ( !apart || x > 3 ) continue;
+
+            pairs.half_pair[half_count] = static_cast<uint16_t>( white + 64*black );
+            pairs.half[ white + 64*black ] = static_cast<int16_t>( half_count++ );
+
+            if ( y > x || ( x == y && bitboard::rank_of(black) > bitboard::file_of(black) ) ) continue;
+
+            pairs.triangle_pair[triangle_count] = static_cast<uint16_t>( white + 64*black );
+            pairs.triangle[ white + 64*black ] = static_cast<int16_t>( triangle_count++ );
+        }
+    }
+
+    return pairs;
+}
+
+inline constexpr king_pairs kings = make_king_pairs();
+
+
+// the binomial coefficients up to 64 over 4, a group of equal pieces is indexed as a combination of squares
+struct binomial_table
+{
+    std::array<std::array<uint64_t, MAX_PIECES>, 65> values{};
+};
+
+constexpr binomial_table make_binomials() noexcept
+{
+    binomial_table table{};
+
+    for ( uint32_t n = 0; n <= 64; n++ ) {
+        table.values[n][0] = 1;
+        for ( uint32_t k = 1; k < MAX_PIECES; k++ ) table.values[n][k] = ( n == 0 ) ? 0 : table.values[n - 1][k - 1] + table.values[n - 1][k];
+    }
+
+    return table;
+}
+
+inline constexpr binomial_table binomials = make_binomials();
+
+// pawns can only stand on the ranks 2 to 7, so they have 48 squares
+constexpr uint32_t PAWN_SQUARES = 48;
+
+
+// one of the 8 symmetries of the board: bit 0 mirrors the files, bit 1 the ranks and bit 2 the a1-h8 diagonal
+constexpr inline int32_t transform( int32_t square, const uint32_t& symmetry ) noexcept
+{
+    if ( symmetry & 4 ) square = ( ( square & 7 ) << 3 ) | ( square >> 3 );
+    if ( symmetry & 1 ) square ^= 7;
+    if ( symmetry & 2 ) square ^= 56;
+    return square;
+}
+
+
+
+/*
+ The pieces of an endgame in the order that their squares are stored in an index: the white king first, then the
+ other white pieces from the queen down, then the black king and the black pieces. Equal pieces are next to each other
+ and form a group, which is stored as a single combination of squares.
+*/
+struct Material
+{
+    uint32_t count = 0;
+    std::array<uint8_t, MAX_PIECES> pieces{};
+
+    // the layout of the index, set by from_counts() so the index doesn't count the pieces again for every position
+    bool pawns = false;
+    uint32_t black_king = 0;
+    uint32_t group_count = 0;
+    std::array<uint8_t, MAX_PIECES> group_slots{};
+    std::array<uint8_t, MAX_PIECES> group_sizes{};
+    std::array<uint64_t, MAX_PIECES> group_combinations{};
+
+    static Material from_counts( const std::array<std::array<uint32_t, PIECES_COUNT>, 2>& counts ) noexcept
+    {
+        Material material;
+
+        for ( uint32_t color = WHITE; color <= BLACK; color++ ) {
+            for ( uint32_t type = KING; type >= PAWN; type-- ) {
+                for ( uint32_t i = 0; i < counts[color][type] && material.count < MAX_PIECES; i++ ) {
+                    material.pieces[ material.count++ ] = make_piece(type, color);
+                }
+            }
+        }
+
+        material.set_layout();
+        return material;
+    }
+
+    void set_layout() noexcept
+    {
+        pawns = false;
+        black_king = count;
+        group_count = 0;
+
+        for ( uint32_t i = 0; i < count; i++ ) {
+            uint32_t type = piece_type( pieces[i] );
+
+            if ( type == PAWN ) pawns = true;
+            if ( pieces[i] == make_piece(KING, BLACK) ) black_king = i;
+            if ( type == KING || ( i > 0 && pieces[i - 1] == pieces[i] ) ) continue;
+
+            uint32_t size = 1;
+            while ( i + size < count && pieces[i + size] == pieces[i] ) size++;
+
+            group_slots[group_count] = static_cast<uint8_t>(i);
+            group_sizes[group_count] = static_cast<uint8_t>(size);
+            group_combinations[group_count] = binomials.values[ ( type == PAWN ) ? PAWN_SQUARES : 64 ][size];
+            group_count++;
+        }
+    }
+
+    std::array<std::array<uint32_t, PIECES_COUNT>, 2> counts() const noexcept
+    {
+        std::array<std::array<uint32_t, PIECES_COUNT>, 2> result{};
+        for ( uint32_t i = 0; i < count; i++ ) result[ piece_color( pieces[i] ) ][ piece_type( pieces[i] ) ]++;
+        return result;
+    }
+
+    // returns an empty material if the position has too many pieces or not exactly one king per color
+    static Material of( const Position& pos ) noexcept
+    {
+        std::array<std::array<uint32_t, PIECES_COUNT>, 2> result{};
+        uint32_t total = 0;
+
+        for ( uint32_t color = WHITE; color <= BLACK; color++ ) {
+            for ( uint32_t type = PAWN; type <= KING; type++ ) {
+                result[color][type] = static_cast<uint32_t>( bitboard::popcount( pos.pieces(color, type) ) );
+                total += result[color][type];
+            }
+        }
+
+        if ( total > MAX_PIECES || result[WHITE][KING] != 1 || result[BLACK][KING] != 1 ) return Material();
+        return from_counts(result);
+    }
+
+    // reads a name like "KQvK" or "KBNvK", the first side is white
+    static bool parse( const std::string& name, Material& material )
+    {
+        const std::string letters = "PNBRQK";
+        std::array<std::array<uint32_t, PIECES_COUNT>, 2> result{};
+        uint32_t color = WHITE;
+        uint32_t total = 0;
+
+        for ( const char& letter : name ) {
+            if ( letter == 'v' && color == WHITE ) {
+                color = BLACK;
+                continue;
+            }
+
+            size_t type = letters.find( static_cast<char>( std::toupper( static_cast<unsigned char>(letter) ) ) );
+            if ( type == std::string::npos ) return false;
+
+            result[color][ type + PAWN ]++;
+            total++;
+        }
+
+        if ( color != BLACK || total > MAX_PIECES || result[WHITE][KING] != 1 || result[BLACK][KING] != 1 ) return false;
+
+        material = from_counts(result);
+        return true;
+    }
+
+    std::string name() const
+    {
+        const std::string letters = " PNBRQK";
+        std::string result;
+
+        for ( uint32_t i = 0; i < count; i++ ) {
+            if ( i > 0 && piece_color( pieces[i] ) != piece_color( pieces[i - 1] ) ) result += 'v';
+            result += letters[ piece_type( pieces[i] ) ];
+        }
+
+        return result;
+    }
+
+    Material flipped() const noexcept
+    {
+        std::array<std::array<uint32_t, PIECES_COUNT>, 2> swapped = counts();
+        std::swap( swapped[WHITE], swapped[BLACK] );
+        return from_counts(swapped);
+    }
+
+    int32_t strength( const uint32_t& color ) const noexcept
+    {
+        int32_t sum = 0;
+        for ( uint32_t i = 0; i < count; i++ ) {
+            if ( piece_color( pieces[i] ) == color ) sum += evaluation::piece_values[ piece_type( pieces[i] ) ];
+        }
+        return sum;
+    }
+
+    // a table is only generated for one of the colorings of an endgame, the one where white is stronger
+    Material normalized() const
+    {
+        Material other = flipped();
+        if ( strength(WHITE) != strength(BLACK) ) return ( strength(WHITE) > strength(BLACK) ) ? *this : other;
+        return ( name() >= other.name() ) ? *this : other;
+    }
+
+    // the material after the piece in the slot is captured or the pawn in the slot is promoted
+    Material without( const uint32_t& slot ) const noexcept
+    {
+        std::array<std::array<uint32_t, PIECES_COUNT>, 2> result = counts();
+        result[ piece_color( pieces[slot] ) ][ piece_type( pieces[slot] ) ]--;
+        return from_counts(result);
+    }
+
+    Material promoted( const uint32_t& slot, const uint32_t& type ) const noexcept
+    {
+        std::array<std::array<uint32_t, PIECES_COUNT>, 2> result = counts();
+        result[ piece_color( pieces[slot] ) ][PAWN]--;
+        result[ piece_color( pieces[slot] ) ][type]++;
+        return from_counts(result);
+    }
+
+    inline bool has_pawns() const noexcept { return pawns; }
+
+    inline bool is_valid() const noexcept { return count >= 2; }
+    inline bool kings_only() const noexcept { return count == 2; }
+
+    inline uint32_t king_pairs() const noexcept { return ( pawns ) ? HALF_PAIRS : TRIANGLE_PAIRS; }
+    inline uint32_t black_king_slot() const noexcept { return black_king; }
+
+    // 2 sides to move, the king pairs and the combinations of every group
+    uint64_t entries() const noexcept
+    {
+        uint64_t result = 2 * static_cast<uint64_t>( king_pairs() );
+        for ( uint32_t i = 0; i < group_count; i++ ) result *= group_combinations[i];
+        return result;
+    }
+
+    // the pieces are valid piece bytes in the order of from_counts(), with one king per color
+    bool is_well_formed() const noexcept
+    {
+        if ( count < 2 || count > MAX_PIECES ) return false;
+
+        for ( uint32_t i = 0; i < count; i++ ) {
+            uint32_t type = piece_type( pieces[i] );
+            if ( pieces[i] >= 16 || type < PAWN || type > KING ) return false;
+        }
+
+        std::array<std::array<uint32_t, PIECES_COUNT>, 2> result = counts();
+        return result[WHITE][KING] == 1 && result[BLACK][KING] == 1 && from_counts(result) == *this;
+    }
+
+    bool operator == ( const Material& other ) const noexcept
+    {
+        return count == other.count && std::equal( pieces.begin(), pieces.begin() + count, other.pieces.begin() );
+    }
+
+    bool operator != ( const Material& other ) const noexcept { return !( *this == other ); }
+};
+
+
+typedef std::array<int32_t, MAX_PIECES> SquareList;
+
+
+// the square of a piece inside the squares of its type, or -1 for a pawn on the first or last rank
+constexpr inline int32_t group_square( const uint8_t& piece, const int32_t& square ) noexcept
+{
+    if ( piece_type(piece) != PAWN ) return square;
+    return ( square < 8 || square >= 56 ) ? -1 : square - 8;
+}
+
+// the index of the position after the symmetry, or UINT64_MAX if the symmetry doesn't move the kings into their area
+inline uint64_t raw_index( const Material& material, const SquareList& squares, const uint32_t& side, const uint32_t& symmetry ) noexcept
+{
+    int32_t pair_squares = transform( squares[0], symmetry ) + 64 * transform( squares[ material.black_king ], symmetry );
+    int32_t pair = ( material.pawns ) ? kings.half[pair_squares] : kings.triangle[pair_squares];
+    if ( pair < 0 ) return UINT64_MAX;
+
+    uint64_t index = side * material.king_pairs() + static_cast<uint64_t>(pair);
+
+    for ( uint32_t g = 0; g < material.group_count; g++ ) {
+        uint32_t slot = material.group_slots[g];
+        uint32_t size = material.group_sizes[g];
+
+        // the squares of a group are sorted, so every set of squares has one combination
+        std::array<int32_t, MAX_PIECES> group{};
+
+        for ( uint32_t j = 0; j < size; j++ ) {
+            int32_t square = group_square( material.pieces[slot], transform( squares[slot + j], symmetry ) );
+            if ( square < 0 ) return UINT64_MAX;
+
+            uint32_t k = j;
+            for ( ; k > 0 && group[k - 1] > square; k-- ) group[k] = group[k - 1];
+            group[k] = square;
+        }
+
+        uint64_t combination = 0;
+        for ( uint32_t j = 0; j < size; j++ ) combination += binomials.values[ group[j] ][ j + 1 ];
+
+        index = index * material.group_combinations[g] + combination;
+    }
+
+    return index;
+}
+
+
+/*
+ The index of a position, the squares are in the order of the materials pieces. Every position has exactly one index:
+ when more than one symmetry moves the kings into their area, we take the smallest index of them.
+ Returns UINT64_MAX if the kings touch or a pawn is on the first or last rank.
+*/
+inline uint64_t index_of( const Material& material, const SquareList& squares, const uint32_t& side ) noexcept
+{
+    if ( material.has_pawns() ) return raw_index( material, squares, side, ( bitboard::file_of( squares[0] ) > 3 ) ? 1 : 0 );
+
+    uint64_t best = UINT64_MAX;
+    for ( uint32_t symmetry = 0; symmetry < 8; symmetry++ ) best = std::min( best, raw_index( material, squares, side, symmetry ) );
+
+    return best;
+}
+
+// the squares of an index, the pieces of different groups may be on the same square
+inline void decode( const Material& material, uint64_t index, SquareList& squares, uint32_t& side ) noexcept
+{
+    for ( uint32_t g = material.group_count; g-- > 0; ) {
+        uint32_t slot = material.group_slots[g];
+        uint64_t combination = index % material.group_combinations[g];
+        index /= material.group_combinations[g];
+
+        int32_t offset = ( piece_type( material.pieces[slot] ) == PAWN ) ? 8 : 0;
+        int32_t square = ( offset ) ? PAWN_SQUARES : 64;
+
+        // the largest square first, every square is the largest one whose binomial still fits
+        for ( uint32_t j = material.group_sizes[g]; j >= 1; j-- ) {
+            do square--; while ( binomials.values[square][j] > combination );
+
+            combination -= binomials.values[square][j];
+            squares[ slot + j - 1 ] = square + offset;
+        }
+    }
+
+    uint64_t pair = index % material.king_pairs();
+    side = static_cast<uint32_t>( index / material.king_pairs() );
+
+    uint16_t pair_squares = ( material.pawns ) ? kings.half_pair[pair] : kings.triangle_pair[pair];
+    squares[0] = pair_squares & 63;
+    squares[ material.black_king ] = pair_squares >> 6;
+}
+
+
+// the squares of the pieces of a position in the order of the material, with flip the colors and ranks are swapped
+inline void squares_of( const Position& pos, const Material& material, const bool& flip, SquareList& squares, uint32_t& side ) noexcept
+{
+    mask remaining = 0;
+
+    for ( uint32_t i = 0; i < material.count; i++ ) {
+        if ( i == 0 || material.pieces[i] != material.pieces[i - 1] ) {
+            uint32_t color = piece_color( material.pieces[i] ) ^ ( flip ? 1 : 0 );
+            remaining = pos.pieces( color, piece_type( material.pieces[i] ) );
+        }
+
+        squares[i] = bitboard::pop_lsb(remaining) ^ ( flip ? 56 : 0 );
+    }
+
+    side = pos.side_to_move() ^ ( flip ? 1 : 0 );
+}
+
+inline Position build_position( const Material& material, const SquareList& squares, const uint32_t& side ) noexcept
+{
+    Position pos;
+    for ( uint32_t i = 0; i < material.count; i++ ) pos.add_piece( squares[i], piece_type( material.pieces[i] ), piece_color( material.pieces[i] ) );
+    pos.set_state( side, 0, bitboard::NO_SQUARE, 0, 1 );
+    return pos;
+}
+
+
+inline TablebaseResult decode_byte( const uint8_t& value ) noexcept
+{
+    TablebaseResult result;
+
+    if ( value == DRAW_BYTE ) return result;
+
+    result.wdl = ( value < LOSS_BASE ) ? TB_WIN : TB_LOSS;
+    result.moves = ( value < LOSS_BASE ) ? value : value - LOSS_BASE;
+    return result;
+}
+
+// the distance in plies, a won position is always mated on the winners move and a lost one on the losers move
+inline uint32_t result_plies( const TablebaseResult& result ) noexcept
+{
+    return ( result.wdl == TB_WIN ) ? 2*result.moves - 1 : 2*result.moves;
+}
+
+
+
+// a table in memory, either generated or mapped from a file
+struct TableView
+{
+    Material material;
+    const uint8_t* data = nullptr;
+    uint64_t entries = 0;
+};
+
+
+/*
+ Looks the position up in the first view of its material or of the flipped material. This doesn't allocate and
+ costs one index calculation. Positions with castling or en passant rights aren't in the tables.
+*/
+inline bool probe_views( const TableView* views, const size_t& count, const Position& pos, TablebaseResult& result ) noexcept
+{
+    if ( pos.castling_state() || pos.en_passant() != bitboard::NO_SQUARE ) return false;
+
+    Material material = Material::of(pos);
+    if ( !material.is_valid() ) return false;
+
+    if ( material.kings_only() ) {
+        result = TablebaseResult();
+        return true;
+    }
+
+    Material flipped = material.flipped();
+
+    for ( size_t i = 0; i < count; i++ ) {
+        bool flip = views[i].material != material;
+        if ( flip && views[i].material != flipped ) continue;
+
+        SquareList squares;
+        uint32_t side;
+        squares_of( pos, views[i].material, flip, squares, side );
+
+        uint64_t index = index_of( views[i].material, squares, side );
+        if ( index >= views[i].entries || views[i].data[index] == INVALID_BYTE ) return false;
+
+        result = decode_byte( views[i].data[index] );
+        return true;
+    }
+
+    return false;
+}
+
+}
+
+
+
+/*
+ Generates endgame tables with retrograde analysis. The mates are found first, then every pass goes one ply further
+ back from the positions that were decided in the previous pass: a position that can move into a lost position is won,
+ and a position whose moves all go into won positions is lost. The positions that are never decided are draws.
+ The captures and promotions leave the table, their results come from the smaller tables, which are generated first.
+ Every pass is split over the threads of the pool.
+
+ The tables don't know about en passant, a double pawn step is scored as if the capture on the passed square
+ wasn't possible. This only matters in endgames where both colors have pawns.
+*/
+class TablebaseGenerator
+{
+    private:
+        // the state of a position during the generation, the high bits are the status and the low bits the plies
+        enum status : uint16_t
+        {
+            UNDECIDED = 0,
+            INVALID = 1,
+            DRAWN = 2,
+            WON = 3,
+            LOST = 4
+        };
+
+        static constexpr uint16_t PLY_MASK = 0x0FFF;
+        static constexpr size_t CHUNK = 1 << 14;
+
+        static inline uint16_t make_state( const uint16_t& state, const uint32_t& plies ) noexcept { return static_cast<uint16_t>( ( state << 12 ) | plies ); }
+        static inline uint16_t state_of( const uint16_t& value ) noexcept { return value >> 12; }
+        static inline uint32_t plies_of( const uint16_t& value ) noexcept { return value & PLY_MASK; }
+
+        struct GeneratedTable
+        {
+            tablebase::Material material;
+            std::vector<uint8_t> data;
+        };
+
+        // the data of one table while it's generated
+        struct Work
+        {
+            tablebase::Material material;
+            uint64_t entries = 0;
+            std::unique_ptr< std::atomic<uint16_t>[] > values;
+            std::unique_ptr< std::atomic<uint8_t>[] > remaining; // the moves that don't lead into a won position yet
+            std::vector<uint8_t> escape; // the longest loss through a capture or promotion, in plies
+            std::atomic<uint32_t> last_level{0};
+        };
+
+        ThreadPool& pool;
+        std::vector<GeneratedTable> tables;
+        std::vector<tablebase::TableView> views;
+
+
+        void refresh_views()
+        {
+            views.clear();
+            for ( const GeneratedTable& table : tables ) views.push_back( tablebase::TableView{ table.material, table.data.data(), table.data.size() } );
+        }
+
+        static void raise_level( Work& work, const uint32_t& level ) noexcept
+        {
+            uint32_t current = work.last_level.load( std::memory_order_relaxed );
+            while ( current < level && !work.last_level.compare_exchange_weak( current, level, std::memory_order_relaxed ) ) { }
+        }
+
+        // a position is won with the shortest mate that was found for it
+        static void set_win( Work& work, const uint64_t& index, const uint32_t& plies ) noexcept
+        {
+            uint16_t current = work.values[index].load( std::memory_order_relaxed );
+
+            while ( state_of(current) == UNDECIDED || ( state_of(current) == WON && plies_of(current) > plies ) ) {
+                if ( work.values[index].compare_exchange_weak( current, make_state(WON, plies), std::memory_order_relaxed ) ) {
+                    raise_level(work, plies);
+                    return;
+                }
+            }
+        }
+
+        static void set_loss( Work& work, const uint64_t& index, const uint32_t& plies ) noexcept
+        {
+            uint16_t expected = UNDECIDED;
+            if ( work.values[index].compare_exchange_strong( expected, make_state(LOST, plies), std::memory_order_relaxed ) ) raise_level(work, plies);
+        }
+
+
+        // scores the mates and stalemates and counts the moves that stay in the table
+        void initialise( Work& work, const uint64_t& index ) const noexcept
+        {
+            const tablebase::Material& material = work.material;
+            tablebase::SquareList squares;
+            uint32_t side;
+            tablebase::decode( material, index, squares, side );
+
+            mask occupied = 0;
+
+            for ( uint32_t i = 0; i < material.count; i++ ) {
+                mask bit = bitboard::square_bit( squares[i] );
+                bool promotion_rank = bitboard::rank_of( squares[i] ) == 0 || bitboard::rank_of( squares[i] ) == 7;
+
+                if ( ( occupied & bit ) || ( piece_type( material.pieces[i] ) == PAWN && promotion_rank ) ) {
+                    work.values[index].store( make_state(INVALID, 0), std::memory_order_relaxed );
+                    return;
+                }
+
+                occupied |= bit;
+            }
+
+            // the mirror images of a canonical position are left out
+            if ( tablebase::index_of( material, squares, side ) != index ) {
+                work.values[index].store( make_state(INVALID, 0), std::memory_order_relaxed );
+                return;
+            }
+
+            Position pos = tablebase::build_position( material, squares, side );
+
+            if ( pos.square_attacked( pos.king_square( side ^ 1 ), side ) ) {
+                work.values[index].store( make_state(INVALID, 0), std::memory_order_relaxed );
+                return;
+            }
+
+            MoveList list;
+            pos.generate_legal(list);
+
+            if ( list.empty() ) {
+                work.values[index].store( ( pos.in_check() ) ? make_state(LOST, 0) : make_state(DRAWN, 0), std::memory_order_relaxed );
+                return;
+            }
+
+            // a move into the table is counted once for every different position it reaches, that's how often
+            // the retrograde passes will come back to this position
+            std::array<uint64_t, 256> children;
+            uint32_t child_count = 0;
+            uint32_t draws = 0;
+            uint32_t fastest_win = UINT32_MAX;
+            uint32_t escape = 0;
+
+            for ( const Move& a_move : list ) {
+                if ( !a_move.is_capture() && !a_move.is_promotion() ) {
+                    tablebase::SquareList next = squares;
+
+                    for ( uint32_t i = 0; i < material.count; i++ ) {
+                        if ( next[i] == a_move.from() ) next[i] = a_move.to();
+                    }
+
+                    uint64_t child = tablebase::index_of( material, next, side ^ 1 );
+                    if ( std::find( children.begin(), children.begin() + child_count, child ) == children.begin() + child_count ) children[ child_count++ ] = child;
+                    continue;
+                }
+
+                Position next = pos;
+                next.play(a_move);
+
+                TablebaseResult result;
+                if ( !tablebase::probe_views( views.data(), views.size(), next, result ) || result.wdl == TB_DRAW ) draws = 1;
+                else if ( result.wdl == TB_LOSS ) fastest_win = std::min( fastest_win, tablebase::result_plies(result) + 1 );
+                else escape = std::max( escape, tablebase::result_plies(result) );
+            }
+
+            work.remaining[index].store( static_cast<uint8_t>( child_count + draws ), std::memory_order_relaxed );
+            work.escape[index] = static_cast<uint8_t>( std::min<uint32_t>( escape, 255 ) );
+
+            if ( fastest_win != UINT32_MAX ) set_win( work, index, fastest_win );
+            else if ( child_count + draws == 0 ) set_loss( work, index, escape + 1 );
+        }
+
+
+        // goes one move back from a decided position and updates the positions that could have moved into it
+        void retract( Work& work, const uint64_t& index, const uint16_t& value ) const noexcept
+        {
+            const tablebase::Material& material = work.material;
+            tablebase::SquareList squares;
+            uint32_t side;
+            tablebase::decode( material, index, squares, side );
+
+            uint32_t mover = side ^ 1;
+            uint32_t level = plies_of(value);
+            mask occupied = 0;
+            for ( uint32_t i = 0; i < material.count; i++ ) occupied |= bitboard::square_bit( squares[i] );
+
+            std::array<uint64_t, 256> parents;
+            uint32_t parent_count = 0;
+
+            for ( uint32_t i = 0; i < material.count; i++ ) {
+                if ( piece_color( material.pieces[i] ) != mover ) continue;
+
+                int32_t to = squares[i];
+                mask origins = 0;
+
+                switch ( piece_type( material.pieces[i] ) ) {
+                    case PAWN: {
+                        int32_t back = ( mover == WHITE ) ? to - 8 : to + 8;
+                        int32_t start_rank = ( mover == WHITE ) ? 3 : 4;
+                        int32_t back_rank = bitboard::rank_of(back);
+
+                        if ( back_rank > 0 && back_rank < 7 && !( occupied & bitboard::square_bit(back) ) ) {
+                            origins |= bitboard::square_bit(back);
+
+                            int32_t double_back = ( mover == WHITE ) ? to - 16 : to + 16;
+                            if ( bitboard::rank_of(to) == start_rank && !( occupied & bitboard::square_bit(double_back) ) ) origins |= bitboard::square_bit(double_back);
+                        }
+                        break;
+                    }
+                    case KNIGHT: origins = bitboard::tables.knight[to]; break;
+                    case BISHOP: origins = bitboard::bishop_attacks( to, occupied ); break;
+                    case ROOK: origins = bitboard::rook_attacks( to, occupied ); break;
+                    case QUEEN: origins = bitboard::queen_attacks( to, occupied ); break;
+                    case KING: origins = bitboard::tables.king[to]; break;
+                    default: break;
+                }
+
+                origins &= ~occupied;
+
+                while ( origins ) {
+                    tablebase::SquareList previous = squares;
+                    previous[i] = bitboard::pop_lsb(origins);
+
+                    // the side that just moved can't have left the other king in check
+                    Position before = tablebase::build_position( material, previous, mover );
+                    if ( before.square_attacked( before.king_square(side), mover ) ) continue;
+
+                    uint64_t parent = tablebase::index_of( material, previous, mover );
+                    if ( std::find( parents.begin(), parents.begin() + parent_count, parent ) != parents.begin() + parent_count ) continue;
+                    parents[ parent_count++ ] = parent;
+
+                    if ( state_of(value) == LOST ) {
+                        set_win( work, parent, level + 1 );
+                        continue;
+                    }
+
+                    if ( state_of( work.values[parent].load( std::memory_order_relaxed ) ) != UNDECIDED ) continue;
+
+                    // the last move that doesn't lose is gone, so the position is lost as slowly as possible
+                    if ( work.remaining[parent].fetch_sub( 1, std::memory_order_relaxed ) == 1 ) {
+                        set_loss( work, parent, std::max<uint32_t>( level, work.escape[parent] ) + 1 );
+                    }
+                }
+            }
+        }
+
+
+        void build( const tablebase::Material& material )
+        {
+            Work work;
+            work.material = material;
+            work.entries = material.entries();
+            work.values.reset( new std::atomic<uint16_t>[ work.entries ]() );
+            work.remaining.reset( new std::atomic<uint8_t>[ work.entries ]() );
+            work.escape.assign( work.entries, 0 );
+
+            pool.parallel_for( work.entries, CHUNK, [&]( size_t, size_t begin, size_t end ) {
+                for ( size_t index = begin; index < end; index++ ) initialise( work, index );
+            } );
+
+            // a pass only looks at the positions of its own level, the positions it decides are at least one ply further
+            for ( uint32_t level = 0; level <= work.last_level.load(); level++ ) {
+                pool.parallel_for( work.entries, CHUNK, [&]( size_t, size_t begin, size_t end ) {
+                    for ( size_t index = begin; index < end; index++ ) {
+                        uint16_t value = work.values[index].load( std::memory_order_relaxed );
+                        uint16_t state = state_of(value);
+
+                        if ( ( state == WON || state == LOST ) && plies_of(value) == level ) retract( work, index, value );
+                    }
+                } );
+            }
+
+            GeneratedTable table;
+            table.material = material;
+            table.data.resize( work.entries );
+
+            pool.parallel_for( work.entries, CHUNK, [&]( size_t, size_t begin, size_t end ) {
+                for ( size_t index = begin; index < end; index++ ) {
+                    uint16_t value = work.values[index].load( std::memory_order_relaxed );
+                    uint32_t plies = plies_of(value);
+
+                    switch ( state_of(value) ) {
+                        case INVALID: table.data[index] = tablebase::INVALID_BYTE; break;
+                        case WON: table.data[index] = static_cast<uint8_t>( std::min( ( plies + 1 ) / 2, tablebase::MAX_DISTANCE ) ); break;
+                        case LOST: table.data[index] = static_cast<uint8_t>( tablebase::LOSS_BASE + std::min( plies / 2, tablebase::MAX_DISTANCE ) ); break;
+                        default: table.data[index] = tablebase::DRAW_BYTE; break;
+                    }
+                }
+            } );
+
+            tables.push_back( std::move(table) );
+            refresh_views();
+        }
+
+
+        static void write_u64( std::ofstream& stream, uint64_t value )
+        {
+            for ( uint32_t i = 0; i < 8; i++ ) {
+                stream.put( static_cast<char>( value & 0xFF ) );
+                value >>= 8;
+            }
+        }
+
+
+    public:
+        explicit TablebaseGenerator( ThreadPool& pool0 ) : pool(pool0) { }
+
+        /**
+         * @brief Generates the table of the endgame and every smaller table that it can reach with captures and promotions.
+         * A table that was already generated is kept, the colors of the endgame can be given either way round.
+         *
+         * The generation needs 4 bytes of memory for every entry of the table, so the 5 piece tables with pawns need
+         * a few gigabytes, for example KRPvKR has 710 million entries.
+         *
+         * @param name the pieces of the endgame, for example "KQvK" or "KBNvK", with at most 5 pieces
+         * @return false if the name isn't a valid endgame
+         */
+        bool generate( const std::string& name )
+        {
+            tablebase::Material material;
+            if ( !tablebase::Material::parse(name, material) ) return false;
+
+            generate(material);
+            return true;
+        }
+
+        void generate( const tablebase::Material& endgame )
+        {
+            tablebase::Material material = endgame.normalized();
+            if ( material.kings_only() || find(material) ) return;
+
+            for ( uint32_t i = 1; i < material.count; i++ ) {
+                if ( piece_type( material.pieces[i] ) == KING ) continue;
+
+                generate( material.without(i) );
+
+                if ( piece_type( material.pieces[i] ) == PAWN ) {
+                    for ( uint32_t type = KNIGHT; type <= QUEEN; type++ ) generate( material.promoted(i, type) );
+                }
+            }
+
+            build(material);
+        }
+
+        // returns the data of a generated table, or nullptr
+        const std::vector<uint8_t>* find( const tablebase::Material& material ) const noexcept
+        {
+            for ( const GeneratedTable& table : tables ) {
+                if ( table.material == material ) return &table.data;
+            }
+            return nullptr;
+        }
+
+        inline bool probe( const Position& pos, TablebaseResult& result ) const noexcept
+        {
+            return tablebase::probe_views( views.data(), views.size(), pos, result );
+        }
+
+        inline size_t table_count() const noexcept { return tables.size(); }
+
+
+        /**
+         * @brief Writes every generated table into the directory as "<name>.ctb", for example "KQvK.ctb".
+         * The file is a 32 byte header followed by one byte per index, so it can be mapped as it is.
+         *
+         * @return false if a file couldn't be written
+         */
+        bool write( const std::string& directory ) const
+        {
+            for ( const GeneratedTable& table : tables ) {
+                std::ofstream stream( directory + "/" + table.material.name() + ".ctb", std::ios::binary | std::ios::trunc );
+                if ( !stream ) return false;
+
+                stream.write( tablebase::file_magic.data(), 4 );
+                stream.put( static_cast<char>( table.material.count ) );
+                for ( uint32_t i = 0; i < tablebase::MAX_PIECES; i++ ) stream.put( static_cast<char>( ( i < table.material.count ) ? table.material.pieces[i] : 0 ) );
+                for ( uint32_t i = 10; i < 16; i++ ) stream.put(0);
+                write_u64( stream, table.data.size() );
+                write_u64( stream, 0 );
+
+                stream.write( reinterpret_cast<const char*>( table.data.data() ), static_cast<std::streamsize>( table.data.size() ) );
+                if ( !stream ) return false;
+            }
+
+            return true;
+        }
+};
+
+
+
+/*
+ The endgame tables that were written by the TablebaseGenerator. The files are memory mapped, so loading is instant
+ and only the pages that are probed are read from the disk. Probing doesn't allocate, a Board is probed with its to_position().
+*/
+class Tablebase
+{
+    private:
+        std::vector<MappedFile> files;
+        std::vector<tablebase::TableView> views;
+
+    public:
+        // maps one table file, returns false if it isn't a valid table
+        bool load( const std::string& path )
+        {
+            MappedFile file(path);
+            if ( !file.is_open() || file.size() < tablebase::HEADER_SIZE ) return false;
+
+            const uint8_t* header = file.data();
+            if ( !std::equal( tablebase::file_magic.begin(), tablebase::file_magic.end(), header ) ) return false;
+
+            tablebase::TableView view;
+            view.material.count = header[4];
+            if ( view.material.count < 2 || view.material.count > tablebase::MAX_PIECES ) return false;
+
+            for ( uint32_t i = 0; i < view.material.count; i++ ) view.material.pieces[i] = header[5 + i];
+            for ( uint32_t i = 0; i < 8; i++ ) view.entries |= static_cast<uint64_t>( header[16 + i] ) << ( 8*i );
+
+            // the pieces are used to look up bitboards, so a damaged header must not get through
+            if ( !view.material.is_well_formed() ) return false;
+            view.material.set_layout();
+
+            if ( view.entries != view.material.entries() || file.size() < tablebase::HEADER_SIZE + view.entries ) return false;
+
+            view.data = file.data() + tablebase::HEADER_SIZE;
+            views.push_back(view);
+            files.push_back( std::move(file) );
+            return true;
+        }
+
+        /**
+         * @brief Looks the position up in the loaded tables.
+         *
+         * @param pos the position, without castling or en passant rights
+         * @param result the result for the side to move and the distance to mate in moves
+         * @return false if no table has the material of the position
+         */
+        inline bool probe( const Position& pos, TablebaseResult& result ) const noexcept
+        {
+            return tablebase::probe_views( views.data(), views.size(), pos, result );
+        }
+
+        inline size_t size() const noexcept { return views.size(); }
+};
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+
+/*
+ A work-stealing thread pool. Every worker has its own queue of tasks, it takes work from the back of its own
+ queue and when the queue is empty, it steals from the front of the other workers queues.
+ Each task gets the index of the worker that runs it, so the caller can keep separate state for every thread.
+*/
+class ThreadPool
+{
+    private:
+        struct WorkerQueue
+        {
+            std::deque< std::function<void(size_t)> > tasks;
+            std::mutex lock;
+        };
+
+        std::vector< std::unique_ptr<WorkerQueue> > queues;
+        std::vector< std::thread > workers;
+
+        std::mutex wake_lock;
+        std::condition_variable wake;
+        std::condition_variable all_done;
+
+        std::atomic<size_t> queued{0};  // tasks that are waiting in the queues
+        std::atomic<size_t> pending{0}; // tasks that are queued or running
+        std::atomic<size_t> next_queue{0};
+        bool stopping = false;
+
+
+        // the index of the worker that the current thread is, or the amount of workers if its not a worker thread
+        static size_t& current_worker() noexcept
+        {
+            static thread_local size_t index = SIZE_MAX;
+            return index;
+        }
+
+
+        bool take_task( const size_t& index, std::function<void(size_t)>& task )
+        {
+            {
+                std::lock_guard<std::mutex> guard( queues[index]->lock );
+
+                if ( !queues[index]->tasks.empty() ) {
+                    task = std::move( queues[index]->tasks.back() );
+                    queues[index]->tasks.pop_back();
+                    return true;
+                }
+            }
+
+            // we steal from the other workers, starting from the next worker so the stealing is spread out
+            for ( size_t i = 1; i < queues.size(); i++ ) {
+                WorkerQueue& victim = *queues[ ( index + i ) % queues.size() ];
+                std::lock_guard<std::mutex> guard( victim.lock );
+
+                if ( !victim.tasks.empty() ) {
+                    task = std::move( victim.tasks.front() );
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+
+        // runs a task that take_task() returned
+        void run_task( const size_t& index, std::function<void(size_t)>& task )
+        {
+            queued--;
+            task(index);
+            task = nullptr;
+
+            if ( --pending == 0 ) {
+                std::lock_guard<std::mutex> guard(wake_lock);
+                all_done.notify_all();
+            }
+        }
+
+        void worker_loop( const size_t index )
+        {
+            current_worker() = index;
+            std::function<void(size_t)> task;
+
+            while ( true ) {
+                if ( take_task( index, task ) ) {
+                    run_task( index, task );
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> guard(wake_lock);
+                wake.wait( guard, [this]{ return stopping || queued > 0; } );
+
+                if ( stopping && queued == 0 ) return;
+            }
+        }
+
+
+    public:
+        explicit ThreadPool( size_t thread_count = std::thread::hardware_concurrency() )
+        {
+            thread_count = std::max<size_t>( thread_count, 1 );
+
+            for ( size_t i = 0; i < thread_count; i++ ) {
+                queues.push_back( std::make_unique<WorkerQueue>() );
+            }
+
+            for ( size_t i = 0; i < thread_count; i++ ) {
+                workers.emplace_back( &ThreadPool::worker_loop, this, i );
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> guard(wake_lock);
+                stopping = true;
+            }
+
+            wake.notify_all();
+
+            for ( std::thread& worker : workers ) {
+                worker.join();
+            }
+        }
+
+        ThreadPool( const ThreadPool& ) = delete;
+        ThreadPool& operator = ( const ThreadPool& ) = delete;
+
+
+        size_t size() const noexcept { return workers.size(); }
+
+
+        // adds a task into the pool, a task that is submitted from a worker goes into that workers own queue.
+        void submit( std::function<void(size_t)> task )
+        {
+            size_t index = current_worker();
+            if ( index >= queues.size() ) index = next_queue++ % queues.size();
+
+            pending++;
+
+            // the counter goes up before the task can be taken, otherwise the worker that takes it could count it down first
+            {
+                std::lock_guard<std::mutex> guard(wake_lock);
+                queued++;
+            }
+
+            {
+                std::lock_guard<std::mutex> guard( queues[index]->lock );
+                queues[index]->tasks.push_back( std::move(task) );
+            }
+
+            wake.notify_one();
+        }
+
+
+        // blocks until every submitted task has finished, this must not be called from inside a task.
+        void wait()
+        {
+            std::unique_lock<std::mutex> guard(wake_lock);
+            all_done.wait( guard, [this]{ return pending == 0; } );
+        }
+
+
+        /**
+         * @brief Splits the range [0, count) into chunks of the given size and runs them in the pool.
+         * The function is called as func( worker_index, begin, end ) and this method returns when every chunk is done.
+         * It only waits for its own chunks, so many threads can use the pool at once. When it's called from a task,
+         * the worker runs queued tasks while it waits, so a nested parallel_for doesn't block the pool.
+         */
+        template<typename F>
+        void parallel_for( const size_t& count, size_t chunk_size, F func )
+        {
+            struct Latch
+            {
+                size_t remaining = 0;
+                std::mutex lock;
+                std::condition_variable done;
+            };
+
+            chunk_size = std::max<size_t>( chunk_size, 1 );
+
+            Latch latch;
+            latch.remaining = ( count + chunk_size - 1 ) / chunk_size;
+            if ( latch.remaining == 0 ) return;
+
+            for ( size_t begin = 0; begin < count; begin += chunk_size ) {
+                size_t end = std::min( count, begin + chunk_size );
+
+                submit( [&func, &latch, begin, end]( size_t worker ) {
+                    func( worker, begin, end );
+
+                    // the latch is only touched under its lock, so the caller can't return while we still use it
+                    std::lock_guard<std::mutex> guard(latch.lock);
+                    if ( --latch.remaining == 0 ) latch.done.notify_all();
+                } );
+            }
+
+            size_t index = current_worker();
+
+            if ( index < queues.size() ) {
+                std::function<void(size_t)> task;
+
+                while ( true ) {
+                    {
+                        std::lock_guard<std::mutex> guard(latch.lock);
+                        if ( latch.remaining == 0 ) return;
+                    }
+
+                    if ( take_task( index, task ) ) {
+                        run_task( index, task );
+                        continue;
+                    }
+
+                    // the rest of the chunks are running on other workers
+                    std::unique_lock<std::mutex> guard(latch.lock);
+                    latch.done.wait( guard, [&latch]{ return latch.remaining == 0; } );
+                    return;
+                }
+            }
+
+            std::unique_lock<std::mutex> guard(latch.lock);
+            latch.done.wait( guard, [&latch]{ return latch.remaining == 0; } );
+        }
+};
+
+#endif
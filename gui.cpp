@@ -75,7 +75,8 @@ HBITMAP hBitmap = NULL;
 using helper::coordinates;
 
 static Game game_object;
-static std::shared_ptr<Board> board_ptr = game_object.new_game();
+static GameHandle game_handle = game_object.new_game();
+static std::shared_ptr<Board> board_ptr = game_object.current();
 
 #define process_button(b, vk)\
 case vk: {\
@@ -165,7 +166,7 @@ LRESULT CALLBACK window_callback(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPa
 
                     draw_chessboard(render_state.width, render_state.height);
                     draw_pieces(game_object.current());
-                    display_all_text(600, 0, hwnd, game_object.get_moves().lock());
+                    display_all_text(600, 0, hwnd, game_object.get_moves().lock(), game_object.current_status());
 
                     
 
@@ -176,14 +177,15 @@ LRESULT CALLBACK window_callback(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPa
 
                 // this case is used when we hit the reset button and we start the game from the beginning
                 case 2:
-                    game_object.end_game(0);
-                    board_ptr = game_object.new_game();
+                    game_object.end_game(game_handle);
+                    game_handle = game_object.new_game();
+                    board_ptr = game_object.current();
                     board_ptr->add_pieces();
                     game_object.reset_text();
 
                     draw_chessboard(render_state.width, render_state.height);
                     draw_pieces(game_object.current());
-                    display_all_text(600, 0, hwnd, game_object.get_moves().lock());
+                    display_all_text(600, 0, hwnd, game_object.get_moves().lock(), game_object.current_status());
 
 
                     
@@ -223,7 +225,7 @@ LRESULT CALLBACK window_callback(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPa
 
             draw_chessboard(render_state.width, render_state.height);
             draw_pieces(game_object.current());
-            display_all_text(600, 0, hwnd, game_object.get_moves().lock());
+            display_all_text(600, 0, hwnd, game_object.get_moves().lock(), game_object.current_status());
             display_button("shuffle pieces", render_state.width + text_field.width, 0, hwnd, 1);
             display_button("reset_game", render_state.width + text_field.width, a_button.height+10, hwnd, 2);
 
@@ -266,6 +268,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
     
     //std::shared_ptr<Board> board_ptr = game_object.new_game().lock();
     board_ptr->add_pieces();
+    game_object.reset_text();
     
 
     std::weak_ptr<Square> a_square = std::weak_ptr<Square>();
@@ -361,7 +364,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
 
     draw_pieces(game_object.current());
 
-    display_all_text(600, 0, window, game_object.get_moves().lock());
+    display_all_text(600, 0, window, game_object.get_moves().lock(), game_object.current_status());
     /*
     StretchDIBits(
         hdc, 
@@ -481,7 +484,7 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
                                 piece_just_moved = true;
                             }
 
-                            display_all_text( 600, 0, window, game_object.get_moves().lock() );
+                            display_all_text( 600, 0, window, game_object.get_moves().lock(), game_object.current_status() );
 
                         }
                         
@@ -503,7 +506,8 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
                     }
 
                     else {
-                        can_go = game_object.current()->doesnt_get_in_check( clicked_square.lock()->get_piece(), clicked_square.lock()->coordinates() );
+                        // the moves were calculated on the worker thread when the turn changed, so this is only a lookup
+                        can_go = game_object.possible_moves( clicked_square.lock()->coordinates() );
                     }
                     
                     
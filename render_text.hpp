@@ -2,12 +2,13 @@
 #define RENDER_TEXT
 
 #include "backend/helper_tools.hpp"
+#include "backend/move_log.hpp"
+#include "backend/board.hpp"
 #include <cstdint>
 #include <tchar.h>
 #include <memory>
 #include <string>
 #include <windows.h>
-#include <numeric>
 #include <iostream>
 
 inline void display_text(std::string text, const int32_t& x, const int32_t& y, HWND hwnd)
@@ -34,16 +35,60 @@ inline void display_text(std::string text, const int32_t& x, const int32_t& y, H
 }
 
 
-inline void display_all_text(const int32_t& x, const int32_t& y, HWND hwnd, std::shared_ptr< std::deque<std::string> > text)
+/*
+ Shows the moves history of the game. The SAN text of the moves that were already shown is kept,
+ so after a move only the new entries of the log are formatted and appended.
+ The check, the stalemate, the known endgame results and the hanging pieces are read from the status that the board calculated when the move was committed.
+*/
+inline void display_all_text(const int32_t& x, const int32_t& y, HWND hwnd, std::shared_ptr< MoveLog > text, const GameStatus& status = GameStatus())
 {   
+    static const MoveLog* shown_log = nullptr;
+    static uint32_t shown_resets = 0;
+    static size_t shown_plies = 0;
+    static Position shown_position; // the position after the shown plies
+    static std::string moves_text;
 
-    
     std::string all_text;
 
     if ( !text ) all_text = "";
 
     else {
-        all_text = std::reduce(text->begin(), text->end(), std::string(""));
+        // if the log is a different one or it has been cleared, we start the text from the beginning
+        if ( text.get() != shown_log || text->reset_count() != shown_resets || text->size() < shown_plies ) {
+            shown_log = text.get();
+            shown_resets = text->reset_count();
+            shown_plies = 0;
+            moves_text.clear();
+        }
+
+        text->san_since(shown_plies, shown_position, moves_text);
+
+        all_text = moves_text + text->result_text();
+
+        if ( status.stalemate ) all_text += "Stalemate, the game is a draw.\n";
+        else if ( !status.checkmate && status.checked ) {
+            all_text += "The color: " + std::string( ( status.in_check(WHITE) ) ? "w" : "b" ) + " is in check.\n";
+        }
+
+        if ( !status.game_over() && status.known_draw ) all_text += "The position is a known draw.\n";
+        else if ( !status.game_over() && status.known_winner >= 0 ) {
+            all_text += "The color: " + std::string( ( status.known_winner == WHITE ) ? "w" : "b" ) + " wins with best play.\n";
+        }
+
+        // warn about the pieces that the static exchange says can be taken for free
+        for ( uint32_t color = WHITE; color <= BLACK && !status.game_over(); color++ ) {
+            uint64_t hanging = status.hanging[color];
+            if ( !hanging ) continue;
+
+            all_text += "Hanging pieces of " + std::string( ( color == WHITE ) ? "w" : "b" ) + ":";
+
+            while ( hanging ) {
+                int32_t square = bitboard::pop_lsb(hanging);
+                all_text += " " + chess_letters[ bitboard::file_of(square) ] + std::to_string( bitboard::rank_of(square) + 1 );
+            }
+
+            all_text += "\n";
+        }
     }
     
 
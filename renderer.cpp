@@ -105,8 +105,8 @@ static helper::coordinates<int64_t> redSquare;
 */
 inline void draw_chessboard(int width, int height)
 {
-    int square_width = width/8;
-    int square_height = height/8;
+    int square_width = width/Board::width;
+    int square_height = height/Board::height;
 
     // this is where we start drawing the first square
     int first_x = square_width;
@@ -117,7 +117,7 @@ inline void draw_chessboard(int width, int height)
         
         // the modulo operator ensures that we draw every square 
         // black and white in cycles
-        for ( int j = i%2; j < 8 + i%2; j++ ) {
+        for ( int j = i%2; j < Board::width + i%2; j++ ) {
             
             switch (j%2) {
                 case 0: 
@@ -461,11 +461,11 @@ struct
  this function draws all the pieces that are left on the board
  this code was part of the main function that ran the program,
  but I removed it and made it its own function for simplicity.
+ The pieces are read from the latest published snapshot of the board, so drawing never sees
+ a half finished move even if another thread is moving the pieces.
 */
 inline void draw_pieces(const std::weak_ptr<Board> board_ptr)
 {
-    std::weak_ptr<Square> a_square = std::weak_ptr<Square>();
-
     int32_t x1 = 0;
     int32_t y1 = 0;
     //HANDLE* hImg_ptr = NULL;
@@ -474,20 +474,27 @@ inline void draw_pieces(const std::weak_ptr<Board> board_ptr)
 
     if ( board_ptr.expired() ) return;
 
-    for ( int32_t x = 0; x < 8; x++ ) {
-        x1 = x*(render_state.width/8);
-        for ( int32_t y = 0; y < 8; y++ ) {
+    SnapshotCell<BoardSnapshot>::Reader snapshot = board_ptr.lock()->snapshot();
+    const Position& position = snapshot->position;
+    const GameStatus& status = snapshot->status;
+
+    for ( int32_t x = 0; x < Board::width; x++ ) {
+        x1 = x*(render_state.width/Board::width);
+        for ( int32_t y = 0; y < Board::height; y++ ) {
+
+            y1 = y*(render_state.height/Board::height);
 
-            y1 = y*(render_state.height/8);
+            uint8_t a_piece = position.piece_on( bitboard::make_square(x, y) );
 
-            a_square = ((board_ptr.lock())->get_square( helper::coordinates<int64_t>{x, y}));
-            std::weak_ptr<Piece> a_piece = (a_square.lock())->get_piece();
+            if ( a_piece ) {
 
-            if ( !(a_piece.expired()) ) {
+                // the status was calculated when the move was committed, so drawing doesn't check anything itself
+                bool king_in_check = status.in_check( piece_color(a_piece) );
                     
                 // we render the pieces onto the window
-                // we use the already calculated arrays of the pictures
-                switch (a_piece.lock()->tell_id()) {
+                // we use the already calculated arrays of the pictures,
+                // the piece ids are the same as the ones that Piece::tell_id() returns
+                switch ( piece_type(a_piece) * ( ( piece_color(a_piece) == WHITE ) ? 1 : 10 ) ) {
                     
                     case PAWN:
                         //hImg_ptr = &pieces.pawn;
@@ -520,7 +527,7 @@ inline void draw_pieces(const std::weak_ptr<Board> board_ptr)
 
                         // if the king is in check, then we draw a different picture, if its not in check, then 
                         // we draw the normal king piece
-                        if ( board_ptr.lock()->is_check(a_piece.lock()->tell_color()) ) 
+                        if ( king_in_check ) 
                             picture = rendered_images.wKing_check;
                         else { picture = rendered_images.King; }
                         break;
@@ -547,7 +554,7 @@ inline void draw_pieces(const std::weak_ptr<Board> board_ptr)
                     
                     case KING*10:
 
-                        if ( board_ptr.lock()->is_check(a_piece.lock()->tell_color()) ) picture = rendered_images.blKing_check;
+                        if ( king_in_check ) picture = rendered_images.blKing_check;
                         else { picture = rendered_images.King_bl; }
                         break;
 
@@ -586,20 +593,20 @@ inline void drawPossibleMoves( const std::vector< helper::coordinates<int64_t> >
     // base values
     helper::coordinates<int64_t> aux = current;
 
-    int32_t square_width = screen_width/8;
-    int32_t square_height = screen_height/8;
+    int32_t square_width = screen_width/Board::width;
+    int32_t square_height = screen_height/Board::height;
 
     std::vector<helper::coordinates<int64_t>> directions_cannot_go;
 
     
-    helper::coordinates<int64_t> aux0 = square_to_pos(current, square_width*8, square_height*8, false);
+    helper::coordinates<int64_t> aux0 = helper::square_to_pos<Board::width, Board::height>(current, square_width*Board::width, square_height*Board::height, false);
 
 
 
     //render_image(&pieces.green_ball, aux.x, aux.y);
 
     for ( const helper::coordinates<int64_t>& a_move : moves ) {
-        aux = aux0 + square_to_pos(a_move, square_width*8, square_height*8, false);
+        aux = aux0 + helper::square_to_pos<Board::width, Board::height>(a_move, square_width*Board::width, square_height*Board::height, false);
 
 
         render_image(pieces.green_ball, aux.x, aux.y);
@@ -616,17 +623,17 @@ inline void drawPossibleMoves1( const std::vector< helper::coordinates<int64_t>
 
     helper::coordinates<int64_t> aux = current;
 
-    int32_t square_width = screen_width/8;
-    int32_t square_height = screen_height/8;
+    int32_t square_width = screen_width/Board::width;
+    int32_t square_height = screen_height/Board::height;
 
     std::vector<helper::coordinates<int64_t>> directions_cannot_go;
 
     // base values
-    helper::coordinates<int64_t> aux0 = square_to_pos(current, square_width*8, square_height*8, false);
+    helper::coordinates<int64_t> aux0 = helper::square_to_pos<Board::width, Board::height>(current, square_width*Board::width, square_height*Board::height, false);
 
 
     for ( const helper::coordinates<int64_t>& a_move : moves ) {
-        aux = aux0 + square_to_pos(a_move, square_width*8, square_height*8, false);
+        aux = aux0 + helper::square_to_pos<Board::width, Board::height>(a_move, square_width*Board::width, square_height*Board::height, false);
 
         //rendered_picture aa = rendered_images.greenBall;
         render_at_pos(rendered_images.greenBall.begin, aux.x, aux.y, rendered_images.greenBall.width, rendered_images.greenBall.height);
@@ -642,17 +649,17 @@ inline void drawPossibleMoves2( const std::vector< coordinate_ptr >& moves, cons
 
     helper::coordinates<int64_t> aux = current;
 
-    int square_width = screen_width/8;
-    int square_height = screen_height/8;
+    int square_width = screen_width/Board::width;
+    int square_height = screen_height/Board::height;
 
     std::vector<helper::coordinates<int64_t>> directions_cannot_go;
 
     // base values
-    helper::coordinates<int64_t> aux0 = square_to_pos(current, square_width*8, square_height*8, false);
+    helper::coordinates<int64_t> aux0 = helper::square_to_pos<Board::width, Board::height>(current, square_width*Board::width, square_height*Board::height, false);
 
 
     for ( const coordinate_ptr& a_move : moves ) {
-        aux = aux0 + square_to_pos(*a_move, square_width*8, square_height*8, false);
+        aux = aux0 + helper::square_to_pos<Board::width, Board::height>(*a_move, square_width*Board::width, square_height*Board::height, false);
 
         //rendered_picture aa = rendered_images.greenBall;
         render_at_pos(rendered_images.greenBall.begin, aux.x, aux.y, rendered_images.greenBall.width, rendered_images.greenBall.height);